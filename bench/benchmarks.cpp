@@ -0,0 +1,178 @@
+// Бенчмарки чтения, записи, преобразований и конвертации между форматами.
+//
+// Запуск с JSON-отчётом для сравнения сборок:
+//   ./benchmarks --benchmark_out=results.json --benchmark_out_format=json
+// Два отчёта сравниваются скриптом tools/compare.py из Google Benchmark.
+//
+// Входные файлы (CorpusGenerator) генерируются один раз в каталоге временных файлов
+// (subtitle_bench/) трёх размеров: small, medium и huge.
+#include "SRTSubtitle.h"
+#include "SAMISubtitle.h"
+#include "ASSSubtitle.h"
+#include "VTTSubtitle.h"
+#include "BinarySubtitle.h"
+#include "Converter.h"
+#include "CorpusGenerator.h"
+#include "TransformPipeline.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const FORMATS[] = {"srt", "vtt", "smi", "ass", "subbin"};
+
+const std::pair<const char*, int64_t> SIZES[] = {
+    {"small", 100},
+    {"medium", 10000},
+    {"huge", 200000},
+};
+
+fs::path benchDir() {
+    return fs::temp_directory_path() / "subtitle_bench";
+}
+
+// Файл заданного формата и размера; создаётся при первом обращении.
+// SRT, VTT, SMI и ASS пишет CorpusGenerator с одним seed, subbin
+// получается конвертацией из SRT
+std::string inputFile(const std::string& ext, int64_t cues) {
+    static std::map<std::pair<std::string, int64_t>, std::string> files;
+    auto found = files.find({ext, cues});
+    if (found != files.end()) return found->second;
+
+    fs::create_directories(benchDir());
+    std::string base = (benchDir() / ("corpus_" + std::to_string(cues))).string();
+    std::string path = base + "." + ext;
+    if (!fs::exists(path)) {
+        CorpusGenerator::Options options;
+        options.seed = 12345;
+        options.cues = static_cast<uint64_t>(cues);
+        options.tagDensity = 0.1;
+        if (CorpusGenerator::isSupported(ext)) {
+            CorpusGenerator(options).write(path);
+        } else {
+            std::string srt = inputFile("srt", cues);
+            Converter::convertFile(srt, path, ConversionOptions());
+        }
+    }
+    files[{ext, cues}] = path;
+    return path;
+}
+
+void readInto(SRTSubtitle& subs, const std::string& file) { subs.read(file); }
+void readInto(SAMISubtitle& subs, const std::string& file) { subs.read(file); }
+void readInto(ASSSubtitle& subs, const std::string& file) { subs.read(file); }
+void readInto(VTTSubtitle& subs, const std::string& file) { subs.read(file, false); }
+void readInto(BinarySubtitle& subs, const std::string& file) { subs.read(file); }
+
+void setCounters(benchmark::State& state, int64_t bytes, int64_t cues) {
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["cues"] = benchmark::Counter(static_cast<double>(cues),
+                                                benchmark::Counter::kIsIterationInvariantRate);
+}
+
+template <class Format>
+void benchRead(benchmark::State& state, std::string ext, int64_t cues) {
+    std::string file = inputFile(ext, cues);
+    for (auto _ : state) {
+        Format subs;
+        readInto(subs, file);
+        benchmark::DoNotOptimize(subs.getEntries().getSize());
+    }
+    setCounters(state, static_cast<int64_t>(fs::file_size(file)), cues);
+}
+
+template <class Format>
+void benchWrite(benchmark::State& state, std::string ext, int64_t cues) {
+    Format subs;
+    readInto(subs, inputFile(ext, cues));
+    std::string out = (benchDir() / ("write_output." + ext)).string();
+    for (auto _ : state) subs.write(out);
+    setCounters(state, static_cast<int64_t>(fs::file_size(out)), cues);
+    fs::remove(out);
+}
+
+// Преобразования меняют записи, поэтому каждая итерация работает с копией:
+// копия списка разделяет таблицу, отделение входит в измеряемое время.
+// ALL_TRANSFORMS — все три сразу одним TransformPipeline
+enum Transform { SHIFT_TIME, REMOVE_FORMATTING, ADD_DEFAULT_STYLE, ALL_TRANSFORMS };
+
+template <class Format>
+void benchTransform(benchmark::State& state, std::string ext, int64_t cues, Transform transform) {
+    std::string file = inputFile(ext, cues);
+    Format original;
+    readInto(original, file);
+    TransformPipeline all;
+    all.setShift(1500);
+    all.setRemoveFormatting(true);
+    all.setStyle("i");
+    for (auto _ : state) {
+        Format subs = original;
+        switch (transform) {
+        case SHIFT_TIME: subs.shiftTime(1500, START_END); break;
+        case REMOVE_FORMATTING: subs.removeFormatting(); break;
+        case ADD_DEFAULT_STYLE: subs.addDefaultStyle("i"); break;
+        case ALL_TRANSFORMS: subs.transform(all); break;
+        }
+        benchmark::DoNotOptimize(subs.getEntries().getSize());
+    }
+    setCounters(state, static_cast<int64_t>(fs::file_size(file)), cues);
+}
+
+void benchConvert(benchmark::State& state, std::string from, std::string to, int64_t cues) {
+    std::string file = inputFile(from, cues);
+    std::string out = (benchDir() / ("convert_output." + to)).string();
+    ConversionOptions options;
+    for (auto _ : state) Converter::convertFile(file, out, options);
+    setCounters(state, static_cast<int64_t>(fs::file_size(file)), cues);
+    fs::remove(out);
+}
+
+template <class Format>
+void registerFormat(const std::string& ext, const char* sizeName, int64_t cues) {
+    std::string suffix = ext + "/" + sizeName;
+    benchmark::RegisterBenchmark(("read/" + suffix).c_str(), benchRead<Format>, ext, cues);
+    benchmark::RegisterBenchmark(("write/" + suffix).c_str(), benchWrite<Format>, ext, cues);
+    benchmark::RegisterBenchmark(("shiftTime/" + suffix).c_str(), benchTransform<Format>, ext, cues, SHIFT_TIME);
+    benchmark::RegisterBenchmark(("removeFormatting/" + suffix).c_str(), benchTransform<Format>, ext, cues,
+                                 REMOVE_FORMATTING);
+    benchmark::RegisterBenchmark(("addDefaultStyle/" + suffix).c_str(), benchTransform<Format>, ext, cues,
+                                 ADD_DEFAULT_STYLE);
+    benchmark::RegisterBenchmark(("transformAll/" + suffix).c_str(), benchTransform<Format>, ext, cues,
+                                 ALL_TRANSFORMS);
+}
+
+void registerAll() {
+    for (const auto& size : SIZES) {
+        registerFormat<SRTSubtitle>("srt", size.first, size.second);
+        registerFormat<VTTSubtitle>("vtt", size.first, size.second);
+        registerFormat<SAMISubtitle>("smi", size.first, size.second);
+        registerFormat<ASSSubtitle>("ass", size.first, size.second);
+        registerFormat<BinarySubtitle>("subbin", size.first, size.second);
+    }
+    for (const auto& size : SIZES)
+        for (const char* from : FORMATS)
+            for (const char* to : FORMATS) {
+                std::string name = std::string("convert/") + from + "->" + to + "/" + size.first;
+                benchmark::RegisterBenchmark(name.c_str(), benchConvert, from, to, size.second)
+                    ->Unit(benchmark::kMillisecond);
+            }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    registerAll();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
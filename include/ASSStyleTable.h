@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Стиль из секции [V4+ Styles]. Поля, которые могут быть дробными
+// (размер шрифта, масштаб, интервал, угол, контур и тень), хранятся
+// текстом из файла, чтобы строка Style записывалась без изменений
+struct ASSStyle {
+    std::string name;
+    std::string fontname;
+    std::string fontsize;
+    std::string primaryColour;
+    std::string secondaryColour;
+    std::string outlineColour;
+    std::string backColour;
+    int bold;
+    int italic;
+    int underline;
+    int strikeOut;
+    std::string scaleX;
+    std::string scaleY;
+    std::string spacing;
+    std::string angle;
+    int borderStyle;
+    std::string outline;
+    std::string shadow;
+    int alignment;
+    int marginL;
+    int marginR;
+    int marginV;
+    int encoding;
+};
+
+// Таблица стилей без ограничения на их число. Пустая таблица не выделяет
+// памяти, поэтому файлы без [V4+ Styles] за неё не платят. Стили хранятся
+// в порядке появления (так они и записываются), а поиск по имени для
+// событий Dialogue идёт через хеш-таблицу. Ключи указывают на имена
+// стилей, которые лежат в отдельных блоках и при добавлении не перемещаются.
+class ASSStyleTable {
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    ASSStyleTable() = default;
+    ASSStyleTable(const ASSStyleTable& other);
+    ASSStyleTable(ASSStyleTable&& other) noexcept = default;
+    ASSStyleTable& operator=(const ASSStyleTable& other);
+    ASSStyleTable& operator=(ASSStyleTable&& other) noexcept = default;
+
+    // Стиль с уже известным именем тоже сохраняется, но поиск по имени
+    // находит последний из них — так выбирают стиль рендереры ASS
+    void add(ASSStyle&& style);
+
+    size_t indexOf(std::string_view name) const;    // npos, если стиля нет
+    const ASSStyle* find(std::string_view name) const; // nullptr, если стиля нет
+
+    const ASSStyle& operator[](size_t index) const { return *styles[index]; }
+    size_t getSize() const { return styles.size(); }
+    bool isEmpty() const { return styles.empty(); }
+    void clear();
+
+private:
+    std::vector<std::unique_ptr<ASSStyle>> styles;
+    std::unordered_map<std::string_view, size_t> index;
+};
@@ -1,38 +1,48 @@
 #pragma once
 
-#ifndef MAX_STYLES
-#define MAX_STYLES 100
-#endif
-
-#ifndef MAX_DIALOGUE_FIELDS
-#define MAX_DIALOGUE_FIELDS 20
-#endif
-
+#include "ASSStyleTable.h"
 #include "SRTSubtitle.h"
 #include "SAMISubtitle.h"
 #include "SubtitleEntryList.h"
+#include "TransformPipeline.h"
+#include "LineReader.h"
 #include <string>
+#include <string_view>
 
 class ASSSubtitle {
 public:
     ASSSubtitle();
 
-    void read(const std::string& filename);
-    void write(const std::string& filename) const;
+    // keepMarkup — текст Dialogue сохраняется как есть, с блоками {\...} и "\N"
+    // (для разбора в RichText); иначе блоки удаляются, а "\N" становится переводом строки
+    void read(const std::string& filename, bool keepMarkup = false);
+    // threads != 1 — события форматируются на нескольких потоках (ParallelWriter)
+    void write(const std::string& filename, size_t threads = 1) const;
 
     SubtitleEntryList& getEntries();
+    const ASSStyleTable& getStyles() const;
+    // Стиль события Dialogue по имени из его поля Style (formatting записи,
+    // пустое — Default); nullptr — нет такого
+    const ASSStyle* findStyle(std::string_view name) const;
     void removeFormatting();
     void addDefaultStyle(const std::string& style);
     void shiftTime(int64_t delta_ms, TimeShiftType type);
+    void remapTime(const TimeRemap& remap); // Смена частоты кадров, исправление дрейфа
+    void transform(const TransformPipeline& pipeline); // Все преобразования за один проход
 
 private:
-    int64_t parseTime(const std::string& timeStr);
+    int64_t parseTime(std::string_view timeStr);
     std::string formatTime(int64_t ms) const;
 
-    void parseScriptInfo(std::ifstream& in);
-    void parseStyles(std::ifstream& in);
-    void parseEvents(std::ifstream& in);
-    void parseDialogue(const std::string& line);
+    void parseScriptInfo(LineReader& in);
+    void parseStyles(LineReader& in);
+    void parseEvents(LineReader& in);
+    void parseEventFormat(std::string_view line);
+    void parseDialogue(std::string_view line);
+
+    void writeHeader(BufferedWriter& out) const; // [Script Info], [V4+ Styles] и заголовок [Events]
+    static void writeEntry(BufferedWriter& out, const SubtitleEntryView& entry, size_t index);
+    static size_t entrySize(const SubtitleEntryView& entry, size_t index);
 
     struct ScriptInfo {
         std::string title;
@@ -46,47 +56,23 @@ private:
     
     ScriptInfo scriptInfo; 
 
-    struct Style {
-        std::string name;
-        std::string fontname;
-        int fontsize;
-        std::string primaryColour;
-        std::string secondaryColour;
-        std::string outlineColour;
-        std::string backColour;
-        int bold;
-        int italic;
-        int underline;
-        int strikeOut;
-        int scaleX;
-        int scaleY;
-        int spacing;
-        int angle;
-        int borderStyle;
-        int outline;
-        int shadow;
-        int alignment;
-        int marginL;
-        int marginR;
-        int marginV;
-        int encoding;
-    };
+    ASSStyleTable styles; // Заполняется только при наличии [V4+ Styles]
+
+    static const char* DEFAULT_STYLE; // Параметры строки Style: после имени, для стиля не из таблицы
 
-    Style styles[MAX_STYLES];
-    int stylesCount;
+    // Порядок полей Dialogue из строки Format: секции [Events]
+    struct EventFormat {
+        size_t fieldCount; // Количество полей, Text всегда последнее
+        size_t layerField; // Layer (V4+) или Marked (V4), npos если отсутствует
+        size_t startField;
+        size_t endField;
+        size_t styleField; // npos, если отсутствует
 
-    struct Dialogue {
-        int layer;
-        std::string start;
-        std::string end;
-        std::string style;
-        std::string name;
-        std::string marginL;
-        std::string marginR;
-        std::string marginV;
-        std::string effect;
-        std::string text;
+        EventFormat();
     };
 
+    EventFormat eventFormat;
+    bool keepMarkup;
+
     SubtitleEntryList entries;
 };
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include "Converter.h"
+#include "PhaseStats.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Пакетная конвертация: файлы каталога или списка конвертируются
+// параллельно на пуле потоков. Ошибка в одном файле не прерывает пакет.
+class BatchConverter {
+public:
+    struct Options {
+        ConversionOptions conversion;
+        std::string format;        // Расширение выходных файлов: srt, vtt, smi, ass
+        std::string pattern;       // Шаблон пути: {dir}, {name}, {ext} или каталог
+        size_t jobs;               // Потоков, 0 — по числу ядер
+        uint64_t streamThreshold;  // С этого размера файл делится между свободными потоками или конвертируется потоково
+
+        Options();
+    };
+
+    struct Result {
+        std::string input;
+        std::string output;
+        bool ok;
+        std::string error;
+        PhaseStats stats;  // Заполняется, если задан conversion.stats
+    };
+
+    // Файлы субтитров каталога (без вложенных) или строки файла-списка
+    static std::vector<std::string> collectInputs(const std::string& source);
+
+    static std::string makeOutputPath(const std::string& input, const std::string& pattern, const std::string& format);
+
+    // Результаты возвращаются в порядке inputs
+    static std::vector<Result> run(const std::vector<std::string>& inputs, const Options& options);
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include "SubtitleEntryList.h"
+#include "TransformPipeline.h"
+#include "SRTSubtitle.h"
+#include <cstdint>
+#include <string>
+
+// Двоичный кэш списка субтитров (.subbin), версия 1.
+//
+//   Header    64 байта: сигнатура, порядок байт, версия, число записей,
+//             смещения таблиц и размер текстового блока
+//   Records   count * 40 байт: start_ms, end_ms, x1, x2, y1, y2, флаги
+//   Offsets   (2 * count + 1) * 8 байт: текст записи i — [off[2i], off[2i+1]),
+//             formatting — [off[2i+1], off[2i+2]) в текстовом блоке
+//   Blob      тексты подряд
+//   Checksum  8 байт: контрольная сумма всего, что перед ней
+//
+// Загрузка — одно отображение файла в память, проверка и копирование в
+// список в режиме арены без выделения памяти на каждую запись.
+class BinarySubtitle {
+private:
+    SubtitleEntryList entries;
+
+public:
+    static const uint32_t VERSION = 1;
+
+    BinarySubtitle();
+
+    void read(const std::string& filename);
+    void write(const std::string& filename) const;
+    SubtitleEntryList& getEntries();
+
+    void removeFormatting();
+    void addDefaultStyle(const std::string& style);
+    void shiftTime(int64_t delta_ms, TimeShiftType type);
+    void remapTime(const TimeRemap& remap); // Смена частоты кадров, исправление дрейфа
+    void transform(const TransformPipeline& pipeline); // Все преобразования за один проход
+};
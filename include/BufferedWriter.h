@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Буферизованная запись в файл большими блоками.
+// Мелкие фрагменты копируются в общий буфер, который сбрасывается одним
+// системным вызовом write(2); фрагмент, не помещающийся в буфер, уходит
+// вместе с накопленными данными одним writev(2) без лишнего копирования.
+//
+// Без имени файла пишет в память: буфер растёт по мере надобности, а
+// результат доступен через view() (параллельная запись по частям).
+class BufferedWriter {
+private:
+    std::string filename;
+    int fd;                       // Дескриптор файла (POSIX)
+    std::unique_ptr<std::ofstream> stream; // Запасной путь для систем без POSIX
+    char* buffer;
+    size_t capacity;
+    size_t used;
+    bool memory;                  // Запись в память, без файла
+
+    void writeAll(const char* data, size_t size);
+    void writeTwo(const char* first, size_t firstSize, const char* second, size_t secondSize);
+    void grow(size_t needed);     // Режим памяти: места хватит ещё на needed байт
+
+public:
+    static const size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+    explicit BufferedWriter(const std::string& filename, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    explicit BufferedWriter(size_t initialCapacity); // Запись в память
+    ~BufferedWriter(); // Сбрасывает буфер и закрывает файл, ошибки игнорируются
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    void write(const char* data, size_t size);
+    void write(std::string_view str) { write(str.data(), str.size()); }
+    void put(char c) {
+        if (used == capacity) flush();
+        buffer[used++] = c;
+    }
+    void writeInt(int64_t value);
+
+    // Прямой доступ к буферу: вызывающий пишет не более n байт и подтверждает их commit().
+    // Если n больше буфера, буфер увеличивается
+    char* reserve(size_t n);
+    void commit(size_t n) { used += n; }
+
+    BufferedWriter& operator<<(std::string_view str) { write(str); return *this; }
+    BufferedWriter& operator<<(char c) { put(c); return *this; }
+    BufferedWriter& operator<<(int value) { writeInt(value); return *this; }
+    BufferedWriter& operator<<(int64_t value) { writeInt(value); return *this; }
+    BufferedWriter& operator<<(size_t value) { writeInt(static_cast<int64_t>(value)); return *this; }
+
+    void flush();
+    void close(); // Сбрасывает буфер и закрывает файл, при ошибке бросает исключение
+
+    std::string_view view() const { return std::string_view(buffer, used); } // Записанное (режим памяти)
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include "PhaseStats.h"
+#include "TextEncoding.h"
+#include "TimeRemap.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Параметры конвертации одного файла (общие для CLI и пакетного режима)
+struct ConversionOptions {
+    int64_t shiftTimeMs;      // Сдвиг времени, 0 — без сдвига
+    TimeRemap remap;          // Пересчёт времени, применяется до сдвига
+    bool removeFormatting;    // Удалить форматирование
+    std::string addStyle;     // Стиль для всех записей, пустая строка — без стиля
+    bool stream;              // Потоковая конвертация, если пара форматов её поддерживает
+    bool arena;               // Хранить текст записей в арене (SubtitleEntryList::STORAGE_ARENA)
+    size_t parseThreads;      // Потоки разбора одного SRT/VTT-файла, 0 — по числу ядер
+    size_t writeThreads;      // Потоки записи одного SRT/VTT/ASS-файла, 0 — по числу ядер
+    bool richText;            // Переводить разметку в формат вывода через RichText
+    TextEncoding::Encoding outputEncoding; // Кодировка выходного файла (кроме subbin), по умолчанию UTF-8
+    PhaseStats* stats;        // Статистика по фазам, nullptr — не собирать
+
+    ConversionOptions();
+};
+
+// Конвертация файла субтитров: формат определяется по расширению входного
+// и выходного файлов (srt, vtt, smi, ass/ssa, subbin — двоичный кэш)
+class Converter {
+public:
+    static std::string extensionOf(const std::string& filename);
+    // При options.stats собирает статистику по фазам на текущем потоке
+    static void convertFile(const std::string& inFile, const std::string& outFile, const ConversionOptions& options);
+
+private:
+    static void convert(const std::string& inFile, const std::string& outFile, const ConversionOptions& options);
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Детерминированный генератор синтетических субтитров для бенчмарков и
+// нагрузочных тестов. Одинаковые параметры и seed дают побайтно одинаковые
+// файлы, а файлы разных форматов с одним seed содержат одни и те же записи.
+// Записи пишутся потоком через BufferedWriter, поэтому размер файла
+// (десятки миллионов записей, гигабайты) не ограничен памятью.
+//
+// SRT, VTT (с блоками NOTE и идентификаторами), ASS (несколько стилей,
+// теги {\...}, запятые в тексте, строки Marked=) и SAMI.
+class CorpusGenerator {
+public:
+    struct Options {
+        uint64_t seed;
+        uint64_t cues;        // Количество записей
+        double overlap;       // Доля записей, начинающихся до конца предыдущей
+        int minLineLength;    // Длина строки текста в символах
+        int maxLineLength;
+        int maxLines;         // Строк в записи: от 1 до maxLines
+        double tagDensity;    // Вероятность тега форматирования на слово
+        double utf8Share;     // Доля слов не из ASCII (кириллица, CJK, эмодзи)
+        double noteShare;     // VTT: вероятность блока NOTE перед записью
+        int styles;           // ASS: количество стилей
+
+        Options();
+    };
+
+    explicit CorpusGenerator(const Options& options);
+
+    // Формат определяется по расширению: srt, vtt, smi/sami, ass/ssa
+    void write(const std::string& filename) const;
+
+    static bool isSupported(const std::string& extension);
+
+private:
+    Options options;
+};
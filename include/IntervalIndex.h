@@ -0,0 +1,45 @@
+#pragma once
+#include "SubtitleEntryList.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Индекс интервалов [start_ms, end_ms) записей списка: какие субтитры
+// видны в момент t или пересекают отрезок [from, to).
+// Записи отсортированы по началу и образуют неявное двоичное дерево,
+// в каждом узле которого хранится наибольший конец в поддереве; запрос
+// выполняется за O(log n + k). Результат — индексы записей в списке,
+// по возрастанию начала.
+class IntervalIndex {
+private:
+    std::vector<int64_t> start;  // Отсортированы по возрастанию
+    std::vector<int64_t> end;
+    std::vector<int64_t> maxEnd; // Наибольший конец в поддереве узла
+    std::vector<size_t> ids;     // Индекс записи в списке
+    int64_t offset;              // Общий сдвиг, применённый после построения
+    int maxLevel;
+
+    void gather(const SubtitleEntryList& entries);
+    void sortByStart();
+    void buildTree();
+    size_t query(int64_t from, int64_t to, std::vector<size_t>& out) const;
+
+public:
+    IntervalIndex();
+    explicit IntervalIndex(const SubtitleEntryList& entries);
+
+    void build(const SubtitleEntryList& entries);
+
+    // Перечитывает времена после shiftTime/remapTime. Если порядок записей
+    // по началу не изменился, сортировка не нужна и обновление линейно.
+    void refresh(const SubtitleEntryList& entries);
+
+    // Учитывает сдвиг START_END всех записей на delta_ms за O(1)
+    void shift(int64_t delta_ms);
+
+    // Индексы добавляются в out, возвращается их количество
+    size_t findActive(int64_t t, std::vector<size_t>& out) const;
+    size_t findOverlapping(int64_t from, int64_t to, std::vector<size_t>& out) const;
+
+    size_t getSize() const;
+};
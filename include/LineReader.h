@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+// Построчный сканер поверх буфера в памяти.
+// Строки выдаются как string_view без копирования: завершающий '\r'
+// (CRLF) отрезается, UTF-8 BOM в начале буфера пропускается.
+class LineReader {
+private:
+    const char* begin;
+    const char* end;
+    const char* cur;
+
+public:
+    explicit LineReader(std::string_view buffer);
+
+    bool getLine(std::string_view& line); // false, если строк больше нет
+    bool eof() const;
+
+    size_t tell() const;      // Смещение текущей позиции от начала буфера
+    void seek(size_t pos);    // Возврат к ранее запомненной позиции
+
+    static std::string_view trim(std::string_view str); // Обрезает " \t\r\n" по краям
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Файл, целиком отображённый в память (mmap).
+// Если отображение недоступно (пустой файл, канал, не-POSIX система),
+// содержимое читается в собственный буфер одним проходом.
+class MappedFile {
+private:
+    const char* data;
+    size_t size;
+    void* mapping;        // Адрес отображения или nullptr, если используется буфер
+    size_t released;      // Граница уже освобождённых страниц отображения
+    std::string buffer;   // Резервный буфер для чтения без mmap
+
+    void readFallback(const std::string& filename);
+
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const;
+    size_t getSize() const;
+
+    // Сообщает, что данные до смещения offset больше не нужны: страницы
+    // отображения освобождаются порциями, и память при последовательном
+    // чтении не растёт вместе с размером файла
+    void release(size_t offset);
+
+    // Приводит текстовый файл к UTF-8 (TextEncoding::normalize): UTF-16 и
+    // однобайтовые кодировки перекодируются в собственный буфер, а
+    // отображение закрывается. Двоичные файлы этот шаг не проходят
+    void decodeText();
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include "SubtitleEntry.h"
+#include "SubtitleEntryList.h"
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+// Разбор одного большого файла на нескольких потоках.
+// Записи SRT и VTT разделены пустыми строками, и после пустой строки
+// последовательный разбор всегда начинает новую запись. Поэтому буфер
+// делится по пустым строкам на части, части разбираются параллельно в
+// собственные списки, а списки склеиваются по порядку без копирования
+// текста — результат тот же, что у последовательного разбора.
+class ParallelParser {
+public:
+    // Разбирает часть буфера целиком, передавая записи в sink
+    using ChunkParser = std::function<void(std::string_view chunk, const EntrySink& sink)>;
+
+    static const size_t MIN_CHUNK_SIZE = 256 << 10; // Меньшие части не окупают потоки
+
+    // Границы частей: begin, ..., buffer.size(). Каждая граница, кроме begin,
+    // стоит сразу после пустой строки ("\n" или "\r\n") и не в начале UTF-8 BOM
+    // (LineReader пропустил бы его). Частей не больше parts.
+    static std::vector<size_t> split(std::string_view buffer, size_t begin, size_t parts);
+
+    // Разбирает buffer начиная с begin на threads потоках (0 — по числу ядер)
+    // и дописывает записи в entries. Возвращает false и ничего не делает, если
+    // буфер слишком мал для деления — тогда вызывающий разбирает его сам.
+    static bool parse(std::string_view buffer, size_t begin, size_t threads, const ChunkParser& parser,
+                      SubtitleEntryList& entries);
+};
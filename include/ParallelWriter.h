@@ -0,0 +1,29 @@
+#pragma once
+#include "BufferedWriter.h"
+#include "SubtitleEntryList.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Запись одного большого файла на нескольких потоках в две фазы.
+// Метки времени имеют фиксированную ширину, поэтому размер каждой записи
+// вычисляется без форматирования. Первая фаза считает размеры диапазонов
+// записей и их смещения в файле, вторая форматирует диапазоны параллельно
+// в собственные буферы и пишет их по своим смещениям (pwrite) в файл,
+// заранее увеличенный до итогового размера. Номера записей SRT остаются
+// глобальными: форматтер получает индекс записи во всём списке.
+class ParallelWriter {
+public:
+    // Точный размер записи в байтах — столько же, сколько запишет EntryWriter
+    using EntrySize = size_t (*)(const SubtitleEntryView& entry, size_t index);
+    using EntryWriter = void (*)(BufferedWriter& out, const SubtitleEntryView& entry, size_t index);
+
+    static const size_t MIN_RANGE_ENTRIES = 4096;  // Меньшие диапазоны не окупают потоки
+    static const size_t MAX_RANGE_ENTRIES = 32768; // Ограничивает память под буферы диапазонов
+
+    // Пишет header, записи и footer в filename на threads потоках (0 — по
+    // числу ядер). Возвращает false и ничего не делает, если записей слишком
+    // мало или система не поддерживает pwrite — тогда вызывающий пишет сам.
+    static bool write(const std::string& filename, const SubtitleEntryList& entries, std::string_view header,
+                      std::string_view footer, EntrySize size, EntryWriter writer, size_t threads);
+};
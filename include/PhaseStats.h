@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Статистика конвертации по фазам: время, а при доступном perf_event_open —
+// такты, инструкции и промахи кэша; плюс число выделений памяти
+// (operator new на текущем потоке).
+//
+// Библиотека отмечает фазы объектами Scope. Пока на потоке нет активного
+// Recorder, Scope ничего не делает. Вложенная фаза приостанавливает
+// внешнюю: время сброса буфера (FLUSH) не входит в FORMAT.
+//
+// Recorder привязан к своему потоку: работа пулов ParallelParser,
+// ParallelWriter и BatchConverter попадает в фазу вызывающего потока только
+// временем ожидания, а такты, инструкции и выделения рабочих потоков не
+// учитываются. Пакетный режим собирает статистику каждого файла на его
+// рабочем потоке и складывает результаты через merge().
+//
+// Выделения считает замена operator new из src/AllocationCounter.cpp,
+// которая подключается только к программе и тестам, но не к библиотеке:
+// без неё allocations остаётся нулевым.
+class PhaseStats {
+public:
+    enum Phase {
+        OPEN_READ, // Открытие и отображение/чтение файла
+        PARSE,     // Разбор (включая подкачку страниц отображения)
+        SHIFT,     // Сдвиг и пересчёт времени
+        STRIP,     // Удаление форматирования (со стилем, если он добавляется тем же проходом)
+        STYLE,     // Добавление стиля без удаления форматирования
+        FORMAT,    // Форматирование вывода
+        FLUSH,     // Запись буфера в файл
+        STREAM,    // Потоковая конвертация: разбор, правка и вывод вперемешку
+        PHASE_COUNT,
+        NO_PHASE = -1
+    };
+
+    struct Counters {
+        uint64_t ns;
+        uint64_t cycles;
+        uint64_t instructions;
+        uint64_t cacheMisses;
+        uint64_t allocations;
+
+        Counters();
+        Counters& operator+=(const Counters& other);
+    };
+
+    // Отмечает фазу на время своей жизни
+    class Scope {
+    private:
+        int previous;
+
+    public:
+        explicit Scope(Phase phase);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // Собирает статистику текущего потока в stats, пока существует
+    class Recorder {
+    private:
+        PhaseStats& stats;
+        Recorder* outer;  // Recorder, активный на потоке до этого
+        int perfFds[3];   // Группа счётчиков perf (лидер — такты), -1 если недоступно
+        int current;
+        Counters last;
+        uint64_t startNs;
+
+        Counters sample() const;
+
+    public:
+        explicit Recorder(PhaseStats& stats);
+        ~Recorder();
+
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+
+        int enter(int phase); // Возвращает прежнюю фазу
+        void addCues(uint64_t count);
+    };
+
+    Counters phases[PHASE_COUNT];
+    uint64_t wallNs;
+    uint64_t cues;
+    uint64_t inputBytes;
+    uint64_t outputBytes;
+    size_t files;
+    bool hardwareCounters; // true, если такты/инструкции/промахи собраны
+
+    PhaseStats();
+
+    void merge(const PhaseStats& other); // Сумма по файлам пакета
+
+    // Сообщает число записей активному Recorder потока (если он есть)
+    static void addCues(uint64_t count);
+
+    static const char* phaseName(Phase phase);
+
+    // Число выделений на текущем потоке (увеличивает AllocationCounter.cpp)
+    static thread_local uint64_t allocationCount;
+
+    // JSON-сводка; input/output пишутся, если не пустые
+    std::string toJson(const std::string& input = "", const std::string& output = "") const;
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Текст записи без разметки плюс отрезки оформления (runs): жирный,
+// курсив, подчёркивание, зачёркивание, цвет и положение записи.
+// Разметка входного формата разбирается один раз, правки стиля меняют
+// только отрезки, а каждый формат выводит свою разметку: HTML-теги для
+// SRT/SAMI, теги WebVTT, блоки {\...} для ASS. Поэтому оформление
+// переживает конвертацию между форматами.
+class RichText {
+public:
+    enum Markup {
+        MARKUP_HTML, // <b> <i> <u> <s> <font color="#rrggbb">, {\anN} в начале (SRT, SAMI)
+        MARKUP_VTT,  // <b> <i> <u>; цвет и положение в тексте WebVTT не выражаются
+        MARKUP_ASS   // {\b1} {\i1} {\u1} {\s1} {\c&Hbbggrr&} {\anN} {\pos(x,y)}, "\N"
+    };
+
+    enum Flag : uint8_t {
+        BOLD = 1,
+        ITALIC = 2,
+        UNDERLINE = 4,
+        STRIKEOUT = 8
+    };
+
+    static const uint32_t NO_COLOUR = 0xFFFFFFFF; // Цвет стиля по умолчанию
+
+    // Отрезок текста с одинаковым оформлением
+    struct Run {
+        uint32_t length;
+        uint32_t colour; // 0xRRGGBB или NO_COLOUR
+        uint8_t flags;
+    };
+
+    RichText();
+
+    static RichText parse(std::string_view text, Markup markup);
+    std::string format(Markup markup) const;
+
+    const std::string& getText() const;   // Без разметки, переводы строк — '\n'
+    const std::vector<Run>& getRuns() const;
+    int getAlignment() const;             // 1..9 как на цифровой клавиатуре, 0 — не задано
+    bool hasPosition() const;
+    int getX() const;
+    int getY() const;
+
+    void addFlags(uint8_t flags);   // Оформление всей записи, например стиль по умолчанию
+    void clearFormatting();         // Остаётся только текст
+
+    // Флаг для имени тега "b", "i", "u", "s"; 0 — тег не выражается отрезками
+    static uint8_t flagOf(std::string_view tag);
+
+private:
+    std::string text;
+    std::vector<Run> runs;
+    int alignment;
+    bool positioned;
+    int x;
+    int y;
+
+    void append(std::string_view str, uint8_t flags, uint32_t colour);
+    void parseHtml(std::string_view markup);
+    void parseAss(std::string_view markup);
+    // Команды одного блока {\...}; flags и colour — текущее оформление
+    void parseOverrides(std::string_view block, uint8_t& flags, uint32_t& colour);
+    void formatHtml(std::string& out, bool vtt) const;
+    void formatAss(std::string& out) const;
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "SubtitleEntryList.h"
+#include "TransformPipeline.h"
 #include "SRTSubtitle.h"
 #include <string>
 
@@ -15,7 +16,15 @@ public:
     void write(const std::string& filename) const;
     SubtitleEntryList& getEntries();
 
+    // Потоковый режим: записи передаются в sink без накопления в списке
+    void readStream(const std::string& filename, const EntrySink& sink);
+    static void writeHeader(BufferedWriter& out);
+    static void writeEntry(BufferedWriter& out, const SubtitleEntryView& entry, size_t index);
+    static void writeFooter(BufferedWriter& out);
+
     void removeFormatting();
     void addDefaultStyle(const std::string& style);
     void shiftTime(int64_t delta_ms, TimeShiftType type);
+    void remapTime(const TimeRemap& remap); // Смена частоты кадров, исправление дрейфа
+    void transform(const TransformPipeline& pipeline); // Все преобразования за один проход
 };
\ No newline at end of file
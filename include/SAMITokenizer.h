@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+// Однопроходный SAX-сканер разметки SAMI поверх буфера в памяти.
+// Выдаёт теги и текст между ними как string_view без копирования, каждый
+// байт просматривается один раз. Имена тегов и атрибутов сравниваются без
+// учёта регистра, перевод строки внутри тега или текста ничего не значит.
+// Комментарии <!-- --> пропускаются, содержимое <STYLE> выдаётся одним
+// текстом (CSS может содержать '<').
+class SAMITokenizer {
+public:
+    enum TokenType {
+        TOKEN_TAG,
+        TOKEN_TEXT
+    };
+
+    struct Token {
+        TokenType type;
+        std::string_view name;       // Имя тега как в файле, без '/'
+        std::string_view attributes; // Всё после имени до '>'
+        bool closing;                // </TAG>
+        size_t begin;                // Смещение '<' или начала текста
+        size_t end;                  // Смещение после '>' или конца текста
+    };
+
+    explicit SAMITokenizer(std::string_view buffer);
+
+    bool next(Token& token); // false в конце буфера
+    size_t tell() const;
+
+    // name == lowerName без учёта регистра (lowerName — в нижнем регистре)
+    static bool equals(std::string_view name, std::string_view lowerName);
+    // Значение атрибута: Start=123, Start="123", start='123'; false, если его нет
+    static bool attribute(std::string_view attributes, std::string_view lowerName, std::string_view& value);
+
+private:
+    std::string_view buffer;
+    size_t pos;
+    bool inStyle; // Следующий токен — текст до </STYLE>
+
+    size_t findClosingStyle(size_t from) const;
+};
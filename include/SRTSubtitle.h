@@ -1,5 +1,9 @@
 #pragma once
 #include "SubtitleEntryList.h"
+#include "TransformPipeline.h"
+#include "LineReader.h"
+#include "BufferedWriter.h"
+#include "MappedFile.h"
 #include <string>
 
 enum TimeShiftType {
@@ -15,15 +19,30 @@ private:
     static int64_t parseTime(const std::string& timeStr); // "00:01:02,345" -> ms
     static std::string formatTime(int64_t ms);
 
-    void parseEntry(std::ifstream& in);
-    void writeEntry(std::ofstream& out, const SubtitleEntry& entry, size_t index) const;
+    static void parseEntry(LineReader& in, const EntrySink& sink);
+    static void parseChunk(std::string_view chunk, const EntrySink& sink);
+    static void parseFile(MappedFile& file, const EntrySink& sink); // Последовательно, с освобождением страниц
 
 public:
-    void read(const std::string& filename);
-    void write(const std::string& filename) const;
+    // threads != 1 — разбор большого файла по частям на нескольких потоках
+    // (0 — по числу ядер); результат тот же, что у последовательного
+    void read(const std::string& filename, size_t threads = 1);
+    // threads != 1 — форматирование на нескольких потоках (ParallelWriter),
+    // вывод побайтно совпадает с последовательным
+    void write(const std::string& filename, size_t threads = 1) const;
+
+    // Потоковый режим: записи передаются в sink без накопления в списке
+    void readStream(const std::string& filename, const EntrySink& sink);
+    static void writeHeader(BufferedWriter& out);
+    static void writeEntry(BufferedWriter& out, const SubtitleEntryView& entry, size_t index);
+    static size_t entrySize(const SubtitleEntryView& entry, size_t index); // Байт, которые запишет writeEntry
+    static void writeFooter(BufferedWriter& out);
+
     SubtitleEntryList& getEntries();
 
     void removeFormatting();
     void addDefaultStyle(const std::string& style);
     void shiftTime(int64_t delta_ms, TimeShiftType type);
+    void remapTime(const TimeRemap& remap); // Смена частоты кадров, исправление дрейфа
+    void transform(const TransformPipeline& pipeline); // Все преобразования за один проход
 };
\ No newline at end of file
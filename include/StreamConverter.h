@@ -0,0 +1,29 @@
+#pragma once
+#include "TimeRemap.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Потоковая конвертация между SRT, VTT и SAMI с постоянным расходом памяти.
+// Поток разбора передаёт записи пакетами через ограниченную очередь потоку
+// записи; сдвиг времени, удаление форматирования и стиль применяются к
+// каждой записи на лету, весь файл в памяти не собирается.
+class StreamConverter {
+public:
+    struct Options {
+        int64_t shiftTimeMs;
+        TimeRemap remap;
+        bool removeFormatting;
+        std::string addStyle;
+        bool richText;      // Переводить разметку в формат вывода через RichText
+        size_t batchSize;   // Записей в одном пакете очереди
+        size_t queueDepth;  // Пакетов в очереди
+
+        Options();
+    };
+
+    // true, если пара форматов поддерживает потоковую обработку
+    static bool canStream(const std::string& inExtension, const std::string& outExtension);
+
+    static void convert(const std::string& inFile, const std::string& outFile, const Options& options);
+};
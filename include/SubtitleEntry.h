@@ -1,5 +1,8 @@
 #pragma once
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <string_view>
 struct SubtitleEntry {
     int64_t start_ms;
     int64_t end_ms;
@@ -17,4 +20,26 @@ struct SubtitleEntry {
     SubtitleEntry(int64_t start, int64_t end, const std::string& txt)
         : start_ms(start), end_ms(end), text(txt),
           x1(0), x2(0), y1(0), y2(0), has_coordinates(false) {}
-};
\ No newline at end of file
+};
+
+// Запись без владения текстом: общий вид записи для обоих режимов
+// хранения SubtitleEntryList и для потоковой записи
+struct SubtitleEntryView {
+    int64_t start_ms;
+    int64_t end_ms;
+    std::string_view text;
+    std::string_view formatting;
+    int x1, x2, y1, y2;
+    bool has_coordinates;
+
+    SubtitleEntryView()
+        : start_ms(0), end_ms(0), x1(0), x2(0), y1(0), y2(0),
+          has_coordinates(false) {}
+
+    SubtitleEntryView(const SubtitleEntry& entry)
+        : start_ms(entry.start_ms), end_ms(entry.end_ms), text(entry.text), formatting(entry.formatting),
+          x1(entry.x1), x2(entry.x2), y1(entry.y1), y2(entry.y2), has_coordinates(entry.has_coordinates) {}
+};
+
+// Приёмник записей для потокового разбора: вызывается для каждой записи сразу после её разбора
+using EntrySink = std::function<void(SubtitleEntry&&)>;
@@ -1,22 +1,155 @@
 #pragma once
 #include "SubtitleEntry.h"
+#include "TextArena.h"
+#include "TimeRemap.h"
 #include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
 
+// Список субтитров с разделяемым хранилищем (copy-on-write).
+// Копирование и перемещение списка выполняются за O(1) без выделения памяти:
+// копии ссылаются на одну таблицу записей. При первом изменяющем доступе
+// копируется только таблица указателей, а сама запись клонируется лишь тогда,
+// когда её действительно меняют.
+//
+// Времена начала и конца хранятся отдельными непрерывными столбцами int64_t,
+// поэтому сдвиг времени не трогает записи с текстом и не клонирует их.
+//
+// В режиме STORAGE_ARENA текст записей хранится в TextArena большими
+// блоками, а записи ссылаются на него смещением и длиной. operator[] в этом
+// режиме недоступен: чтение идёт через view(), изменение — через
+// setText/wrapText/editText/setStart/setEnd.
+//
+// Запись в арене разделена на горячую и холодную части: времена и ссылка
+// на текст лежат в плотных столбцах (28 байт на запись), а редкие поля —
+// форматирование и координаты расширения X1: SRT — в отдельной таблице по
+// номеру записи, которая у большинства файлов пуста.
 class SubtitleEntryList {
+public:
+    enum StorageMode {
+        STORAGE_ENTRIES, // Каждая запись — отдельный SubtitleEntry
+        STORAGE_ARENA    // Текст в арене, записи компактные
+    };
+
+    // Правка текста на месте: получает буфер и длину, возвращает новую длину (не больше старой)
+    using TextEditor = size_t (*)(char* text, size_t length);
+
 private:
-    SubtitleEntry* data;
-    size_t size;
-    size_t capacity;
+    using EntryPtr = std::shared_ptr<SubtitleEntry>;
+
+    // Редкие поля записи режима STORAGE_ARENA
+    struct RareFields {
+        size_t index; // Номер записи; таблица упорядочена по нему
+        TextArena::Ref formatting;
+        int x1, x2, y1, y2;
+        bool has_coordinates;
+    };
+
+    // Таблица записей, общая для всех копий списка
+    struct Table {
+        EntryPtr* data;
+        size_t size;
+        size_t capacity;
+
+        std::vector<int64_t> start; // Столбцы времени для обоих режимов
+        std::vector<int64_t> end;
+
+        std::vector<TextArena::Ref> texts; // Текст записей режима STORAGE_ARENA
+        std::vector<RareFields> rare;      // Только записи с непустыми редкими полями
+        TextArena arena;
+
+        Table();
+        ~Table();
+        Table(const Table&) = delete;
+        Table& operator=(const Table&) = delete;
+    };
+
+    std::shared_ptr<Table> table; // nullptr у пустого списка
+    StorageMode mode;
 
     void resize(size_t new_capacity);
+    void detach();                        // Делает таблицу уникальной перед изменением
+    SubtitleEntry& mutableAt(size_t index); // Клонирует запись, если она разделяемая
+    void checkIndex(size_t index) const;
+    const RareFields* findRare(size_t index) const; // nullptr, если редких полей у записи нет
 
 public:
+    // Ссылка на запись режима STORAGE_ENTRIES: поля времени указывают в столбцы,
+    // остальные — в саму запись. Действительна до следующей вставки.
+    struct EntryRef {
+        int64_t& start_ms;
+        int64_t& end_ms;
+        std::string& text;
+        std::string& formatting;
+        int& x1;
+        int& x2;
+        int& y1;
+        int& y2;
+        bool& has_coordinates;
+
+        EntryRef(SubtitleEntry& entry, int64_t& start, int64_t& end);
+    };
+
+    struct ConstEntryRef {
+        const int64_t& start_ms;
+        const int64_t& end_ms;
+        const std::string& text;
+        const std::string& formatting;
+        const int& x1;
+        const int& x2;
+        const int& y1;
+        const int& y2;
+        const bool& has_coordinates;
+
+        ConstEntryRef(const SubtitleEntry& entry, const int64_t& start, const int64_t& end);
+    };
+
     SubtitleEntryList();
+    explicit SubtitleEntryList(StorageMode mode);
     ~SubtitleEntryList();
 
+    SubtitleEntryList(const SubtitleEntryList& other);
+    SubtitleEntryList(SubtitleEntryList&& other) noexcept;
+    SubtitleEntryList& operator=(const SubtitleEntryList& other);
+    SubtitleEntryList& operator=(SubtitleEntryList&& other) noexcept;
+
+    // Переводит список в другой режим, перенося уже добавленные записи
+    void setStorageMode(StorageMode new_mode);
+    StorageMode getStorageMode() const;
+
     void push_back(const SubtitleEntry& entry);
-    SubtitleEntry& operator[](size_t index);
-    const SubtitleEntry& operator[](size_t index) const;
+    void push_back(SubtitleEntry&& entry);
+    void push_back(const SubtitleEntryView& entry); // В режиме арены — без временных строк
+    void reserve(size_t count, size_t textBytes = 0);  // textBytes — общий объём текста (арена)
+    // Переносит записи other в конец списка: в режиме записей — указатели,
+    // в режиме арены — блоки текста целиком, без копирования строк
+    void append(SubtitleEntryList&& other);
+    EntryRef operator[](size_t index);             // Только STORAGE_ENTRIES
+    ConstEntryRef operator[](size_t index) const;  // Только STORAGE_ENTRIES
     size_t getSize() const;
     void clear();
-};
\ No newline at end of file
+
+    // Доступ, одинаковый для обоих режимов
+    SubtitleEntryView view(size_t index) const;
+    std::string_view getText(size_t index) const;
+    int64_t getStart(size_t index) const;
+    int64_t getEnd(size_t index) const;
+    const int64_t* startTimes() const; // Столбцы времени целиком, без проверки индексов
+    const int64_t* endTimes() const;   // (nullptr у пустого списка)
+    void setStart(size_t index, int64_t start_ms);
+    void setEnd(size_t index, int64_t end_ms);
+    void setText(size_t index, std::string_view text);
+    void wrapText(size_t index, std::string_view prefix, std::string_view suffix); // prefix + text + suffix
+    void editText(size_t index, TextEditor editor);
+    // editText и wrapText для всех записей за один проход; editor может быть nullptr
+    void editTexts(TextEditor editor, std::string_view prefix, std::string_view suffix);
+
+    // Операции над всеми записями сразу (векторные, см. TimeShifter).
+    // При skipNotes записи с временами -1/-1 (заметки VTT) не меняются.
+    void shiftTimes(int64_t delta_ms, bool shiftStart, bool shiftEnd, bool skipNotes);
+    void clampTimes(int64_t min_ms, int64_t max_ms, bool skipNotes);
+    void remapTimes(const TimeRemap& remap, bool skipNotes);
+
+    bool isShared() const; // true, если таблица используется другой копией списка
+};
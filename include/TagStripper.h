@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Удаление разметки из текста субтитров без std::regex.
+// Поиск служебных символов ('<', '{', '\') выполняется векторно
+// (SSE2/AVX2) с выбором реализации во время выполнения; текст
+// правится на месте, без дополнительных выделений памяти.
+class TagStripper {
+public:
+    enum Kernel {
+        KERNEL_AUTO,   // Лучшая реализация, поддерживаемая процессором
+        KERNEL_SCALAR,
+        KERNEL_SSE2,
+        KERNEL_AVX2
+    };
+
+    // Эквивалент std::regex_replace(text, std::regex("<[^>]*>"), "")
+    static void removeHtmlTags(std::string& text);
+    static size_t removeHtmlTags(char* text, size_t length); // Возвращает новую длину
+
+    // Эквивалент последовательной замены "\N", "{[^}]*}" и "\" на ""
+    // (ASSSubtitle::removeFormatting), выполненной за один проход
+    static void removeAssTags(std::string& text);
+    static size_t removeAssTags(char* text, size_t length);
+
+    // Возвращает false, если реализация не поддерживается процессором
+    static bool setKernel(Kernel kernel);
+    static Kernel getKernel();
+    static bool isSupported(Kernel kernel);
+
+    static bool parseKernel(const std::string& name, Kernel& kernel); // "auto", "scalar", "sse2", "avx2"
+    static const char* kernelName(Kernel kernel);
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Хранилище строк большими блоками (slab).
+// Строки только дописываются в конец текущего блока и адресуются номером
+// блока, смещением и длиной; блоки никогда не перемещаются, поэтому
+// выданные string_view остаются действительными до clear().
+class TextArena {
+public:
+    struct Ref {
+        uint32_t slab;
+        uint32_t offset;
+        uint32_t length;
+
+        Ref() : slab(0), offset(0), length(0) {}
+    };
+
+    static const size_t DEFAULT_SLAB_SIZE = 1 << 20;
+
+    explicit TextArena(size_t slabSize = DEFAULT_SLAB_SIZE);
+    TextArena(const TextArena& other); // Копирует только занятую часть блоков
+    TextArena(TextArena&& other) noexcept;
+    TextArena& operator=(const TextArena& other);
+    TextArena& operator=(TextArena&& other) noexcept;
+
+    Ref append(std::string_view str);
+    Ref append(std::string_view prefix, std::string_view str, std::string_view suffix); // Склейка без временной строки
+
+    void reserve(size_t bytes); // Следующие bytes байт (не больше 4 ГиБ) поместятся в один блок
+
+    // Переносит блоки other в конец арены без копирования текста. Ссылки из
+    // other остаются верными, если прибавить к их номеру блока результат
+    uint32_t splice(TextArena&& other);
+
+    std::string_view get(Ref ref) const;
+    char* data(Ref ref); // Для правки на месте: длину можно только уменьшать
+
+    void clear();                 // Освобождает все блоки
+    size_t getUsedBytes() const;  // Занято строками, включая перезаписанные
+    size_t getSlabCount() const;
+
+private:
+    struct Slab {
+        std::unique_ptr<char[]> data;
+        size_t size;
+        size_t used;
+    };
+
+    std::vector<Slab> slabs;
+    size_t slabSize;
+    size_t usedBytes;
+
+    char* allocate(size_t length, Ref& ref);
+};
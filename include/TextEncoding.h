@@ -0,0 +1,62 @@
+#pragma once
+#include "TagStripper.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Кодировки текстовых файлов субтитров.
+// Читатели получают текст только в UTF-8: при открытии файла BOM и
+// кодировка определяются по содержимому, а UTF-16 и однобайтовые кодовые
+// страницы Windows перекодируются целиком до разбора. Проверка UTF-8 и
+// пропуск ASCII выполняются векторно, реализация выбирается во время
+// выполнения, как в TagStripper: AVX2 проверяет UTF-8 по таблицам целыми
+// блоками, SSE2 и скалярная версия пропускают ASCII и проверяют
+// многобайтовые последовательности по одной.
+class TextEncoding {
+public:
+    using Kernel = TagStripper::Kernel;
+
+    enum Encoding {
+        ENCODING_AUTO,    // Определить по BOM и содержимому (только для входа)
+        ENCODING_UTF8,
+        ENCODING_UTF16LE,
+        ENCODING_UTF16BE,
+        ENCODING_CP1251,  // Windows-1251, кириллица
+        ENCODING_CP1252,  // Windows-1252, западноевропейские языки
+        ENCODING_UNKNOWN  // Не UTF-8 и не поддерживаемая кодовая страница: байты не меняются
+    };
+
+    // true, если data — корректный UTF-8 (без overlong-форм, суррогатов и кодов больше U+10FFFF)
+    static bool isValidUtf8(std::string_view data);
+
+    // Кодировка по BOM, а без него — по содержимому; bomLength — длина BOM или 0.
+    // UTF-8 с отдельными неверными байтами остаётся UTF-8: кодовая страница
+    // выбирается, только если большая часть старших байтов не разбирается как UTF-8
+    static Encoding detect(std::string_view data, size_t& bomLength);
+
+    // Перекодирует data в UTF-8, BOM отбрасывается. Неверные последовательности
+    // UTF-16 заменяются на U+FFFD, ENCODING_UTF8 и ENCODING_UNKNOWN копируются как есть
+    static std::string toUtf8(std::string_view data, Encoding from);
+    // Перекодирует текст UTF-8 в кодировку to. Символы, которых нет в кодовой
+    // странице, заменяются на '?'; UTF-16 записывается с BOM
+    static std::string fromUtf8(std::string_view utf8, Encoding to);
+
+    // Приводит содержимое входного файла к UTF-8 с учётом setInputEncoding.
+    // Возвращает false, если данные уже в UTF-8 (или кодировка не распознана)
+    // и копия не нужна
+    static bool normalize(std::string_view data, std::string& utf8);
+    // Перекодирует записанный файл UTF-8 в кодировку to (ENCODING_UTF8 — ничего не делает)
+    static void convertFile(const std::string& filename, Encoding to);
+
+    // Кодировка входных файлов для всех читателей, по умолчанию ENCODING_AUTO
+    static void setInputEncoding(Encoding encoding);
+    static Encoding getInputEncoding();
+
+    // "auto", "utf-8", "utf-16le", "utf-16be", "cp1251" ("windows-1251"), "cp1252" ("windows-1252")
+    static bool parseEncoding(const std::string& name, Encoding& encoding);
+    static const char* encodingName(Encoding encoding);
+
+    // Возвращает false, если реализация не поддерживается процессором
+    static bool setKernel(Kernel kernel);
+    static Kernel getKernel();
+};
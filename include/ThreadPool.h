@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с перехватом задач (work stealing).
+// У каждого потока своя очередь: владелец берёт задачи с конца, а
+// освободившиеся потоки забирают их с начала чужих очередей. Задачи,
+// поставленные изнутри задачи, попадают в очередь текущего потока.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(size_t threads = 0); // 0 — по числу ядер
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Task task);
+
+    // Ждёт завершения всех задач и пробрасывает первое исключение из них.
+    // Нельзя вызывать из задачи этого же пула.
+    void wait();
+
+    size_t getSize() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex stateMutex;
+    std::condition_variable wakeUp; // Появились задачи или пул останавливается
+    std::condition_variable idle;   // Все задачи выполнены
+    size_t queued;                  // Задач в очередях
+    size_t pending;                 // Задач поставлено, но не завершено
+    bool stopping;
+    std::exception_ptr firstError;
+    std::atomic<size_t> nextWorker;
+
+    bool popLocal(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+    void execute(Task& task);
+    void run(size_t index);
+};
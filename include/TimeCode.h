@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Быстрое форматирование временных меток прямо в буфер вызывающего.
+// Цифры выводятся парами по таблице "00".."99" без потоков и setw/setfill.
+// Отрицательные значения (после сдвига времени) форматируются медленным
+// путём, побайтно совпадающим с прежним выводом через std::ostringstream.
+class TimeCode {
+public:
+    static const size_t MAX_LENGTH = 64; // Достаточный размер буфера для любой метки
+
+    static size_t formatSRT(int64_t ms, char* out); // "00:01:02,345"
+    static size_t formatVTT(int64_t ms, char* out); // "0:01:02.345"
+    static size_t formatASS(int64_t ms, char* out); // "0:01:02.34" (сотые доли)
+    static size_t formatInt(int64_t value, char* out); // "62345" (SAMI, номера SRT)
+
+    // Длина результата format*() без форматирования (быстрый путь — по числу цифр)
+    static size_t lengthSRT(int64_t ms);
+    static size_t lengthVTT(int64_t ms);
+    static size_t lengthASS(int64_t ms);
+    static size_t lengthInt(int64_t value);
+
+    static std::string toSRT(int64_t ms);
+    static std::string toVTT(int64_t ms);
+    static std::string toASS(int64_t ms);
+};
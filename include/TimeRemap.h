@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Кусочно-линейное отображение времени: смена частоты кадров, исправление
+// линейного дрейфа, подгонка по опорным точкам.
+// Каждое время вычисляется заново из исходного значения по точной
+// рациональной формуле dst + round((t - src) * num / den), поэтому ошибка
+// округления не накапливается и не превышает половины миллисекунды.
+class TimeRemap {
+public:
+    // Участок [from, следующий from): t' = dstBase + round((t - srcBase) * num / den)
+    struct Segment {
+        int64_t from;
+        int64_t srcBase;
+        int64_t dstBase;
+        int64_t num;
+        int64_t den;
+    };
+
+    TimeRemap(); // Тождественное отображение
+
+    // t' = t * num / den + offsetMs
+    static TimeRemap linear(int64_t num, int64_t den, int64_t offsetMs);
+    // Пересчёт из одной частоты кадров в другую: "25", "23.976", "24000/1001"
+    static TimeRemap framerate(const std::string& fromFps, const std::string& toFps);
+    // Опорные точки (исходное время, новое время); вне крайних точек
+    // продолжаются крайние участки
+    static TimeRemap anchors(std::vector<std::pair<int64_t, int64_t>> points);
+
+    // "fps:<from>:<to>", "linear:<scale>:<offset_ms>", "anchors:<src>=<dst>,<src>=<dst>,..."
+    static TimeRemap parse(const std::string& spec);
+
+    // То же отображение, за которым следует сдвиг на deltaMs (одним проходом)
+    TimeRemap shifted(int64_t deltaMs) const;
+
+    bool isIdentity() const;
+    const std::vector<Segment>& getSegments() const;
+    size_t findSegment(int64_t t, size_t hint) const; // hint — участок предыдущего значения
+
+    int64_t map(int64_t t) const;
+    int64_t map(int64_t t, size_t& hint) const; // hint обновляется найденным участком
+
+private:
+    std::vector<Segment> segments;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include "TagStripper.h"
+#include "TimeRemap.h"
+#include <cstddef>
+#include <cstdint>
+
+// Векторные операции над столбцами времени SubtitleEntryList.
+// start и end — массивы одной длины; пара -1/-1 (заметка VTT) при
+// skipNotes остаётся без изменений. Реализация выбирается во время
+// выполнения, как в TagStripper: AVX2 или скалярная (в SSE2 нет
+// 64-битных сравнений, поэтому KERNEL_SSE2 использует скалярную версию).
+class TimeShifter {
+public:
+    using Kernel = TagStripper::Kernel;
+
+    static void shift(int64_t* start, int64_t* end, size_t count, int64_t deltaMs,
+                      bool shiftStart, bool shiftEnd, bool skipNotes);
+
+    // Ограничивает времена отрезком [minMs, maxMs]
+    static void clamp(int64_t* start, int64_t* end, size_t count, int64_t minMs, int64_t maxMs, bool skipNotes);
+
+    // Применяет remap к обоим столбцам за один проход. Блоки, где точный
+    // результат гарантирован в double (|t * num| < 2^50), считаются AVX2,
+    // остальные — скалярно в 128-битной арифметике; результат одинаков.
+    static void remap(int64_t* start, int64_t* end, size_t count, const TimeRemap& remap, bool skipNotes);
+
+    // Возвращает false, если реализация не поддерживается процессором
+    static bool setKernel(Kernel kernel);
+    static Kernel getKernel();
+};
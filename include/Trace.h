@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Временная шкала конвертации в формате Chrome trace events
+// (chrome://tracing, ui.perfetto.dev): у каждого потока своя дорожка.
+//
+// Точки трассировки ставятся макросом TRACE_SCOPE("имя") или
+// TRACE_SCOPE_DETAIL("имя", строка). Без SUBTITLE_ENABLE_TRACING макросы
+// раскрываются в пустоту и не стоят ничего; со сборкой трассировки, но
+// без Trace::start(), каждая точка — одна проверка флага.
+class Trace {
+public:
+    static void start();                           // Начать запись событий
+    static void stop();                            // Перестать записывать (события сохраняются)
+    static void write(const std::string& filename); // JSON всех записанных событий
+    static void clear();
+
+    static bool isActive() { return active.load(std::memory_order_relaxed); }
+    static bool isCompiledIn();                    // Собрано ли с SUBTITLE_ENABLE_TRACING
+
+    // Имя дорожки текущего потока; без него — "thread N"
+    static void setThreadName(const std::string& name);
+
+    class Scope {
+    private:
+        const char* name;
+        uint64_t startNs; // 0 — трассировка не была активна при входе
+        std::string detail;
+
+    public:
+        explicit Scope(const char* name) : name(name), startNs(isActive() ? now() : 0) {}
+        Scope(const char* name, const std::string& detail)
+            : name(name), startNs(isActive() ? now() : 0), detail(startNs ? detail : std::string()) {}
+        ~Scope() {
+            if (startNs) record(name, startNs, now(), detail);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    static std::atomic<bool> active;
+
+    static uint64_t now();
+    static void record(const char* name, uint64_t startNs, uint64_t endNs, const std::string& detail);
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef SUBTITLE_ENABLE_TRACING
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_SCOPE_DETAIL(name, detail) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name, detail)
+#define TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_DETAIL(name, detail) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+#include "RichText.h"
+#include "SubtitleEntry.h"
+#include "SubtitleEntryList.h"
+#include "TimeRemap.h"
+#include <cstdint>
+#include <string>
+
+// Набор преобразований записей, применяемый за один проход: пересчёт
+// времени, сдвиг, удаление форматирования и стиль. Порядок всегда один —
+// remap, shift, удаление разметки, обёртка стилем.
+//
+// Времена меняются одним проходом по столбцам: сдвиг после remap входит
+// в сам remap. Текст каждой записи правится один раз: разметка удаляется
+// на месте, обёртка стилем добавляется с одним выделением памяти (в арене —
+// одним добавлением), так что несколько опций стоят почти как одна.
+//
+// После setMarkup текст каждой записи разбирается в RichText: удаление
+// разметки и стили b/i/u/s становятся правками отрезков, а результат
+// выводится разметкой выходного формата, так что оформление сохраняется
+// при конвертации между форматами.
+class TransformPipeline {
+public:
+    using TextEditor = SubtitleEntryList::TextEditor;
+
+    TransformPipeline(); // Пустой: ничего не меняет
+
+    void setRemap(const TimeRemap& remap);
+    void setShift(int64_t deltaMs);
+    void setRemoveFormatting(bool remove);
+    void setStyle(const std::string& style); // Пустая строка — без стиля
+    void setMarkup(RichText::Markup from, RichText::Markup to); // Перевод разметки через RichText
+
+    const TimeRemap& getRemap() const;
+    int64_t getShift() const;
+    bool getRemoveFormatting() const;
+    const std::string& getStyle() const;
+    bool convertsMarkup() const;
+
+    bool isEmpty() const;
+    bool changesTimes() const;
+    bool changesText() const;
+
+    // stripper — удаление разметки формата (TagStripper::removeHtmlTags или removeAssTags).
+    // При skipNotes времена записей -1/-1 (заметки VTT) не меняются
+    void apply(SubtitleEntryList& entries, TextEditor stripper, bool skipNotes) const;
+    void apply(SubtitleEntry& entry, TextEditor stripper, bool skipNotes) const; // Одна запись (потоковый режим)
+
+private:
+    TimeRemap remap;
+    int64_t shiftMs;
+    bool removeFormatting;
+    std::string style;
+    std::string prefix; // "<style>"
+    std::string suffix; // "</style>"
+    uint8_t styleFlags; // Флаг RichText для стиля b/i/u/s, иначе 0
+    bool richText;
+    RichText::Markup fromMarkup;
+    RichText::Markup toMarkup;
+
+    std::string convertMarkup(std::string_view text) const;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include "SubtitleEntryList.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Нарезка дорожки WebVTT на сегменты HLS одним проходом.
+// Записи подаются по возрастанию начала (add), каждый сегмент пишется,
+// как только следующая запись начинается после его конца. Запись,
+// пересекающая границу, повторяется во всех сегментах, которые она
+// задевает; времена в сегментах абсолютные, X-TIMESTAMP-MAP связывает
+// LOCAL 0 с MPEGTS. В конце пишется медиаплейлист.
+//
+// Запись, которая начинается раньше уже записанного сегмента, в него не
+// попадёт: segmenter помечается неупорядоченным (isOrdered), а finish()
+// бросает исключение вместо того, чтобы молча её потерять.
+class VTTSegmenter {
+public:
+    struct Options {
+        std::string outputDir;
+        int64_t segmentMs;         // Длительность сегмента
+        int64_t mpegts;            // MPEGTS (90 кГц), соответствующий LOCAL 00:00:00.000
+        int64_t durationMs;        // Длительность дорожки, 0 — до конца последней записи
+        std::string segmentPrefix; // Сегменты: <prefix><N>.vtt
+        std::string playlistName;
+
+        Options();
+    };
+
+    explicit VTTSegmenter(const Options& options);
+
+    void add(const SubtitleEntryView& entry); // Заметки (-1/-1) и записи, закончившиеся до нуля, пропускаются
+    void finish();                            // Дописывает сегменты и плейлист
+
+    bool isOrdered() const; // false, если пришла запись раньше уже записанного сегмента
+
+    size_t getSegmentCount() const;
+
+    // Нарезка загруженной дорожки: записи упорядочиваются по началу
+    static void segment(const SubtitleEntryList& entries, const Options& options);
+    // Потоковая нарезка файла SRT, VTT или SAMI; ASS читается целиком.
+    // Неупорядоченный файл читается повторно целиком и нарезается через segment()
+    static void segmentFile(const std::string& inFile, const Options& options);
+
+private:
+    struct Cue {
+        int64_t start_ms;
+        int64_t end_ms;
+        std::string text;
+    };
+
+    Options options;
+    std::vector<Cue> active;          // Записи, ещё не дошедшие до конца
+    std::vector<int64_t> durations;   // Длительности записанных сегментов
+    int64_t lastEnd;
+    bool finished;
+    bool ordered;
+
+    void writeSegment(int64_t segmentEnd);
+};
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "SubtitleEntryList.h"
+#include "TransformPipeline.h"
 #include "SRTSubtitle.h"
+#include "VTTSegmenter.h"
+#include "MappedFile.h"
 #include <string>
 
 class VTTSubtitle {
@@ -11,12 +14,27 @@ private:
     static int64_t parseTime(const std::string& timeStr); // Конвертирует строку времени "00:01:02.345" в миллисекунды
     static std::string formatTime(int64_t ms);           // Конвертирует миллисекунды в строку времени "00:01:02.345"
 
+    static void readHeader(LineReader& in);              // Проверяет строку "WEBVTT"
+    // file — для освобождения прочитанных страниц, nullptr при разборе по частям
+    static void parseCues(LineReader& in, bool keepNotes, const EntrySink& sink, MappedFile* file);
+
 public:
-    void read(const std::string& filename, bool keepNotes);              // Читает VTT-файл
-    void write(const std::string& filename) const;       // Пишет VTT-файл
+    // Читает VTT-файл; threads != 1 — по частям на нескольких потоках (0 — по числу ядер)
+    void read(const std::string& filename, bool keepNotes, size_t threads = 1);
+    void write(const std::string& filename, size_t threads = 1) const; // Пишет VTT-файл, threads != 1 — на нескольких потоках
+    void writeSegments(const VTTSegmenter::Options& options) const; // Пишет сегменты HLS и плейлист
     SubtitleEntryList& getEntries();                     // Возвращает список субтитров и заметок
 
+    // Потоковый режим: записи передаются в sink без накопления в списке
+    void readStream(const std::string& filename, bool keepNotes, const EntrySink& sink);
+    static void writeHeader(BufferedWriter& out);
+    static void writeEntry(BufferedWriter& out, const SubtitleEntryView& entry, size_t index);
+    static size_t entrySize(const SubtitleEntryView& entry, size_t index); // Байт, которые запишет writeEntry
+    static void writeFooter(BufferedWriter& out);
+
     void removeFormatting();                             // Удаляет HTML-теги из текста субтитров
     void addDefaultStyle(const std::string& style);      // Добавляет стиль к каждому тексту
     void shiftTime(int64_t delta_ms, TimeShiftType type);// Сдвигает временные метки
+    void remapTime(const TimeRemap& remap);              // Смена частоты кадров, исправление дрейфа
+    void transform(const TransformPipeline& pipeline);   // Все преобразования за один проход
 };
\ No newline at end of file
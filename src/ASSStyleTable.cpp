@@ -0,0 +1,35 @@
+#include "ASSStyleTable.h"
+#include <utility>
+
+// Ключи копии должны указывать на её собственные строки, поэтому индекс строится заново
+ASSStyleTable::ASSStyleTable(const ASSStyleTable& other) {
+    styles.reserve(other.styles.size());
+    index.reserve(other.styles.size());
+    for (const auto& style : other.styles) add(ASSStyle(*style));
+}
+
+ASSStyleTable& ASSStyleTable::operator=(const ASSStyleTable& other) {
+    if (this != &other)
+        *this = ASSStyleTable(other);
+    return *this;
+}
+
+void ASSStyleTable::add(ASSStyle&& style) {
+    styles.push_back(std::make_unique<ASSStyle>(std::move(style)));
+    index[styles.back()->name] = styles.size() - 1;
+}
+
+size_t ASSStyleTable::indexOf(std::string_view name) const {
+    auto it = index.find(name);
+    return it == index.end() ? npos : it->second;
+}
+
+const ASSStyle* ASSStyleTable::find(std::string_view name) const {
+    size_t i = indexOf(name);
+    return i == npos ? nullptr : styles[i].get();
+}
+
+void ASSStyleTable::clear() {
+    index.clear();
+    styles.clear();
+}
@@ -1,53 +1,72 @@
 #include "ASSSubtitle.h"
-#include <fstream>
-#include <sstream>
-#include <iomanip>
-#include <regex>
+#include "PhaseStats.h"
+#include "Trace.h"
+#include "TagStripper.h"
+#include "MappedFile.h"
+#include "BufferedWriter.h"
+#include "ParallelWriter.h"
+#include "TimeCode.h"
 #include <stdexcept>
 #include <cstring>
+#include <utility>
+#include <cctype>
+#include <unordered_set>
 
-ASSSubtitle::ASSSubtitle() : stylesCount(0) {}
+const char* ASSSubtitle::DEFAULT_STYLE =
+    ",Arial,48,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,-1,0,0,0,100,100,0,0,1,2.0,2.0,2,10,10,10,1\n";
 
-int64_t ASSSubtitle::parseTime(const std::string& timeStr) {
-    std::string trimmed = timeStr;
-    trimmed.erase(0, trimmed.find_first_not_of(" \t\r\n"));
-    trimmed.erase(trimmed.find_last_not_of(" \t\r\n") + 1);
+ASSSubtitle::ASSSubtitle() : keepMarkup(false) {}
+
+// Разбор целого числа в стиле sscanf("%d"): пробелы, знак, хотя бы одна цифра
+static bool parseInt(std::string_view& str, int& value) {
+    size_t i = 0;
+    while (i < str.size() && std::isspace(static_cast<unsigned char>(str[i]))) ++i;
+
+    bool negative = false;
+    if (i < str.size() && (str[i] == '-' || str[i] == '+')) negative = str[i++] == '-';
+
+    size_t digitsStart = i;
+    int result = 0;
+    while (i < str.size() && str[i] >= '0' && str[i] <= '9') result = result * 10 + (str[i++] - '0');
+    if (i == digitsStart) return false;
+
+    value = negative ? -result : result;
+    str.remove_prefix(i);
+    return true;
+}
+
+static bool expectChar(std::string_view& str, char c) {
+    if (str.empty() || str.front() != c) return false;
+    str.remove_prefix(1);
+    return true;
+}
+
+int64_t ASSSubtitle::parseTime(std::string_view timeStr) {
+    std::string_view rest = LineReader::trim(timeStr);
 
     int h, m, s, ms;
-    int parsed = std::sscanf(trimmed.c_str(), "%d:%d:%d.%d", &h, &m, &s, &ms);
-    if (parsed != 4) {
-        throw std::runtime_error("Invalid time format: " + timeStr);
+    if (!parseInt(rest, h) || !expectChar(rest, ':') || !parseInt(rest, m) || !expectChar(rest, ':') ||
+        !parseInt(rest, s) || !expectChar(rest, '.') || !parseInt(rest, ms)) {
+        throw std::runtime_error("Invalid time format: " + std::string(timeStr));
     }
     return ((h * 60 + m) * 60 + s) * 1000 + ms;
 }
 
 std::string ASSSubtitle::formatTime(int64_t ms) const {
-    int h = static_cast<int>(ms / 3600000);
-    ms %= 3600000;
-    int m = static_cast<int>(ms / 60000);
-    ms %= 60000;
-    int s = static_cast<int>(ms / 1000);
-    ms %= 1000;
-    int cs = static_cast<int>(ms / 10);
-
-    std::ostringstream oss;
-    oss << h << ":"
-        << std::setw(2) << std::setfill('0') << m << ":"
-        << std::setw(2) << std::setfill('0') << s << "."
-        << std::setw(2) << std::setfill('0') << cs;
-    return oss.str();
+    return TimeCode::toASS(ms);
 }
 
-void ASSSubtitle::read(const std::string& filename) {
-    std::ifstream in(filename, std::ios::binary);
-    if (!in) {
-        throw std::runtime_error("Cannot open file: " + filename);
-    }
+void ASSSubtitle::read(const std::string& filename, bool keepMarkup) {
+    PhaseStats::Scope phase(PhaseStats::PARSE);
+    TRACE_SCOPE("ASSSubtitle::read");
+    this->keepMarkup = keepMarkup;
+    MappedFile file(filename);
+    file.decodeText();
+    LineReader in(file.view());
 
-    std::string line;
-    while (std::getline(in, line)) {
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
+    std::string_view line;
+    while (in.getLine(line)) {
+        line = LineReader::trim(line);
 
         if (line.empty()) continue;
 
@@ -68,28 +87,31 @@ SubtitleEntryList& ASSSubtitle::getEntries() {
     return entries;
 }
 
-void ASSSubtitle::parseScriptInfo(std::ifstream& in) {
-    std::string line;
+const ASSStyleTable& ASSSubtitle::getStyles() const {
+    return styles;
+}
+
+const ASSStyle* ASSSubtitle::findStyle(std::string_view name) const {
+    return styles.find(name);
+}
+
+void ASSSubtitle::parseScriptInfo(LineReader& in) {
+    TRACE_SCOPE("ASSSubtitle::parseScriptInfo");
+    std::string_view line;
     while (true) {
-        std::streampos pos = in.tellg();
-        if (!std::getline(in, line)) break;
+        size_t pos = in.tell();
+        if (!in.getLine(line)) break;
         if (line.empty()) continue;
 
         if (line.front() == '[') {
-            in.seekg(pos);
+            in.seek(pos);
             break;
         }
 
         auto posColon = line.find(':');
-        if (posColon != std::string::npos) {
-            std::string key = line.substr(0, posColon);
-            std::string value = line.substr(posColon + 1);
-            auto trimFunc = [](std::string &str) {
-                str.erase(0, str.find_first_not_of(" \t\r\n"));
-                str.erase(str.find_last_not_of(" \t\r\n") + 1);
-            };
-            trimFunc(key);
-            trimFunc(value);
+        if (posColon != std::string_view::npos) {
+            std::string_view key = LineReader::trim(line.substr(0, posColon));
+            std::string_view value = LineReader::trim(line.substr(posColon + 1));
 
             // Сохраняем ключ-значение в scriptInfo
             if (key == "Title") {
@@ -113,42 +135,42 @@ void ASSSubtitle::parseScriptInfo(std::ifstream& in) {
     }
 }
 
-void ASSSubtitle::parseStyles(std::ifstream& in) {
-    std::string line;
+void ASSSubtitle::parseStyles(LineReader& in) {
+    TRACE_SCOPE("ASSSubtitle::parseStyles");
+    std::string_view line;
     while (true) {
-        std::streampos pos = in.tellg();
-        if (!std::getline(in, line)) break;
+        size_t pos = in.tell();
+        if (!in.getLine(line)) break;
         if (line.empty()) continue;
         if (line.front() == '[') {
-            in.seekg(pos);
+            in.seek(pos);
             break;
         }
 
-        std::string trimmed = line;
-        auto trimFunc = [](std::string &str) {
-            str.erase(0, str.find_first_not_of(" \t\r\n"));
-            str.erase(str.find_last_not_of(" \t\r\n") + 1);
-        };
-        trimFunc(trimmed);
+        std::string_view view = LineReader::trim(line);
 
-        if (trimmed.rfind("Style:", 0) == 0) {
-            Style st;
+        if (view.substr(0, 6) == "Style:") {
+            std::string trimmed(view); // sscanf нужна строка с завершающим нулём
+            ASSStyle st;
             char name[100]{}, fontname[100]{}, primaryColour[100]{}, secondaryColour[100]{};
             char outlineColour[100]{}, backColour[100]{};
+            char fontsize[100]{}, scaleX[100]{}, scaleY[100]{}, spacing[100]{}, angle[100]{};
+            char outline[100]{}, shadow[100]{};
 
+            // Дробные поля ("2.0") читаются как текст: %d остановился бы на точке
             int parsed = std::sscanf(
                 trimmed.c_str(),
-                "Style: %99[^,],%99[^,],%d,%99[^,],%99[^,],%99[^,],%99[^,],%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d",
+                "Style: %99[^,],%99[^,],%99[^,],%99[^,],%99[^,],%99[^,],%99[^,],%d,%d,%d,%d,%99[^,],%99[^,],%99[^,],%99[^,],%d,%99[^,],%99[^,],%d,%d,%d,%d,%d",
                 name, fontname,
-                &st.fontsize,
+                fontsize,
                 primaryColour, secondaryColour, outlineColour, backColour,
                 &st.bold, &st.italic, &st.underline, &st.strikeOut,
-                &st.scaleX, &st.scaleY, &st.spacing, &st.angle,
-                &st.borderStyle, &st.outline, &st.shadow, &st.alignment,
+                scaleX, scaleY, spacing, angle,
+                &st.borderStyle, outline, shadow, &st.alignment,
                 &st.marginL, &st.marginR, &st.marginV, &st.encoding
             );
 
-            if (parsed < 24) {
+            if (parsed < 23) {
                 continue;
             }
 
@@ -158,99 +180,164 @@ void ASSSubtitle::parseStyles(std::ifstream& in) {
             st.secondaryColour = secondaryColour;
             st.outlineColour = outlineColour;
             st.backColour = backColour;
-
-            if (stylesCount < MAX_STYLES) {
-                styles[stylesCount++] = st;
-            }
+            st.fontsize = fontsize;
+            st.scaleX = scaleX;
+            st.scaleY = scaleY;
+            st.spacing = spacing;
+            st.angle = angle;
+            st.outline = outline;
+            st.shadow = shadow;
+
+            styles.add(std::move(st));
         }
     }
 }
 
-void ASSSubtitle::parseDialogue(const std::string &line) {
-    if (line.find("Dialogue:") != 0) {
-        return; // Пропускаем строки, которые не начинаются с "Dialogue:"
-    }
-
-    std::string after = line.substr(9);
-    after.erase(0, after.find_first_not_of(" \t\r\n"));
+// Порядок полей Dialogue по умолчанию (ASS v4.00+ и SSA v4.00):
+// Layer/Marked, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text
+ASSSubtitle::EventFormat::EventFormat()
+    : fieldCount(10), layerField(0), startField(1), endField(2), styleField(3) {}
 
-    std::string fields[MAX_DIALOGUE_FIELDS];
-    size_t fieldCount = 0;
+void ASSSubtitle::parseEventFormat(std::string_view line) {
+    TRACE_SCOPE("ASSSubtitle::parseEventFormat");
+    std::string_view rest = LineReader::trim(line.substr(7)); // После "Format:"
 
-    // Разделяем строку на поля по запятым
-    std::stringstream ss(after);
-    std::string field;
+    EventFormat format;
+    format.layerField = format.startField = format.endField = format.styleField = std::string_view::npos;
+    size_t textField = std::string_view::npos;
 
-    while (std::getline(ss, field, ',') && fieldCount < MAX_DIALOGUE_FIELDS) {
-        fields[fieldCount++] = field;
+    size_t index = 0;
+    while (true) {
+        size_t comma = rest.find(',');
+        std::string_view name = LineReader::trim(rest.substr(0, comma));
+
+        if (name == "Layer" || name == "Marked") format.layerField = index;
+        else if (name == "Start") format.startField = index;
+        else if (name == "End") format.endField = index;
+        else if (name == "Style") format.styleField = index;
+        else if (name == "Text") textField = index;
+        ++index;
+
+        if (comma == std::string_view::npos) break;
+        rest.remove_prefix(comma + 1);
     }
 
-    if (fieldCount < 10) {
-        return; // Недостаточно полей для корректного парсинга
+    // Text по спецификации всегда последнее поле: запятые в нём не разделяют поля
+    if (format.startField == std::string_view::npos || format.endField == std::string_view::npos ||
+        textField != index - 1) {
+        return; // Некорректная строка Format — оставляем прежний порядок полей
     }
+    format.fieldCount = index;
+    eventFormat = format;
+}
 
-    // Проверяем поле "Marked="
-    if (fields[0].find("Marked=") != std::string::npos) {
-        fields[0] = fields[0].substr(fields[0].find('=') + 1); // Удаляем "Marked="
+void ASSSubtitle::parseDialogue(std::string_view line) {
+    TRACE_SCOPE("ASSSubtitle::parseDialogue");
+    if (line.substr(0, 9) != "Dialogue:") {
+        return; // Пропускаем строки, которые не начинаются с "Dialogue:"
     }
 
-    try {
-        Dialogue dlg;
-        dlg.layer = std::stoi(fields[0]);
-        dlg.start = fields[1];
-        dlg.end = fields[2];
-        dlg.style = fields[3];
-        dlg.name = fields[4];
-        dlg.marginL = fields[5];
-        dlg.marginR = fields[6];
-        dlg.marginV = fields[7];
-        dlg.effect = fields[8];
-
-        // Объединяем текстовые поля, если текст содержит запятые
-        dlg.text = fields[9];
-        for (size_t i = 10; i < fieldCount; ++i) {
-            dlg.text += "," + fields[i];
+    std::string_view rest = line.substr(9);
+    size_t first = rest.find_first_not_of(" \t\r\n");
+    rest.remove_prefix(first == std::string_view::npos ? rest.size() : first);
+
+    // Разделяем строку на поля по запятым без копирования; всё после
+    // последнего разделителя — текст, даже если в нём есть запятые
+    std::string_view layer, start, end, style;
+    for (size_t i = 0; i + 1 < eventFormat.fieldCount; ++i) {
+        size_t comma = rest.find(',');
+        if (comma == std::string_view::npos) {
+            return; // Недостаточно полей для корректного парсинга
         }
 
-        // Обрабатываем специальные символы в тексте
-        dlg.text = std::regex_replace(dlg.text, std::regex("\\\\N"), "\n"); // Перенос строки
-        dlg.text = std::regex_replace(dlg.text, std::regex("\\{[^}]*\\}"), ""); // Удаляем теги формата
+        std::string_view field = rest.substr(0, comma);
+        if (i == eventFormat.layerField) layer = field;
+        else if (i == eventFormat.startField) start = field;
+        else if (i == eventFormat.endField) end = field;
+        else if (i == eventFormat.styleField) style = LineReader::trim(field);
+        rest.remove_prefix(comma + 1);
+    }
+    std::string_view text = rest;
+
+    // Совместимость с прежним разбором через std::getline: пустое последнее
+    // поле не считалось, поэтому строка без текста пропускается, а одна
+    // завершающая запятая текста отбрасывается (на это рассчитаны refSUBs)
+    if (text.empty()) return;
+    if (text.back() == ',') text.remove_suffix(1);
+
+    // Проверяем поле Layer (или "Marked=" в SSA)
+    if (eventFormat.layerField != std::string_view::npos) {
+        size_t marked = layer.find("Marked=");
+        if (marked != std::string_view::npos) {
+            layer.remove_prefix(layer.find('=', marked) + 1); // Удаляем "Marked="
+        }
+        int layerValue;
+        if (!parseInt(layer, layerValue)) return;
+    }
 
-        // Преобразуем временные метки в миллисекунды
+    try {
         SubtitleEntry entry;
-        entry.start_ms = parseTime(dlg.start);
-        entry.end_ms = parseTime(dlg.end);
-        entry.text = dlg.text;
+        entry.start_ms = parseTime(start);
+        entry.end_ms = parseTime(end);
+        // Стиль хранится в formatting; Default (и "*Default" из SSA) — пустой
+        // строкой, чтобы в режиме арены запись не попадала в таблицу редких полей
+        if (style.size() && style.front() == '*') style.remove_prefix(1);
+        if (style != "Default") entry.formatting.assign(style.data(), style.size());
+
+        if (keepMarkup) {
+            entry.text.assign(text.data(), text.size());
+            entries.push_back(std::move(entry));
+            return;
+        }
 
-        entries.push_back(entry);
+        // Один проход по тексту: "\N" -> перенос строки, теги формата {...} удаляются
+        std::string& out = entry.text;
+        out.reserve(text.size());
+        bool hasClosingBrace = true;
+        for (size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if (c == '\\' && i + 1 < text.size() && text[i + 1] == 'N') {
+                out += '\n';
+                ++i;
+            } else if (c == '{' && hasClosingBrace) {
+                size_t close = text.find('}', i + 1);
+                if (close == std::string_view::npos) {
+                    hasClosingBrace = false; // Незакрытый тег остаётся как есть
+                    out += c;
+                } else {
+                    i = close;
+                }
+            } else {
+                out += c;
+            }
+        }
+
+        entries.push_back(std::move(entry));
     } catch (...) {
         // Игнорируем ошибки парсинга
     }
 }
 
-void ASSSubtitle::parseEvents(std::ifstream& in) {
-    std::string line;
-    while (std::getline(in, line)) {
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
+void ASSSubtitle::parseEvents(LineReader& in) {
+    TRACE_SCOPE("ASSSubtitle::parseEvents");
+    std::string_view line;
+    while (in.getLine(line)) {
+        line = LineReader::trim(line);
 
         if (line.empty()) continue;
         if (line.front() == '[') {
             break;
         }
 
-        if (line.find("Dialogue:") == 0) {
+        if (line.substr(0, 9) == "Dialogue:") {
             parseDialogue(line);
+        } else if (line.substr(0, 7) == "Format:") {
+            parseEventFormat(line);
         }
     }
 }
 
-void ASSSubtitle::write(const std::string& filename) const {
-    std::ofstream out(filename);
-    if (!out) {
-        throw std::runtime_error("Cannot write file: " + filename);
-    }
-
+void ASSSubtitle::writeHeader(BufferedWriter& out) const {
     out << "[Script Info]\n";
     out << "; Script generated by ASSSubtitle class\n";
     out << "Title: " << (scriptInfo.title.empty() ? "Default ASS file" : scriptInfo.title) << "\n";
@@ -265,11 +352,11 @@ void ASSSubtitle::write(const std::string& filename) const {
     out << "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n";
 
     // Если нет стилей, добавляем стиль по умолчанию
-    if (stylesCount == 0) {
-        out << "Style: Default,Arial,48,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,-1,0,0,0,100,100,0,0,1,2.0,2.0,2,10,10,10,1\n";
+    if (styles.isEmpty()) {
+        out << "Style: Default" << DEFAULT_STYLE;
     } else {
-        for (int i = 0; i < stylesCount; ++i) {
-            const Style &st = styles[i];
+        for (size_t i = 0; i < styles.getSize(); ++i) {
+            const ASSStyle &st = styles[i];
             out << "Style: "
                 << st.name << ","
                 << st.fontname << ","
@@ -298,46 +385,85 @@ void ASSSubtitle::write(const std::string& filename) const {
         }
     }
 
-    out << "\n[Events]\n";
+    // Стили, на которые ссылаются события, но которых нет в таблице,
+    // получают параметры стиля по умолчанию
+    std::unordered_set<std::string_view> missing;
     for (size_t i = 0; i < entries.getSize(); ++i) {
-        const auto &e = entries[i];
-        out << "Dialogue: 0,"
-            << formatTime(e.start_ms) << ","
-            << formatTime(e.end_ms)
-            << ",Default,,0,0,0,,"
-            << e.text
-            << "\n";
+        std::string_view name = entries.view(i).formatting;
+        if (name.empty()) name = "Default";
+        if ((name != "Default" || !styles.isEmpty()) && !styles.find(name) && missing.insert(name).second) {
+            out << "Style: " << name << DEFAULT_STYLE;
+        }
     }
+
+    out << "\n[Events]\n";
 }
 
+void ASSSubtitle::writeEntry(BufferedWriter& out, const SubtitleEntryView& e, size_t) {
+    // Метки времени пишутся прямо в буфер вывода
+    char* p = out.reserve(2 * TimeCode::MAX_LENGTH + 32);
+    size_t n = 0;
+    std::memcpy(p, "Dialogue: 0,", 12);
+    n += 12;
+    n += TimeCode::formatASS(e.start_ms, p + n);
+    p[n++] = ',';
+    n += TimeCode::formatASS(e.end_ms, p + n);
+    p[n++] = ',';
+    out.commit(n);
+
+    out << (e.formatting.empty() ? std::string_view("Default") : e.formatting) << ",,0,0,0,," << e.text << '\n';
+}
 
-void ASSSubtitle::removeFormatting() {
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        auto& entry = entries[i];
+size_t ASSSubtitle::entrySize(const SubtitleEntryView& e, size_t) {
+    size_t style = e.formatting.empty() ? 7 : e.formatting.size();
+    return 12 + TimeCode::lengthASS(e.start_ms) + 1 + TimeCode::lengthASS(e.end_ms) + 1 + style + 9 + e.text.size() + 1;
+}
 
-        // Удаляем переносы строк (\N) и заменяем их на пробелы
-        entry.text = std::regex_replace(entry.text, std::regex("\\\\N"), "");
+void ASSSubtitle::write(const std::string& filename, size_t threads) const {
+    PhaseStats::Scope phase(PhaseStats::FORMAT);
+    TRACE_SCOPE("ASSSubtitle::write");
+    PhaseStats::addCues(entries.getSize());
+    if (threads != 1) {
+        BufferedWriter header(4096);
+        writeHeader(header);
+        if (ParallelWriter::write(filename, entries, header.view(), "", entrySize, writeEntry, threads)) return;
+    }
+    BufferedWriter out(filename);
 
-        // Удаляем теги формата {…} (например, {\\i1}, {\\b0})
-        entry.text = std::regex_replace(entry.text, std::regex("\\{[^}]*\\}"), "");
-        entries[i].text = std::regex_replace(entries[i].text, std::regex("\\\\"), "");
-        // Если нужно, можно добавить другие виды очистки текста
+    writeHeader(out);
+    for (size_t i = 0; i < entries.getSize(); ++i) {
+        writeEntry(out, entries.view(i), i);
     }
+    out.close();
+}
+
+
+void ASSSubtitle::removeFormatting() {
+    TransformPipeline pipeline;
+    pipeline.setRemoveFormatting(true);
+    transform(pipeline);
 }
 
 void ASSSubtitle::addDefaultStyle(const std::string& styleName) {
-    for (size_t i = 0; i < entries.getSize(); i++) {
-        entries[i].text = "<" + styleName + ">" + entries[i].text + "</" + styleName + ">";
-    }
+    TransformPipeline pipeline;
+    pipeline.setStyle(styleName);
+    transform(pipeline);
 }
 
 void ASSSubtitle::shiftTime(int64_t deltaMs, TimeShiftType type) {
-    for (size_t i = 0; i < entries.getSize(); i++) {
-        if (type == START_ONLY || type == START_END) {
-            entries[i].start_ms += deltaMs;
-        }
-        if (type == END_ONLY || type == START_END) {
-            entries[i].end_ms += deltaMs;
-        }
-    }
+    PhaseStats::Scope phase(PhaseStats::SHIFT);
+    TRACE_SCOPE("ASSSubtitle::shiftTime");
+    entries.shiftTimes(deltaMs, type == START_END || type == START_ONLY, type == START_END || type == END_ONLY, false);
+}
+
+void ASSSubtitle::remapTime(const TimeRemap& remap) {
+    PhaseStats::Scope phase(PhaseStats::SHIFT);
+    TRACE_SCOPE("ASSSubtitle::remapTime");
+    entries.remapTimes(remap, false);
+}
+
+void ASSSubtitle::transform(const TransformPipeline& pipeline) {
+    // Удаляем переносы строк (\N), теги формата {…} (например, {\i1}, {\b0})
+    // и оставшиеся обратные слэши за один проход
+    pipeline.apply(entries, TagStripper::removeAssTags, false);
 }
\ No newline at end of file
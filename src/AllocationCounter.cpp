@@ -0,0 +1,27 @@
+#include "PhaseStats.h"
+#include <cstdlib>
+#include <new>
+
+// Счётчик выделений для PhaseStats: замена глобального operator new.
+// Остальные формы (new[], nothrow) в libstdc++ вызывают эту; выровненные
+// формы не считаются. Файл не входит в SUBTITLE_SOURCES: замена нужна
+// только программе (--stats) и тестам, а библиотека, бенчмарки и
+// приложения со своим operator new её не получают.
+void* operator new(std::size_t size) {
+    ++PhaseStats::allocationCount;
+    if (size == 0) size = 1;
+    while (true) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
@@ -0,0 +1,159 @@
+#include "BatchConverter.h"
+#include "LineReader.h"
+#include "MappedFile.h"
+#include "StreamConverter.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <numeric>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+bool isSubtitleExtension(const std::string& extension) {
+    return extension == "srt" || extension == "vtt" || extension == "smi" ||
+           extension == "ass" || extension == "ssa" || extension == "subbin";
+}
+
+void replaceAll(std::string& text, const std::string& from, const std::string& to) {
+    for (size_t pos = text.find(from); pos != std::string::npos; pos = text.find(from, pos + to.size()))
+        text.replace(pos, from.size(), to);
+}
+
+} // namespace
+
+BatchConverter::Options::Options() : jobs(0), streamThreshold(64ull << 20) {}
+
+std::vector<std::string> BatchConverter::collectInputs(const std::string& source) {
+    std::vector<std::string> inputs;
+
+    std::error_code error;
+    if (fs::is_directory(source, error)) {
+        for (const fs::directory_entry& entry : fs::directory_iterator(source)) {
+            if (!entry.is_regular_file(error)) continue;
+            std::string path = entry.path().string();
+            if (isSubtitleExtension(Converter::extensionOf(path)))
+                inputs.push_back(path);
+        }
+        // Порядок обхода каталога не определён
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    MappedFile list(source);
+    LineReader reader(list.view());
+    std::string_view line;
+    while (reader.getLine(line)) {
+        line = LineReader::trim(line);
+        if (!line.empty())
+            inputs.emplace_back(line);
+    }
+    return inputs;
+}
+
+std::string BatchConverter::makeOutputPath(const std::string& input, const std::string& pattern, const std::string& format) {
+    fs::path inputPath(input);
+
+    // Шаблон без подстановок — каталог для выходных файлов
+    std::string path = pattern.find('{') == std::string::npos
+        ? (fs::path(pattern) / "{name}.{ext}").string()
+        : pattern;
+
+    std::string dir = inputPath.parent_path().string();
+    replaceAll(path, "{dir}", dir.empty() ? "." : dir);
+    replaceAll(path, "{name}", inputPath.stem().string());
+    replaceAll(path, "{ext}", format);
+    return path;
+}
+
+std::vector<BatchConverter::Result> BatchConverter::run(const std::vector<std::string>& inputs, const Options& options) {
+    std::vector<Result> results(inputs.size());
+    std::vector<uint64_t> sizes(inputs.size(), 0);
+    std::unordered_map<std::string, size_t> outputs;
+
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        Result& result = results[i];
+        result.input = inputs[i];
+        result.output = makeOutputPath(inputs[i], options.pattern, options.format);
+        result.ok = false;
+
+        std::error_code error;
+        sizes[i] = fs::file_size(inputs[i], error);
+        if (error) sizes[i] = 0;
+
+        // Два входных файла не должны писать в один выходной
+        auto inserted = outputs.emplace(fs::absolute(result.output, error).lexically_normal().string(), i);
+        if (!inserted.second)
+            result.error = "Output path is also produced by " + inputs[inserted.first->second];
+    }
+
+    // Сначала самые большие файлы: крупный файл в конце пакета
+    // оставил бы остальные потоки без работы
+    std::vector<size_t> order(inputs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    auto started = std::chrono::steady_clock::now();
+    ThreadPool pool(options.jobs);
+    size_t workers = pool.getSize();
+    // Файлов, которые ещё конвертируются или ждут очереди; считаются
+    // до постановки задач, чтобы первый файл не занял потоки остальных
+    std::atomic<size_t> unfinished(static_cast<size_t>(
+        std::count_if(results.begin(), results.end(), [](const Result& result) { return result.error.empty(); })));
+    for (size_t index : order) {
+        if (!results[index].error.empty()) continue;
+
+        pool.submit([&results, &sizes, &options, &unfinished, workers, index] {
+            Result& result = results[index];
+            ConversionOptions conversion = options.conversion;
+            if (conversion.stats) conversion.stats = &result.stats;
+
+            // Большой файл получает потоки пакета, которым уже не хватило
+            // файлов: SRT/VTT разбираются, а SRT/VTT/ASS записываются на них
+            // по частям. Остальные пары форматов, как и большой файл при
+            // занятом пуле, конвертируются потоково — разбор и запись идут
+            // одновременно в двух потоках
+            if (sizes[index] >= options.streamThreshold) {
+                std::string inExtension = Converter::extensionOf(result.input);
+                bool parallelParse = inExtension == "srt" || inExtension == "vtt";
+                bool parallelWrite = options.format == "srt" || options.format == "vtt" || options.format == "ass";
+                size_t threads = workers - std::min(unfinished.load(), workers) + 1;
+                if (threads > 1 && (parallelParse || parallelWrite)) {
+                    if (parallelParse && conversion.parseThreads == 1) conversion.parseThreads = threads;
+                    if (parallelWrite && conversion.writeThreads == 1) conversion.writeThreads = threads;
+                } else if (StreamConverter::canStream(inExtension, options.format)) {
+                    conversion.stream = true;
+                }
+            }
+
+            try {
+                fs::path parent = fs::path(result.output).parent_path();
+                if (!parent.empty())
+                    fs::create_directories(parent);
+                Converter::convertFile(result.input, result.output, conversion);
+                result.ok = true;
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+            --unfinished;
+        });
+    }
+    pool.wait();
+
+    // Сводка пакета: сумма по файлам, но время — общее время пакета
+    if (options.conversion.stats) {
+        PhaseStats& total = *options.conversion.stats;
+        for (const Result& result : results) total.merge(result.stats);
+        total.wallNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count());
+    }
+
+    return results;
+}
@@ -0,0 +1,281 @@
+#include "BinarySubtitle.h"
+#include "PhaseStats.h"
+#include "Trace.h"
+#include "BufferedWriter.h"
+#include "MappedFile.h"
+#include "TagStripper.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+const char MAGIC[8] = {'S', 'U', 'B', 'B', 'I', 'N', '\0', '\0'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const uint32_t FLAG_HAS_COORDINATES = 1;
+
+struct Header {
+    char magic[8];
+    uint32_t byteOrder;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    uint64_t count;
+    uint64_t recordsOffset;
+    uint64_t offsetsOffset;
+    uint64_t blobOffset;
+    uint64_t blobSize;
+};
+
+struct Record {
+    int64_t start_ms;
+    int64_t end_ms;
+    int32_t x1, x2, y1, y2;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 64, "subbin header must be 64 bytes");
+static_assert(sizeof(Record) == 40, "subbin record must be 40 bytes");
+
+// Контрольная сумма по 8-байтным словам в четыре независимые цепочки,
+// чтобы умножения не ждали друг друга. Принимает данные кусками любой длины.
+class Checksum {
+private:
+    static const uint64_t PRIME = 0x9E3779B97F4A7C15ULL;
+    uint64_t lanes[4];
+    unsigned char tail[32];
+    size_t tailSize;
+    uint64_t total;
+
+    static uint64_t mix(uint64_t h, uint64_t word) {
+        h ^= word;
+        h *= PRIME;
+        return h ^ (h >> 29);
+    }
+
+    void block(const unsigned char* p) {
+        for (int i = 0; i < 4; ++i) {
+            uint64_t word;
+            std::memcpy(&word, p + 8 * i, 8);
+            lanes[i] = mix(lanes[i], word);
+        }
+    }
+
+public:
+    Checksum() : lanes{1, 2, 3, 4}, tailSize(0), total(0) {}
+
+    void update(const void* data, size_t size) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        total += size;
+        if (tailSize) {
+            size_t n = std::min(size, sizeof(tail) - tailSize);
+            std::memcpy(tail + tailSize, p, n);
+            tailSize += n;
+            p += n;
+            size -= n;
+            if (tailSize < sizeof(tail)) return;
+            block(tail);
+            tailSize = 0;
+        }
+        for (; size >= 32; p += 32, size -= 32)
+            block(p);
+        std::memcpy(tail, p, size);
+        tailSize = size;
+    }
+
+    uint64_t finish() {
+        std::memset(tail + tailSize, 0, sizeof(tail) - tailSize);
+        block(tail);
+        uint64_t h = total;
+        for (uint64_t lane : lanes)
+            h = mix(h, lane);
+        return h;
+    }
+};
+
+[[noreturn]] void invalid(const std::string& filename, const std::string& reason) {
+    throw std::runtime_error("Invalid subtitle cache: " + filename + ": " + reason);
+}
+
+// Писатель, считающий контрольную сумму всего записанного
+struct ChecksumWriter {
+    BufferedWriter& out;
+    Checksum checksum;
+
+    void write(const void* data, size_t size) {
+        if (size == 0) return;
+        out.write(static_cast<const char*>(data), size);
+        checksum.update(data, size);
+    }
+};
+
+} // namespace
+
+BinarySubtitle::BinarySubtitle() : entries(SubtitleEntryList::STORAGE_ARENA) {}
+
+void BinarySubtitle::read(const std::string& filename) {
+    PhaseStats::Scope phase(PhaseStats::PARSE);
+    TRACE_SCOPE("BinarySubtitle::read");
+    MappedFile file(filename);
+    std::string_view data = file.view();
+    const char* base = data.data();
+    size_t size = data.size();
+
+    Header header;
+    if (size < sizeof(Header) + sizeof(uint64_t)) invalid(filename, "file is too short");
+    std::memcpy(&header, base, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) invalid(filename, "bad signature");
+    if (header.byteOrder != BYTE_ORDER_MARK) invalid(filename, "unsupported byte order");
+    if (header.version != VERSION) invalid(filename, "unsupported version " + std::to_string(header.version));
+    if (header.headerSize != sizeof(Header) || header.recordSize != sizeof(Record)) invalid(filename, "bad table layout");
+
+    // Таблицы идут подряд, поэтому их размеры однозначно задают размер файла
+    uint64_t count = header.count;
+    if (count > (size - sizeof(Header)) / (sizeof(Record) + 2 * sizeof(uint64_t))) invalid(filename, "bad entry count");
+    uint64_t recordsEnd = sizeof(Header) + count * sizeof(Record);
+    uint64_t offsetsEnd = recordsEnd + (2 * count + 1) * sizeof(uint64_t);
+    // Последнее смещение и контрольная сумма тоже должны поместиться в файл
+    if (offsetsEnd + sizeof(uint64_t) > size) invalid(filename, "bad entry count");
+    if (header.recordsOffset != sizeof(Header) || header.offsetsOffset != recordsEnd ||
+        header.blobOffset != offsetsEnd || header.blobSize != size - sizeof(uint64_t) - offsetsEnd)
+        invalid(filename, "bad table offsets");
+
+    Checksum checksum;
+    checksum.update(base, size - sizeof(uint64_t));
+    uint64_t stored;
+    std::memcpy(&stored, base + size - sizeof(uint64_t), sizeof(stored));
+    if (checksum.finish() != stored) invalid(filename, "checksum mismatch");
+
+    const char* records = base + header.recordsOffset;
+    const char* offsets = base + header.offsetsOffset;
+    const char* blob = base + header.blobOffset;
+
+    uint64_t previous = 0;
+    std::memcpy(&previous, offsets, sizeof(previous));
+    if (previous != 0) invalid(filename, "bad text offsets");
+
+    SubtitleEntryList loaded(SubtitleEntryList::STORAGE_ARENA);
+    loaded.reserve(count, header.blobSize);
+    for (uint64_t i = 0; i < count; ++i) {
+        Record record;
+        std::memcpy(&record, records + i * sizeof(Record), sizeof(Record));
+        uint64_t bounds[2];
+        std::memcpy(bounds, offsets + (2 * i + 1) * sizeof(uint64_t), sizeof(bounds));
+        if (bounds[0] < previous || bounds[1] < bounds[0] || bounds[1] > header.blobSize ||
+            bounds[0] - previous > std::numeric_limits<uint32_t>::max() ||
+            bounds[1] - bounds[0] > std::numeric_limits<uint32_t>::max())
+            invalid(filename, "bad text offsets");
+
+        SubtitleEntryView entry;
+        entry.start_ms = record.start_ms;
+        entry.end_ms = record.end_ms;
+        entry.text = std::string_view(blob + previous, bounds[0] - previous);
+        entry.formatting = std::string_view(blob + bounds[0], bounds[1] - bounds[0]);
+        entry.x1 = record.x1;
+        entry.x2 = record.x2;
+        entry.y1 = record.y1;
+        entry.y2 = record.y2;
+        entry.has_coordinates = (record.flags & FLAG_HAS_COORDINATES) != 0;
+        loaded.push_back(entry);
+        previous = bounds[1];
+    }
+    if (previous != header.blobSize) invalid(filename, "bad text offsets");
+
+    entries = std::move(loaded);
+}
+
+void BinarySubtitle::write(const std::string& filename) const {
+    PhaseStats::Scope phase(PhaseStats::FORMAT);
+    TRACE_SCOPE("BinarySubtitle::write");
+    PhaseStats::addCues(entries.getSize());
+    uint64_t count = entries.getSize();
+    uint64_t blobSize = 0;
+    for (size_t i = 0; i < count; ++i) {
+        SubtitleEntryView e = entries.view(i);
+        blobSize += e.text.size() + e.formatting.size();
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.version = VERSION;
+    header.headerSize = sizeof(Header);
+    header.recordSize = sizeof(Record);
+    header.count = count;
+    header.recordsOffset = sizeof(Header);
+    header.offsetsOffset = header.recordsOffset + count * sizeof(Record);
+    header.blobOffset = header.offsetsOffset + (2 * count + 1) * sizeof(uint64_t);
+    header.blobSize = blobSize;
+
+    BufferedWriter file(filename);
+    ChecksumWriter out{file, Checksum()};
+    out.write(&header, sizeof(header));
+
+    for (size_t i = 0; i < count; ++i) {
+        SubtitleEntryView e = entries.view(i);
+        Record record;
+        record.start_ms = e.start_ms;
+        record.end_ms = e.end_ms;
+        record.x1 = e.x1;
+        record.x2 = e.x2;
+        record.y1 = e.y1;
+        record.y2 = e.y2;
+        record.flags = e.has_coordinates ? FLAG_HAS_COORDINATES : 0;
+        record.reserved = 0;
+        out.write(&record, sizeof(record));
+    }
+
+    uint64_t offset = 0;
+    out.write(&offset, sizeof(offset));
+    for (size_t i = 0; i < count; ++i) {
+        SubtitleEntryView e = entries.view(i);
+        offset += e.text.size();
+        out.write(&offset, sizeof(offset));
+        offset += e.formatting.size();
+        out.write(&offset, sizeof(offset));
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        SubtitleEntryView e = entries.view(i);
+        out.write(e.text.data(), e.text.size());
+        out.write(e.formatting.data(), e.formatting.size());
+    }
+
+    uint64_t sum = out.checksum.finish();
+    file.write(reinterpret_cast<const char*>(&sum), sizeof(sum));
+    file.close();
+}
+
+SubtitleEntryList& BinarySubtitle::getEntries() {
+    return entries;
+}
+
+void BinarySubtitle::removeFormatting() {
+    TransformPipeline pipeline;
+    pipeline.setRemoveFormatting(true);
+    transform(pipeline);
+}
+
+void BinarySubtitle::addDefaultStyle(const std::string& style) {
+    TransformPipeline pipeline;
+    pipeline.setStyle(style);
+    transform(pipeline);
+}
+
+void BinarySubtitle::shiftTime(int64_t delta_ms, TimeShiftType type) {
+    PhaseStats::Scope phase(PhaseStats::SHIFT);
+    TRACE_SCOPE("BinarySubtitle::shiftTime");
+    entries.shiftTimes(delta_ms, type == START_END || type == START_ONLY, type == START_END || type == END_ONLY, false);
+}
+
+void BinarySubtitle::remapTime(const TimeRemap& remap) {
+    PhaseStats::Scope phase(PhaseStats::SHIFT);
+    TRACE_SCOPE("BinarySubtitle::remapTime");
+    entries.remapTimes(remap, false);
+}
+
+void BinarySubtitle::transform(const TransformPipeline& pipeline) {
+    pipeline.apply(entries, TagStripper::removeHtmlTags, false);
+}
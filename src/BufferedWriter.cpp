@@ -0,0 +1,175 @@
+#include "BufferedWriter.h"
+#include "PhaseStats.h"
+#include "Trace.h"
+#include "TimeCode.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#define SUBTITLE_HAVE_POSIX_IO 1
+#endif
+
+BufferedWriter::BufferedWriter(const std::string& filename, size_t bufferSize)
+    : filename(filename), fd(-1), buffer(new char[bufferSize ? bufferSize : 1]), capacity(bufferSize ? bufferSize : 1),
+      used(0), memory(false) {
+#ifdef SUBTITLE_HAVE_POSIX_IO
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        delete[] buffer;
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+#else
+    stream.reset(new std::ofstream(filename));
+    if (!*stream) {
+        delete[] buffer;
+        throw std::runtime_error("Cannot write file: " + filename);
+    }
+#endif
+}
+
+BufferedWriter::BufferedWriter(size_t initialCapacity)
+    : fd(-1), buffer(new char[initialCapacity ? initialCapacity : 1]), capacity(initialCapacity ? initialCapacity : 1),
+      used(0), memory(true) {}
+
+BufferedWriter::~BufferedWriter() {
+    try {
+        close();
+    } catch (...) {
+        // Ошибки записи сообщаются только из явного close()
+    }
+    delete[] buffer;
+}
+
+void BufferedWriter::writeAll(const char* data, size_t size) {
+    PhaseStats::Scope phase(PhaseStats::FLUSH);
+    TRACE_SCOPE("BufferedWriter::writeAll");
+#ifdef SUBTITLE_HAVE_POSIX_IO
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Cannot write file: " + filename);
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+#else
+    if (!stream->write(data, size)) throw std::runtime_error("Cannot write file: " + filename);
+#endif
+}
+
+void BufferedWriter::writeTwo(const char* first, size_t firstSize, const char* second, size_t secondSize) {
+    PhaseStats::Scope phase(PhaseStats::FLUSH);
+    TRACE_SCOPE("BufferedWriter::writeTwo");
+#ifdef SUBTITLE_HAVE_POSIX_IO
+    while (firstSize + secondSize > 0) {
+        struct iovec iov[2] = {
+            { const_cast<char*>(first), firstSize },
+            { const_cast<char*>(second), secondSize }
+        };
+        ssize_t written = ::writev(fd, iov, 2);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Cannot write file: " + filename);
+        }
+        size_t n = static_cast<size_t>(written);
+        size_t fromFirst = n < firstSize ? n : firstSize;
+        first += fromFirst;
+        firstSize -= fromFirst;
+        second += n - fromFirst;
+        secondSize -= n - fromFirst;
+    }
+#else
+    writeAll(first, firstSize);
+    writeAll(second, secondSize);
+#endif
+}
+
+void BufferedWriter::grow(size_t needed) {
+    if (capacity - used >= needed) return;
+    size_t newCapacity = std::max(capacity * 2, used + needed);
+    char* newBuffer = new char[newCapacity];
+    std::memcpy(newBuffer, buffer, used);
+    delete[] buffer;
+    buffer = newBuffer;
+    capacity = newCapacity;
+}
+
+void BufferedWriter::write(const char* data, size_t size) {
+    if (size <= capacity - used) {
+        std::memcpy(buffer + used, data, size);
+        used += size;
+        return;
+    }
+    if (memory) {
+        grow(size);
+        std::memcpy(buffer + used, data, size);
+        used += size;
+        return;
+    }
+    if (size < capacity) {
+        // Дописываем в буфер после сброса: мелкие фрагменты не идут в ядро по одному
+        flush();
+        std::memcpy(buffer, data, size);
+        used = size;
+        return;
+    }
+    // Крупный фрагмент отправляется вместе с буфером одним вызовом
+    writeTwo(buffer, used, data, size);
+    used = 0;
+}
+
+void BufferedWriter::writeInt(int64_t value) {
+    used += TimeCode::formatInt(value, reserve(TimeCode::MAX_LENGTH));
+}
+
+// Буфер меньше n растёт и в файловом режиме: вызывающий пишет n байт подряд
+char* BufferedWriter::reserve(size_t n) {
+    if (capacity - used < n) {
+        if (!memory) flush();
+        grow(n);
+    }
+    return buffer + used;
+}
+
+// В режиме памяти буфер не сбрасывается, а растёт
+void BufferedWriter::flush() {
+    if (memory) {
+        grow(1);
+        return;
+    }
+    if (used == 0) return;
+    size_t size = used;
+    used = 0;
+    writeAll(buffer, size);
+}
+
+void BufferedWriter::close() {
+    if (memory) return;
+#ifdef SUBTITLE_HAVE_POSIX_IO
+    if (fd < 0) return;
+    try {
+        flush();
+    } catch (...) {
+        ::close(fd);
+        fd = -1;
+        throw;
+    }
+    int result = ::close(fd);
+    fd = -1;
+    if (result != 0) throw std::runtime_error("Cannot write file: " + filename);
+#else
+    if (!stream) return;
+    flush();
+    stream->close();
+    bool failed = stream->fail();
+    stream.reset();
+    if (failed) throw std::runtime_error("Cannot write file: " + filename);
+#endif
+}
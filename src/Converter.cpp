@@ -0,0 +1,173 @@
+#include "Converter.h"
+#include "SRTSubtitle.h"
+#include "SAMISubtitle.h"
+#include "ASSSubtitle.h"
+#include "VTTSubtitle.h"
+#include "BinarySubtitle.h"
+#include "StreamConverter.h"
+#include "Trace.h"
+#include "TransformPipeline.h"
+
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+// WebVTT допускает только эти теги стиля
+bool isVttStyle(const std::string& style) {
+    return style == "b" || style == "i" || style == "u" || style == "c";
+}
+
+// Разметка текста записей формата: SRT, SAMI и двоичный кэш — HTML-теги
+// (с --rich-text кэш пишется в HTML независимо от исходного формата)
+RichText::Markup markupOf(const std::string& extension) {
+    if (extension == "ass" || extension == "ssa") return RichText::MARKUP_ASS;
+    if (extension == "vtt") return RichText::MARKUP_VTT;
+    return RichText::MARKUP_HTML;
+}
+
+// Вывод форматируется в UTF-8 и при необходимости перекодируется целиком
+void encodeOutput(const std::string& outFile, const ConversionOptions& options) {
+    if (options.outputEncoding == TextEncoding::ENCODING_UTF8 || Converter::extensionOf(outFile) == "subbin") return;
+    PhaseStats::Scope phase(PhaseStats::FLUSH);
+    TextEncoding::convertFile(outFile, options.outputEncoding);
+}
+
+} // namespace
+
+ConversionOptions::ConversionOptions()
+    : shiftTimeMs(0), removeFormatting(false), stream(false), arena(false), parseThreads(1), writeThreads(1),
+      richText(false), outputEncoding(TextEncoding::ENCODING_UTF8), stats(nullptr) {}
+
+std::string Converter::extensionOf(const std::string& filename) {
+    return filename.substr(filename.find_last_of(".") + 1);
+}
+
+void Converter::convertFile(const std::string& inFile, const std::string& outFile, const ConversionOptions& options) {
+    TRACE_SCOPE_DETAIL("Converter::convertFile", inFile);
+    if (!options.stats) {
+        convert(inFile, outFile, options);
+        encodeOutput(outFile, options);
+        return;
+    }
+
+    {
+        PhaseStats::Recorder recorder(*options.stats);
+        convert(inFile, outFile, options);
+        encodeOutput(outFile, options);
+    }
+    std::error_code error;
+    uint64_t inputBytes = std::filesystem::file_size(inFile, error);
+    if (!error) options.stats->inputBytes += inputBytes;
+    uint64_t outputBytes = std::filesystem::file_size(outFile, error);
+    if (!error) options.stats->outputBytes += outputBytes;
+}
+
+void Converter::convert(const std::string& inFile, const std::string& outFile, const ConversionOptions& options) {
+    SRTSubtitle srtSubs;
+    SAMISubtitle samiSubs;
+    ASSSubtitle assSubs;
+    VTTSubtitle vttSubs;
+    BinarySubtitle binSubs;
+
+    if (options.arena) {
+        // Режим хранения переходит вместе со списком при переносе между форматами
+        srtSubs.getEntries().setStorageMode(SubtitleEntryList::STORAGE_ARENA);
+        samiSubs.getEntries().setStorageMode(SubtitleEntryList::STORAGE_ARENA);
+        assSubs.getEntries().setStorageMode(SubtitleEntryList::STORAGE_ARENA);
+        vttSubs.getEntries().setStorageMode(SubtitleEntryList::STORAGE_ARENA);
+    }
+
+    std::string inExtension = extensionOf(inFile);
+    std::string outExtension = extensionOf(outFile);
+
+    bool keepNotes = (inExtension == "vtt" && outExtension == "vtt");
+
+    // Only allow certain styles in VTT
+    std::string style = options.addStyle;
+    if (inExtension == "vtt" && !style.empty() && !isVttStyle(style)) {
+        std::cerr << "Warning: Style '" << style << "' is not supported in WebVTT. Allowed: b, i, u, c\n";
+        style.clear();
+    }
+
+    if (options.stream && StreamConverter::canStream(inExtension, outExtension)) {
+        StreamConverter::Options streamOptions;
+        streamOptions.shiftTimeMs = options.shiftTimeMs;
+        streamOptions.remap = options.remap;
+        streamOptions.removeFormatting = options.removeFormatting;
+        streamOptions.addStyle = style;
+        streamOptions.richText = options.richText;
+
+        PhaseStats::Scope phase(PhaseStats::STREAM);
+        StreamConverter::convert(inFile, outFile, streamOptions);
+        return;
+    }
+    if (options.stream) {
+        std::cerr << "Warning: --stream is not supported for " << inExtension << " -> "
+                  << outExtension << ", converting in memory\n";
+    }
+
+    // An unknown output extension keeps the input format
+    std::string writeAs = outExtension;
+    if (writeAs != "srt" && writeAs != "smi" && writeAs != "ass" && writeAs != "ssa" && writeAs != "vtt" &&
+        writeAs != "subbin")
+        writeAs = inExtension;
+
+    // All requested operations are applied in a single pass
+    TransformPipeline pipeline;
+    pipeline.setRemap(options.remap);
+    pipeline.setShift(options.shiftTimeMs);
+    pipeline.setRemoveFormatting(options.removeFormatting);
+    pipeline.setStyle(style);
+    if (options.richText) {
+        // The binary cache does not record its markup, so it always holds HTML
+        pipeline.setMarkup(markupOf(inExtension), markupOf(writeAs));
+    }
+
+    // Read and transform the input
+    SubtitleEntryList entries;
+    if (inExtension == "srt") {
+        srtSubs.read(inFile, options.parseThreads);
+        srtSubs.transform(pipeline);
+        entries = std::move(srtSubs.getEntries());
+    } else if (inExtension == "smi") {
+        samiSubs.read(inFile);
+        samiSubs.transform(pipeline);
+        entries = std::move(samiSubs.getEntries());
+    } else if (inExtension == "ass" || inExtension == "ssa") {
+        assSubs.read(inFile, options.richText);
+        assSubs.transform(pipeline);
+        entries = std::move(assSubs.getEntries());
+    } else if (inExtension == "vtt") {
+        vttSubs.read(inFile, keepNotes, options.parseThreads);
+        vttSubs.transform(pipeline);
+        entries = std::move(vttSubs.getEntries());
+    } else if (inExtension == "subbin") {
+        binSubs.read(inFile);
+        binSubs.transform(pipeline);
+        entries = std::move(binSubs.getEntries());
+    } else {
+        throw std::runtime_error("Unsupported input file format: " + inExtension);
+    }
+
+    // Write output
+    if (writeAs == "smi") {
+        samiSubs.getEntries() = std::move(entries);
+        samiSubs.write(outFile);
+    } else if (writeAs == "ass" || writeAs == "ssa") {
+        assSubs.getEntries() = std::move(entries);
+        assSubs.write(outFile, options.writeThreads);
+    } else if (writeAs == "vtt") {
+        vttSubs.getEntries() = std::move(entries);
+        vttSubs.write(outFile, options.writeThreads);
+    } else if (writeAs == "subbin") {
+        binSubs.getEntries() = std::move(entries);
+        binSubs.write(outFile);
+    } else {
+        srtSubs.getEntries() = std::move(entries);
+        srtSubs.write(outFile, options.writeThreads);
+    }
+}
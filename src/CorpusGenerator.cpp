@@ -0,0 +1,270 @@
+#include "CorpusGenerator.h"
+#include "SRTSubtitle.h"
+#include "SAMISubtitle.h"
+#include "VTTSubtitle.h"
+#include "BufferedWriter.h"
+#include "TimeCode.h"
+#include "Converter.h"
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+// splitmix64: быстрый генератор с полностью определённой последовательностью
+// (std::mt19937 + распределения дают разные числа в разных библиотеках)
+class Random {
+private:
+    uint64_t state;
+
+public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t below(uint64_t n) { return n ? next() % n : 0; }
+    int64_t range(int64_t min, int64_t max) { return min + static_cast<int64_t>(below(max - min + 1)); }
+    bool chance(double p) { return static_cast<double>(next() >> 11) * 0x1.0p-53 < p; }
+};
+
+struct Word {
+    std::string_view text;
+    int chars; // Символы (кодовые точки), а не байты
+};
+
+const Word ASCII_WORDS[] = {
+    {"the", 3}, {"quick", 5}, {"brown", 5}, {"fox", 3}, {"jumps", 5}, {"over", 4}, {"lazy", 4},
+    {"dog", 3}, {"where", 5}, {"are", 3}, {"you", 3}, {"going", 5}, {"tonight", 7}, {"I", 1},
+    {"never", 5}, {"said", 4}, {"that", 4}, {"we", 2}, {"should", 6}, {"leave", 5}, {"now", 3},
+    {"listen", 6}, {"to", 2}, {"me", 2}, {"it's", 4}, {"not", 3}, {"here", 4}, {"yet", 3},
+    {"captain", 7}, {"station", 7}, {"morning", 7}, {"again", 5}};
+
+const Word UTF8_WORDS[] = {
+    {"привет", 6}, {"субтитры", 8}, {"время", 5}, {"ночь", 4}, {"日本語", 3}, {"字幕", 2},
+    {"こんにちは", 5}, {"café", 4}, {"naïve", 5}, {"Grüße", 5}, {"señor", 5}, {"Ελληνικά", 8},
+    {"😀", 1}, {"🎬", 1}, {"안녕", 2}, {"façade", 6}};
+
+const size_t ASCII_COUNT = sizeof(ASCII_WORDS) / sizeof(ASCII_WORDS[0]);
+const size_t UTF8_COUNT = sizeof(UTF8_WORDS) / sizeof(UTF8_WORDS[0]);
+
+// Разметка формата: перенос строки и теги курсива, жирного, подчёркивания, цвета
+struct Markup {
+    std::string_view newline;
+    std::string_view open[4];
+    std::string_view close[4];
+};
+
+const Markup HTML_MARKUP = {
+    "\n",
+    {"<i>", "<b>", "<u>", "<font color=\"#ffff00\">"},
+    {"</i>", "</b>", "</u>", "</font>"}};
+
+const Markup SAMI_MARKUP = {
+    "<br>",
+    {"<i>", "<b>", "<u>", "<font color=\"#ffff00\">"},
+    {"</i>", "</b>", "</u>", "</font>"}};
+
+const Markup ASS_MARKUP = {
+    "\\N",
+    {"{\\i1}", "{\\b1}", "{\\u1}", "{\\c&H00FFFF&}"},
+    {"{\\i0}", "{\\b0}", "{\\u0}", "{\\c}"}};
+
+// Последовательность записей, не зависящая от формата: разметка влияет
+// только на выводимые строки, но не на потребление случайных чисел
+class CueSource {
+private:
+    const CorpusGenerator::Options& options;
+    Random random;
+    int64_t lastStart;
+    int64_t lastEnd;
+    uint64_t produced;
+
+    void appendWord(std::string& text, const Markup& markup, int& chars) {
+        const Word& word = random.chance(options.utf8Share) ? UTF8_WORDS[random.below(UTF8_COUNT)]
+                                                            : ASCII_WORDS[random.below(ASCII_COUNT)];
+        if (random.chance(options.tagDensity)) {
+            size_t tag = random.below(4);
+            text += markup.open[tag];
+            text += word.text;
+            text += markup.close[tag];
+        } else {
+            text += word.text;
+        }
+        chars += word.chars;
+    }
+
+public:
+    int64_t start_ms;
+    int64_t end_ms;
+    std::string text;
+
+    explicit CueSource(const CorpusGenerator::Options& options)
+        : options(options), random(options.seed), lastStart(0), lastEnd(0), produced(0), start_ms(0), end_ms(0) {}
+
+    bool next(const Markup& markup) {
+        if (produced == options.cues) return false;
+
+        if (produced != 0 && random.chance(options.overlap)) {
+            start_ms = lastStart + static_cast<int64_t>(random.below(lastEnd - lastStart));
+        } else {
+            start_ms = lastEnd + random.range(100, 3000);
+        }
+        end_ms = start_ms + random.range(700, 6000);
+
+        text.clear();
+        int lines = static_cast<int>(random.range(1, options.maxLines));
+        for (int line = 0; line < lines; ++line) {
+            if (line) text += markup.newline;
+            int target = static_cast<int>(random.range(options.minLineLength, options.maxLineLength));
+            int chars = 0;
+            appendWord(text, markup, chars);
+            while (chars < target) {
+                // Запятые только между словами: в ASS они не должны попадать в конец текста
+                if (random.chance(0.08)) {
+                    text += ',';
+                    ++chars;
+                }
+                text += ' ';
+                ++chars;
+                appendWord(text, markup, chars);
+            }
+        }
+
+        lastStart = start_ms;
+        lastEnd = end_ms;
+        ++produced;
+        return true;
+    }
+
+    uint64_t getProduced() const { return produced; }
+};
+
+SubtitleEntryView cueView(const CueSource& cue) {
+    SubtitleEntryView view;
+    view.start_ms = cue.start_ms;
+    view.end_ms = cue.end_ms;
+    view.text = cue.text;
+    return view;
+}
+
+// Случайные числа для элементов одного формата (заметки, стили) берутся
+// из отдельного генератора, чтобы записи во всех форматах совпадали
+uint64_t extrasSeed(uint64_t seed) {
+    return seed ^ 0x5DEECE66Dull;
+}
+
+void writeSRT(BufferedWriter& out, const CorpusGenerator::Options& options) {
+    CueSource cue(options);
+    while (cue.next(HTML_MARKUP))
+        SRTSubtitle::writeEntry(out, cueView(cue), cue.getProduced() - 1);
+}
+
+void writeVTT(BufferedWriter& out, const CorpusGenerator::Options& options) {
+    CueSource cue(options);
+    Random extras(extrasSeed(options.seed));
+    std::string note;
+
+    VTTSubtitle::writeHeader(out);
+    while (cue.next(HTML_MARKUP)) {
+        if (extras.chance(options.noteShare)) {
+            note = "generated block ";
+            note += std::to_string(cue.getProduced());
+            note += "\nreviewed by the synthetic corpus";
+            SubtitleEntryView view;
+            view.start_ms = view.end_ms = -1;
+            view.text = note;
+            VTTSubtitle::writeEntry(out, view, 0);
+        }
+        if (extras.chance(0.25)) out << "cue-" << static_cast<int64_t>(cue.getProduced()) << '\n';
+        VTTSubtitle::writeEntry(out, cueView(cue), 0);
+    }
+    VTTSubtitle::writeFooter(out);
+}
+
+void writeSAMI(BufferedWriter& out, const CorpusGenerator::Options& options) {
+    CueSource cue(options);
+    SAMISubtitle::writeHeader(out);
+    while (cue.next(SAMI_MARKUP))
+        SAMISubtitle::writeEntry(out, cueView(cue), 0);
+    SAMISubtitle::writeFooter(out);
+}
+
+void writeTime(BufferedWriter& out, int64_t ms) {
+    char* p = out.reserve(TimeCode::MAX_LENGTH);
+    out.commit(TimeCode::formatASS(ms, p));
+}
+
+void writeASS(BufferedWriter& out, const CorpusGenerator::Options& options) {
+    CueSource cue(options);
+    Random extras(extrasSeed(options.seed));
+    int styles = options.styles < 1 ? 1 : options.styles;
+
+    out << "[Script Info]\n";
+    out << "; Synthetic corpus, seed " << static_cast<int64_t>(options.seed) << "\n";
+    out << "Title: Synthetic corpus\n";
+    out << "ScriptType: v4.00+\n";
+    out << "WrapStyle: 0\n";
+    out << "ScaledBorderAndShadow: yes\n";
+    out << "YCbCr Matrix: None\n\n";
+
+    out << "[V4+ Styles]\n";
+    out << "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n";
+    for (int i = 0; i < styles; ++i) {
+        out << "Style: " << (i == 0 ? std::string("Default") : "Style" + std::to_string(i)) << ",Arial,"
+            << 40 + i % 16 << ",&H00FFFFFF,&H000000FF,&H00000000,&H64000000," << i % 2 << "," << i / 2 % 2
+            << ",0,0,100,100,0,0,1,2,1," << 1 + i % 9 << ",10,10,10,1\n";
+    }
+
+    out << "\n[Events]\n";
+    out << "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
+    while (cue.next(ASS_MARKUP)) {
+        out << "Dialogue: ";
+        // Строки в стиле SSA: "Marked=0" на месте Layer
+        if (extras.chance(0.1)) out << "Marked=0";
+        else out << static_cast<int>(extras.below(3));
+        out << ',';
+        writeTime(out, cue.start_ms);
+        out << ',';
+        writeTime(out, cue.end_ms);
+        int style = static_cast<int>(extras.below(styles));
+        out << ',' << (style == 0 ? std::string("Default") : "Style" + std::to_string(style)) << ",,0,0,0,,";
+        if (extras.chance(options.tagDensity)) {
+            out << "{\\pos(" << static_cast<int>(extras.below(1920)) << ','
+                << static_cast<int>(extras.below(1080)) << ")}";
+        }
+        out << cue.text << '\n';
+    }
+}
+
+} // namespace
+
+CorpusGenerator::Options::Options()
+    : seed(1), cues(1000), overlap(0.05), minLineLength(20), maxLineLength(42), maxLines(2),
+      tagDensity(0.05), utf8Share(0.1), noteShare(0.01), styles(4) {}
+
+CorpusGenerator::CorpusGenerator(const Options& options) : options(options) {
+    if (options.minLineLength < 1 || options.maxLineLength < options.minLineLength)
+        throw std::runtime_error("Invalid line length range");
+    if (options.maxLines < 1) throw std::runtime_error("Invalid number of lines");
+}
+
+bool CorpusGenerator::isSupported(const std::string& extension) {
+    return extension == "srt" || extension == "vtt" || extension == "smi" || extension == "sami" ||
+           extension == "ass" || extension == "ssa";
+}
+
+void CorpusGenerator::write(const std::string& filename) const {
+    std::string extension = Converter::extensionOf(filename);
+    if (!isSupported(extension)) throw std::runtime_error("Unsupported corpus format: " + filename);
+
+    BufferedWriter out(filename);
+    if (extension == "srt") writeSRT(out, options);
+    else if (extension == "vtt") writeVTT(out, options);
+    else if (extension == "smi" || extension == "sami") writeSAMI(out, options);
+    else writeASS(out, options);
+    out.close();
+}
@@ -0,0 +1,153 @@
+#include "IntervalIndex.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+IntervalIndex::IntervalIndex() : offset(0), maxLevel(-1) {}
+
+IntervalIndex::IntervalIndex(const SubtitleEntryList& entries) : offset(0), maxLevel(-1) {
+    build(entries);
+}
+
+void IntervalIndex::build(const SubtitleEntryList& entries) {
+    ids.resize(entries.getSize());
+    std::iota(ids.begin(), ids.end(), size_t(0));
+    gather(entries);
+    sortByStart();
+    buildTree();
+}
+
+void IntervalIndex::refresh(const SubtitleEntryList& entries) {
+    if (entries.getSize() != ids.size()) {
+        build(entries);
+        return;
+    }
+    gather(entries);
+    if (!std::is_sorted(start.begin(), start.end()))
+        sortByStart();
+    buildTree();
+}
+
+void IntervalIndex::shift(int64_t delta_ms) {
+    offset += delta_ms;
+}
+
+// Читает времена записей в текущем порядке ids
+void IntervalIndex::gather(const SubtitleEntryList& entries) {
+    const int64_t* starts = entries.startTimes();
+    const int64_t* ends = entries.endTimes();
+    start.resize(ids.size());
+    end.resize(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        start[i] = starts[ids[i]];
+        end[i] = ends[ids[i]];
+    }
+    offset = 0;
+}
+
+void IntervalIndex::sortByStart() {
+    std::vector<size_t> order(ids.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return start[a] < start[b]; });
+
+    std::vector<int64_t> sortedStart(order.size()), sortedEnd(order.size());
+    std::vector<size_t> sortedIds(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        sortedStart[i] = start[order[i]];
+        sortedEnd[i] = end[order[i]];
+        sortedIds[i] = ids[order[i]];
+    }
+    start.swap(sortedStart);
+    end.swap(sortedEnd);
+    ids.swap(sortedIds);
+}
+
+// Узлы уровня k — позиции, у которых k младших битов равны 1; листья —
+// чётные позиции. Узлы справа от конца массива заменяются последним
+// существующим узлом соответствующего уровня.
+void IntervalIndex::buildTree() {
+    size_t n = start.size();
+    maxEnd = end;
+    maxLevel = -1;
+    if (n == 0) return;
+
+    size_t lastIndex = 0;
+    int64_t last = 0;
+    for (size_t i = 0; i < n; i += 2) {
+        lastIndex = i;
+        last = maxEnd[i];
+    }
+
+    int k = 1;
+    for (; (size_t(1) << k) <= n; ++k) {
+        size_t x = size_t(1) << (k - 1);
+        size_t first = (x << 1) - 1;
+        size_t step = x << 2;
+        for (size_t i = first; i < n; i += step) {
+            int64_t left = maxEnd[i - x];
+            int64_t right = i + x < n ? maxEnd[i + x] : last;
+            maxEnd[i] = std::max(end[i], std::max(left, right));
+        }
+        lastIndex = (lastIndex >> k & 1) ? lastIndex - x : lastIndex + x;
+        if (lastIndex < n && maxEnd[lastIndex] > last) last = maxEnd[lastIndex];
+    }
+    maxLevel = k - 1;
+}
+
+size_t IntervalIndex::query(int64_t from, int64_t to, std::vector<size_t>& out) const {
+    struct Node {
+        size_t x;
+        int k;
+        bool leftDone;
+    };
+
+    size_t n = start.size();
+    size_t before = out.size();
+    if (n == 0 || from >= to) return 0;
+
+    // Вместо сдвига всех записей сдвигается запрос
+    from -= offset;
+    to -= offset;
+
+    Node stack[128]; // Глубина не больше двух узлов на уровень
+    int top = 0;
+    stack[top++] = Node{(size_t(1) << maxLevel) - 1, maxLevel, false};
+
+    while (top > 0) {
+        Node z = stack[--top];
+        if (z.k <= 3) {
+            // Небольшое поддерево проще просмотреть подряд
+            size_t i0 = z.x >> z.k << z.k;
+            size_t i1 = std::min(i0 + (size_t(1) << (z.k + 1)) - 1, n);
+            for (size_t i = i0; i < i1 && start[i] < to; ++i) {
+                if (end[i] > from) out.push_back(i);
+            }
+        } else if (!z.leftDone) {
+            size_t y = z.x - (size_t(1) << (z.k - 1));
+            stack[top++] = Node{z.x, z.k, true};
+            if (y >= n || maxEnd[y] > from) stack[top++] = Node{y, z.k - 1, false};
+        } else if (z.x < n && start[z.x] < to) {
+            if (end[z.x] > from) out.push_back(z.x);
+            stack[top++] = Node{z.x + (size_t(1) << (z.k - 1)), z.k - 1, false};
+        }
+    }
+
+    // Позиции в отсортированном массиве — это порядок по началу
+    std::sort(out.begin() + before, out.end());
+    for (size_t i = before; i < out.size(); ++i)
+        out[i] = ids[out[i]];
+    return out.size() - before;
+}
+
+size_t IntervalIndex::findActive(int64_t t, std::vector<size_t>& out) const {
+    if (t == std::numeric_limits<int64_t>::max()) return 0;
+    return query(t, t + 1, out);
+}
+
+size_t IntervalIndex::findOverlapping(int64_t from, int64_t to, std::vector<size_t>& out) const {
+    return query(from, to, out);
+}
+
+size_t IntervalIndex::getSize() const {
+    return ids.size();
+}
@@ -0,0 +1,43 @@
+#include "LineReader.h"
+#include <cstring>
+
+LineReader::LineReader(std::string_view buffer)
+    : begin(buffer.data()), end(buffer.data() + buffer.size()), cur(buffer.data()) {
+    // Пропускаем UTF-8 BOM
+    if (buffer.size() >= 3 && buffer.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        cur += 3;
+}
+
+bool LineReader::getLine(std::string_view& line) {
+    if (cur >= end) return false;
+
+    const char* nl = static_cast<const char*>(std::memchr(cur, '\n', end - cur));
+    const char* lineEnd = nl ? nl : end;
+    const char* next = nl ? nl + 1 : end;
+
+    if (lineEnd > cur && lineEnd[-1] == '\r') --lineEnd;
+
+    line = std::string_view(cur, lineEnd - cur);
+    cur = next;
+    return true;
+}
+
+bool LineReader::eof() const {
+    return cur >= end;
+}
+
+size_t LineReader::tell() const {
+    return cur - begin;
+}
+
+void LineReader::seek(size_t pos) {
+    cur = begin + pos;
+    if (cur > end) cur = end;
+}
+
+std::string_view LineReader::trim(std::string_view str) {
+    size_t first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) return std::string_view();
+    size_t last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+}
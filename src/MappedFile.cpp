@@ -0,0 +1,92 @@
+#include "MappedFile.h"
+#include "PhaseStats.h"
+#include "TextEncoding.h"
+#include "Trace.h"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SUBTITLE_HAVE_MMAP 1
+#endif
+
+MappedFile::MappedFile(const std::string& filename)
+    : data(nullptr), size(0), mapping(nullptr), released(0) {
+    PhaseStats::Scope phase(PhaseStats::OPEN_READ);
+    TRACE_SCOPE("MappedFile::MappedFile");
+#ifdef SUBTITLE_HAVE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open file: " + filename);
+
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            mapping = addr;
+            data = static_cast<const char*>(addr);
+            size = static_cast<size_t>(st.st_size);
+            // Файл читается строго последовательно
+            ::madvise(addr, size, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(fd);
+#endif
+    if (!mapping) readFallback(filename);
+}
+
+MappedFile::~MappedFile() {
+#ifdef SUBTITLE_HAVE_MMAP
+    if (mapping) ::munmap(mapping, size);
+#endif
+}
+
+void MappedFile::readFallback(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open file: " + filename);
+
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+}
+
+void MappedFile::release(size_t offset) {
+#ifdef SUBTITLE_HAVE_MMAP
+    static const size_t RELEASE_CHUNK = 8 << 20;
+    if (!mapping || offset < released + RELEASE_CHUNK) return;
+
+    static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t end = offset / pageSize * pageSize;
+    ::madvise(static_cast<char*>(mapping) + released, end - released, MADV_DONTNEED);
+    released = end;
+#else
+    (void)offset;
+#endif
+}
+
+void MappedFile::decodeText() {
+    PhaseStats::Scope phase(PhaseStats::OPEN_READ);
+    TRACE_SCOPE("MappedFile::decodeText");
+    std::string utf8;
+    if (!TextEncoding::normalize(view(), utf8)) return;
+
+#ifdef SUBTITLE_HAVE_MMAP
+    if (mapping) ::munmap(mapping, size);
+#endif
+    mapping = nullptr;
+    released = 0;
+    buffer = std::move(utf8);
+    data = buffer.data();
+    size = buffer.size();
+}
+
+std::string_view MappedFile::view() const {
+    return std::string_view(data, size);
+}
+
+size_t MappedFile::getSize() const {
+    return size;
+}
@@ -0,0 +1,87 @@
+#include "ParallelParser.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+namespace {
+
+// Частей больше, чем потоков: перехват задач выравнивает неравные части
+const size_t CHUNKS_PER_THREAD = 4;
+
+// Смещение сразу после первой пустой строки, начинающейся в from или позже
+// (from — начало строки); npos, если такой нет
+size_t nextBlankLineEnd(std::string_view buffer, size_t from) {
+    const char* data = buffer.data();
+    size_t size = buffer.size();
+    while (from < size) {
+        if (data[from] == '\n') return from + 1;
+        if (data[from] == '\r' && from + 1 < size && data[from + 1] == '\n') return from + 2;
+        const void* nl = std::memchr(data + from, '\n', size - from);
+        if (!nl) break;
+        from = static_cast<const char*>(nl) - data + 1;
+    }
+    return std::string_view::npos;
+}
+
+bool startsWithBom(std::string_view buffer, size_t pos) {
+    return buffer.size() - pos >= 3 && buffer.compare(pos, 3, "\xEF\xBB\xBF") == 0;
+}
+
+} // namespace
+
+std::vector<size_t> ParallelParser::split(std::string_view buffer, size_t begin, size_t parts) {
+    std::vector<size_t> bounds(1, begin);
+    size_t size = buffer.size();
+    if (parts == 0) parts = 1;
+    size_t target = (size - begin) / parts;
+
+    for (size_t part = 1; part < parts; ++part) {
+        size_t from = begin + part * target;
+        if (from <= bounds.back()) from = bounds.back();
+
+        // Граница ищется от начала строки, в которую попало смещение
+        const void* nl = std::memchr(buffer.data() + from, '\n', size - from);
+        if (!nl) break;
+        size_t bound = nextBlankLineEnd(buffer, static_cast<const char*>(nl) - buffer.data() + 1);
+        while (bound != std::string_view::npos && bound < size && startsWithBom(buffer, bound))
+            bound = nextBlankLineEnd(buffer, bound);
+        if (bound == std::string_view::npos || bound >= size) break;
+        if (bound > bounds.back()) bounds.push_back(bound);
+    }
+    bounds.push_back(size);
+    return bounds;
+}
+
+bool ParallelParser::parse(std::string_view buffer, size_t begin, size_t threads, const ChunkParser& parser,
+                           SubtitleEntryList& entries) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads <= 1 || buffer.size() - begin < 2 * MIN_CHUNK_SIZE) return false;
+    // Первая часть разбирается отдельным LineReader, который пропустил бы BOM
+    if (begin != 0 && startsWithBom(buffer, begin)) return false;
+
+    size_t parts = std::min(threads * CHUNKS_PER_THREAD, (buffer.size() - begin) / MIN_CHUNK_SIZE);
+    std::vector<size_t> bounds = split(buffer, begin, parts);
+    size_t chunks = bounds.size() - 1;
+    if (chunks < 2) return false;
+
+    std::vector<SubtitleEntryList> lists(chunks, SubtitleEntryList(entries.getStorageMode()));
+    {
+        ThreadPool pool(std::min(threads, chunks));
+        for (size_t i = 0; i < chunks; ++i) {
+            pool.submit([&buffer, &bounds, &parser, &lists, i] {
+                TRACE_SCOPE("ParallelParser::chunk");
+                SubtitleEntryList& list = lists[i];
+                parser(buffer.substr(bounds[i], bounds[i + 1] - bounds[i]),
+                       [&list](SubtitleEntry&& entry) { list.push_back(std::move(entry)); });
+            });
+        }
+        pool.wait();
+    }
+
+    TRACE_SCOPE("ParallelParser::append");
+    for (SubtitleEntryList& list : lists) entries.append(std::move(list));
+    return true;
+}
@@ -0,0 +1,109 @@
+#include "ParallelWriter.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#define SUBTITLE_HAVE_POSIX_IO 1
+#endif
+
+namespace {
+
+// Диапазонов больше, чем потоков: перехват задач выравнивает неравные диапазоны
+const size_t RANGES_PER_THREAD = 4;
+
+#ifdef SUBTITLE_HAVE_POSIX_IO
+
+// Дескриптор закрывается и при исключении из задач
+struct FileHandle {
+    int fd;
+    explicit FileHandle(int fd) : fd(fd) {}
+    ~FileHandle() {
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+void writeAt(int fd, std::string_view data, size_t offset, const std::string& filename) {
+    while (!data.empty()) {
+        ssize_t written = ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Cannot write file: " + filename);
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+        offset += static_cast<size_t>(written);
+    }
+}
+
+#endif
+
+} // namespace
+
+bool ParallelWriter::write(const std::string& filename, const SubtitleEntryList& entries, std::string_view header,
+                           std::string_view footer, EntrySize size, EntryWriter writer, size_t threads) {
+#ifdef SUBTITLE_HAVE_POSIX_IO
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    size_t count = entries.getSize();
+    if (threads <= 1 || count < 2 * MIN_RANGE_ENTRIES) return false;
+
+    size_t rangeEntries = (count + threads * RANGES_PER_THREAD - 1) / (threads * RANGES_PER_THREAD);
+    if (rangeEntries < MIN_RANGE_ENTRIES) rangeEntries = MIN_RANGE_ENTRIES;
+    if (rangeEntries > MAX_RANGE_ENTRIES) rangeEntries = MAX_RANGE_ENTRIES;
+    size_t ranges = (count + rangeEntries - 1) / rangeEntries;
+
+    // offsets[r] — смещение диапазона r в файле, offsets[ranges] — начало footer
+    std::vector<size_t> offsets(ranges + 1, 0);
+    ThreadPool pool(std::min(threads, ranges));
+
+    {
+        TRACE_SCOPE("ParallelWriter::measure");
+        for (size_t r = 0; r < ranges; ++r) {
+            pool.submit([&entries, &offsets, size, rangeEntries, count, r] {
+                size_t bytes = 0;
+                for (size_t i = r * rangeEntries, end = std::min(count, i + rangeEntries); i < end; ++i)
+                    bytes += size(entries.view(i), i);
+                offsets[r + 1] = bytes;
+            });
+        }
+        pool.wait();
+    }
+    offsets[0] = header.size();
+    for (size_t r = 1; r <= ranges; ++r) offsets[r] += offsets[r - 1];
+
+    FileHandle file(::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (file.fd < 0 || ::ftruncate(file.fd, static_cast<off_t>(offsets[ranges] + footer.size())) != 0)
+        throw std::runtime_error("Cannot write file: " + filename);
+
+    writeAt(file.fd, header, 0, filename);
+    for (size_t r = 0; r < ranges; ++r) {
+        pool.submit([&entries, &offsets, &filename, &file, writer, rangeEntries, count, r] {
+            TRACE_SCOPE("ParallelWriter::range");
+            size_t expected = offsets[r + 1] - offsets[r];
+            BufferedWriter out(expected);
+            for (size_t i = r * rangeEntries, end = std::min(count, i + rangeEntries); i < end; ++i)
+                writer(out, entries.view(i), i);
+            // Несовпадение означает ошибку в EntrySize и испортило бы соседний диапазон
+            if (out.view().size() != expected)
+                throw std::logic_error("ParallelWriter: entry size does not match formatted output");
+            writeAt(file.fd, out.view(), offsets[r], filename);
+        });
+    }
+    pool.wait();
+    writeAt(file.fd, footer, offsets[ranges], filename);
+
+    int fd = file.fd;
+    file.fd = -1;
+    if (::close(fd) != 0) throw std::runtime_error("Cannot write file: " + filename);
+    return true;
+#else
+    (void)filename; (void)entries; (void)header; (void)footer; (void)size; (void)writer; (void)threads;
+    return false;
+#endif
+}
@@ -0,0 +1,204 @@
+#include "PhaseStats.h"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define SUBTITLE_HAVE_PERF 1
+#endif
+
+namespace {
+
+thread_local PhaseStats::Recorder* currentRecorder = nullptr;
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+#ifdef SUBTITLE_HAVE_PERF
+int openCounter(uint64_t config, int groupFd) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1; // Доступно и при perf_event_paranoid = 2
+    attr.exclude_hv = 1;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+#endif
+
+std::string jsonString(const std::string& str) {
+    std::string out = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+thread_local uint64_t PhaseStats::allocationCount = 0;
+
+PhaseStats::Counters::Counters() : ns(0), cycles(0), instructions(0), cacheMisses(0), allocations(0) {}
+
+PhaseStats::Counters& PhaseStats::Counters::operator+=(const Counters& other) {
+    ns += other.ns;
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cacheMisses += other.cacheMisses;
+    allocations += other.allocations;
+    return *this;
+}
+
+PhaseStats::Scope::Scope(Phase phase)
+    : previous(currentRecorder ? currentRecorder->enter(phase) : NO_PHASE) {}
+
+PhaseStats::Scope::~Scope() {
+    if (currentRecorder) currentRecorder->enter(previous);
+}
+
+PhaseStats::Recorder::Recorder(PhaseStats& stats)
+    : stats(stats), outer(currentRecorder), perfFds{-1, -1, -1}, current(NO_PHASE) {
+#ifdef SUBTITLE_HAVE_PERF
+    perfFds[0] = openCounter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (perfFds[0] >= 0) {
+        perfFds[1] = openCounter(PERF_COUNT_HW_INSTRUCTIONS, perfFds[0]);
+        perfFds[2] = openCounter(PERF_COUNT_HW_CACHE_MISSES, perfFds[0]);
+    }
+    if (perfFds[0] < 0 || perfFds[1] < 0 || perfFds[2] < 0) {
+        // Без полной группы счётчики не собираются вовсе
+        for (int& fd : perfFds) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+    }
+#endif
+    stats.hardwareCounters = perfFds[0] >= 0;
+    currentRecorder = this;
+    startNs = nowNs();
+    last = sample();
+}
+
+PhaseStats::Recorder::~Recorder() {
+    enter(NO_PHASE);
+    stats.wallNs += nowNs() - startNs;
+    stats.files += 1;
+#ifdef SUBTITLE_HAVE_PERF
+    for (int fd : perfFds)
+        if (fd >= 0) ::close(fd);
+#endif
+    currentRecorder = outer;
+}
+
+PhaseStats::Counters PhaseStats::Recorder::sample() const {
+    Counters now;
+    now.ns = nowNs();
+    now.allocations = allocationCount;
+#ifdef SUBTITLE_HAVE_PERF
+    if (perfFds[0] >= 0) {
+        uint64_t values[4] = {0, 0, 0, 0}; // nr, такты, инструкции, промахи
+        if (::read(perfFds[0], values, sizeof(values)) == static_cast<ssize_t>(sizeof(values))) {
+            now.cycles = values[1];
+            now.instructions = values[2];
+            now.cacheMisses = values[3];
+        }
+    }
+#endif
+    return now;
+}
+
+// Всё, что прошло с прошлого переключения, относится к текущей фазе
+int PhaseStats::Recorder::enter(int phase) {
+    Counters now = sample();
+    if (current != NO_PHASE) {
+        Counters& total = stats.phases[current];
+        total.ns += now.ns - last.ns;
+        total.cycles += now.cycles - last.cycles;
+        total.instructions += now.instructions - last.instructions;
+        total.cacheMisses += now.cacheMisses - last.cacheMisses;
+        total.allocations += now.allocations - last.allocations;
+    }
+    int previous = current;
+    current = phase;
+    last = now;
+    return previous;
+}
+
+void PhaseStats::Recorder::addCues(uint64_t count) {
+    stats.cues += count;
+}
+
+PhaseStats::PhaseStats() : wallNs(0), cues(0), inputBytes(0), outputBytes(0), files(0), hardwareCounters(false) {}
+
+void PhaseStats::merge(const PhaseStats& other) {
+    for (int i = 0; i < PHASE_COUNT; ++i) phases[i] += other.phases[i];
+    wallNs += other.wallNs;
+    cues += other.cues;
+    inputBytes += other.inputBytes;
+    outputBytes += other.outputBytes;
+    hardwareCounters = files == 0 ? other.hardwareCounters : hardwareCounters && other.hardwareCounters;
+    files += other.files;
+}
+
+void PhaseStats::addCues(uint64_t count) {
+    if (currentRecorder) currentRecorder->addCues(count);
+}
+
+const char* PhaseStats::phaseName(Phase phase) {
+    switch (phase) {
+        case OPEN_READ: return "open_read";
+        case PARSE: return "parse";
+        case SHIFT: return "shift";
+        case STRIP: return "strip";
+        case STYLE: return "style";
+        case FORMAT: return "format";
+        case FLUSH: return "flush";
+        case STREAM: return "stream";
+        default: return "unknown";
+    }
+}
+
+std::string PhaseStats::toJson(const std::string& input, const std::string& output) const {
+    double seconds = wallNs / 1e9;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "{\n";
+    if (!input.empty()) out << "  \"input\": " << jsonString(input) << ",\n";
+    if (!output.empty()) out << "  \"output\": " << jsonString(output) << ",\n";
+    out << "  \"files\": " << files << ",\n";
+    out << "  \"cues\": " << cues << ",\n";
+    out << "  \"input_bytes\": " << inputBytes << ",\n";
+    out << "  \"output_bytes\": " << outputBytes << ",\n";
+    out << "  \"wall_ns\": " << wallNs << ",\n";
+    out << "  \"cues_per_second\": " << (seconds > 0 ? cues / seconds : 0.0) << ",\n";
+    out << "  \"input_bytes_per_second\": " << (seconds > 0 ? inputBytes / seconds : 0.0) << ",\n";
+    out << "  \"output_bytes_per_second\": " << (seconds > 0 ? outputBytes / seconds : 0.0) << ",\n";
+    out << "  \"hardware_counters\": " << (hardwareCounters ? "true" : "false") << ",\n";
+    out << "  \"phases\": {";
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        const Counters& c = phases[i];
+        out << (i ? ",\n" : "\n") << "    \"" << phaseName(static_cast<Phase>(i)) << "\": {\"ns\": " << c.ns;
+        if (hardwareCounters) {
+            out << ", \"cycles\": " << c.cycles << ", \"instructions\": " << c.instructions
+                << ", \"cache_misses\": " << c.cacheMisses;
+        }
+        out << ", \"allocations\": " << c.allocations << "}";
+    }
+    out << "\n  }\n}\n";
+    return out.str();
+}
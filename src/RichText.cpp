@@ -0,0 +1,388 @@
+#include "RichText.h"
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// Флаги по порядку вложенности при выводе: b, i, u, s
+const uint8_t FLAG_ORDER[] = {RichText::BOLD, RichText::ITALIC, RichText::UNDERLINE, RichText::STRIKEOUT};
+const char* const HTML_TAGS[] = {"b", "i", "u", "s"};
+const char ASS_TAGS[] = {'b', 'i', 'u', 's'};
+const size_t FLAG_COUNT = 4;
+
+char toLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = toLower(c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Шестнадцатеричное число в начале str; false, если цифр нет
+bool parseHex(std::string_view str, uint32_t& value) {
+    value = 0;
+    size_t i = 0;
+    for (; i < str.size() && i < 8 && hexValue(str[i]) >= 0; ++i) value = value * 16 + hexValue(str[i]);
+    return i > 0;
+}
+
+// Имя HTML/WebVTT-тега в нижнем регистре: "font color=..." -> "font", "c.red" -> "c"
+std::string tagName(std::string_view tag) {
+    std::string name;
+    for (char c : tag) {
+        if (c == ' ' || c == '\t' || c == '.' || c == '/' || c == '>') break;
+        name += toLower(c);
+    }
+    return name;
+}
+
+// Цвет из атрибута color="#rrggbb" тега font; NO_COLOUR, если его нет
+uint32_t fontColour(std::string_view tag) {
+    std::string lower;
+    for (char c : tag) lower += toLower(c);
+    size_t pos = lower.find("color");
+    if (pos == std::string::npos) return RichText::NO_COLOUR;
+    pos = lower.find('#', pos);
+    uint32_t colour;
+    if (pos == std::string::npos || !parseHex(std::string_view(lower).substr(pos + 1, 6), colour))
+        return RichText::NO_COLOUR;
+    return colour & 0xFFFFFF;
+}
+
+void appendHex(std::string& out, uint32_t value, int digits) {
+    for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) out += HEX_DIGITS[(value >> shift) & 0xF];
+}
+
+} // namespace
+
+RichText::RichText() : alignment(0), positioned(false), x(0), y(0) {}
+
+RichText RichText::parse(std::string_view text, Markup markup) {
+    RichText rich;
+    rich.text.reserve(text.size());
+    if (markup == MARKUP_ASS) rich.parseAss(text);
+    else rich.parseHtml(text);
+    return rich;
+}
+
+std::string RichText::format(Markup markup) const {
+    std::string out;
+    out.reserve(text.size() + 16 * runs.size());
+    if (markup == MARKUP_ASS) formatAss(out);
+    else formatHtml(out, markup == MARKUP_VTT);
+    return out;
+}
+
+const std::string& RichText::getText() const {
+    return text;
+}
+
+const std::vector<RichText::Run>& RichText::getRuns() const {
+    return runs;
+}
+
+int RichText::getAlignment() const {
+    return alignment;
+}
+
+bool RichText::hasPosition() const {
+    return positioned;
+}
+
+int RichText::getX() const {
+    return x;
+}
+
+int RichText::getY() const {
+    return y;
+}
+
+void RichText::addFlags(uint8_t flags) {
+    // Соседние отрезки, отличавшиеся только этими флагами, сливаются
+    std::vector<Run> merged;
+    merged.reserve(runs.size());
+    for (Run run : runs) {
+        run.flags |= flags;
+        if (!merged.empty() && merged.back().flags == run.flags && merged.back().colour == run.colour)
+            merged.back().length += run.length;
+        else
+            merged.push_back(run);
+    }
+    runs.swap(merged);
+}
+
+void RichText::clearFormatting() {
+    runs.clear();
+    if (!text.empty()) runs.push_back(Run{static_cast<uint32_t>(text.size()), NO_COLOUR, 0});
+    alignment = 0;
+    positioned = false;
+}
+
+uint8_t RichText::flagOf(std::string_view tag) {
+    if (tag == "b") return BOLD;
+    if (tag == "i") return ITALIC;
+    if (tag == "u") return UNDERLINE;
+    if (tag == "s") return STRIKEOUT;
+    return 0;
+}
+
+void RichText::append(std::string_view str, uint8_t flags, uint32_t colour) {
+    if (str.empty()) return;
+    text.append(str.data(), str.size());
+    if (!runs.empty() && runs.back().flags == flags && runs.back().colour == colour)
+        runs.back().length += static_cast<uint32_t>(str.size());
+    else
+        runs.push_back(Run{static_cast<uint32_t>(str.size()), colour, flags});
+}
+
+// Вложенные одинаковые теги учитываются счётчиками, font — стеком цветов.
+// Незнакомые теги (<c.red>, <v Имя>, временные метки WebVTT) отбрасываются
+void RichText::parseHtml(std::string_view markup) {
+    int depth[FLAG_COUNT] = {0, 0, 0, 0};
+    std::vector<uint32_t> colours;
+    auto currentFlags = [&depth] {
+        uint8_t flags = 0;
+        for (size_t f = 0; f < FLAG_COUNT; ++f)
+            if (depth[f] > 0) flags |= FLAG_ORDER[f];
+        return flags;
+    };
+    auto currentColour = [&colours] { return colours.empty() ? NO_COLOUR : colours.back(); };
+
+    size_t start = 0;
+    size_t i = 0;
+    while (i < markup.size()) {
+        char c = markup[i];
+        if (c == '<') {
+            size_t close = markup.find('>', i + 1);
+            if (close == std::string_view::npos) break; // Незакрытый тег остаётся текстом
+            append(markup.substr(start, i - start), currentFlags(), currentColour());
+
+            std::string_view tag = markup.substr(i + 1, close - i - 1);
+            bool closing = !tag.empty() && tag.front() == '/';
+            if (closing) tag.remove_prefix(1);
+            std::string name = tagName(tag);
+
+            if (name == "strong" || name == "em" || name == "strike" || name == "del") {
+                name = name == "strong" ? "b" : name == "em" ? "i" : "s";
+            }
+            uint8_t flag = flagOf(name);
+            if (flag) {
+                for (size_t f = 0; f < FLAG_COUNT; ++f) {
+                    if (FLAG_ORDER[f] != flag) continue;
+                    if (!closing) ++depth[f];
+                    else if (depth[f] > 0) --depth[f];
+                }
+            } else if (name == "font") {
+                if (!closing) {
+                    uint32_t colour = fontColour(tag);
+                    colours.push_back(colour == NO_COLOUR ? currentColour() : colour);
+                } else if (!colours.empty()) {
+                    colours.pop_back();
+                }
+            } else if (name == "br") {
+                append("\n", currentFlags(), currentColour());
+            }
+            i = close + 1;
+            start = i;
+        } else if (c == '{' && i + 1 < markup.size() && markup[i + 1] == '\\') {
+            // {\an8} в SRT: берётся только положение записи
+            size_t close = markup.find('}', i + 1);
+            if (close == std::string_view::npos) break;
+            append(markup.substr(start, i - start), currentFlags(), currentColour());
+            uint8_t ignoredFlags = 0;
+            uint32_t ignoredColour = NO_COLOUR;
+            parseOverrides(markup.substr(i + 1, close - i - 1), ignoredFlags, ignoredColour);
+            i = close + 1;
+            start = i;
+        } else {
+            ++i;
+        }
+    }
+    append(markup.substr(start), currentFlags(), currentColour());
+}
+
+// Как и прежний разбор Dialogue: "\N" — перенос строки, незакрытый блок
+// {...} и всё после него остаются текстом
+void RichText::parseAss(std::string_view markup) {
+    uint8_t flags = 0;
+    uint32_t colour = NO_COLOUR;
+    bool hasClosingBrace = true;
+    size_t start = 0;
+    for (size_t i = 0; i < markup.size(); ++i) {
+        char c = markup[i];
+        if (c == '\\' && i + 1 < markup.size() && markup[i + 1] == 'N') {
+            append(markup.substr(start, i - start), flags, colour);
+            append("\n", flags, colour);
+            start = ++i + 1;
+        } else if (c == '{' && hasClosingBrace) {
+            size_t close = markup.find('}', i + 1);
+            if (close == std::string_view::npos) {
+                hasClosingBrace = false;
+                continue;
+            }
+            append(markup.substr(start, i - start), flags, colour);
+            parseOverrides(markup.substr(i + 1, close - i - 1), flags, colour);
+            i = close;
+            start = i + 1;
+        }
+    }
+    append(markup.substr(start), flags, colour);
+}
+
+void RichText::parseOverrides(std::string_view block, uint8_t& flags, uint32_t& colour) {
+    while (!block.empty()) {
+        size_t slash = block.find('\\');
+        if (slash == std::string_view::npos) break;
+        block.remove_prefix(slash + 1);
+        std::string_view command = block.substr(0, block.find('\\'));
+        while (!command.empty() && (command.back() == ' ' || command.back() == '\t')) command.remove_suffix(1);
+        if (command.empty()) continue;
+
+        if (command.size() == 3 && command.compare(0, 2, "an") == 0 && command[2] >= '1' && command[2] <= '9') {
+            alignment = command[2] - '0';
+        } else if (command.compare(0, 4, "pos(") == 0) {
+            std::string args(command.substr(4));
+            double px, py;
+            if (std::sscanf(args.c_str(), "%lf , %lf", &px, &py) == 2) {
+                positioned = true;
+                x = static_cast<int>(px < 0 ? px - 0.5 : px + 0.5);
+                y = static_cast<int>(py < 0 ? py - 0.5 : py + 0.5);
+            }
+        } else if (command == "r" || (command.front() == 'r' && command.size() > 1 && !isDigit(command[1]))) {
+            flags = 0; // \r и \rИмяСтиля сбрасывают оформление
+            colour = NO_COLOUR;
+        } else if (command.size() >= 2 && isDigit(command[1])) {
+            // \b1, \b700, \i0, \u1, \s0 (цифра сразу после буквы отличает их от \bord, \shad)
+            for (size_t f = 0; f < FLAG_COUNT; ++f) {
+                if (command.front() != ASS_TAGS[f]) continue;
+                if (std::atoi(std::string(command.substr(1)).c_str()) != 0) flags |= FLAG_ORDER[f];
+                else flags &= static_cast<uint8_t>(~FLAG_ORDER[f]);
+            }
+        } else if (command.front() == 'c' || command.compare(0, 2, "1c") == 0) {
+            std::string_view value = command.substr(command.front() == 'c' ? 1 : 2);
+            uint32_t bgr;
+            if (value.empty()) {
+                colour = NO_COLOUR;
+            } else if (value.size() > 2 && value.compare(0, 2, "&H") == 0 && parseHex(value.substr(2), bgr)) {
+                colour = ((bgr & 0xFF) << 16) | (bgr & 0xFF00) | ((bgr >> 16) & 0xFF);
+            }
+        }
+    }
+}
+
+// Теги закрываются в обратном порядке открытия: при смене оформления
+// закрывается всё выше первого ненужного тега, затем открываются недостающие
+void RichText::formatHtml(std::string& out, bool vtt) const {
+    if (!vtt && alignment) {
+        out += "{\\an";
+        out += static_cast<char>('0' + alignment);
+        out += '}';
+    }
+
+    const int FONT = static_cast<int>(FLAG_COUNT);
+    std::vector<int> open; // Индексы FLAG_ORDER или FONT
+    uint32_t openColour = NO_COLOUR;
+    auto closeTag = [&out, FONT](int item) {
+        out += "</";
+        out += item == FONT ? "font" : HTML_TAGS[item];
+        out += '>';
+    };
+
+    size_t offset = 0;
+    for (const Run& run : runs) {
+        uint32_t colour = vtt ? NO_COLOUR : run.colour;
+        size_t keep = 0;
+        while (keep < open.size()) {
+            int item = open[keep];
+            bool wanted = item == FONT ? colour == openColour : (run.flags & FLAG_ORDER[item]) != 0;
+            if (!wanted) break;
+            ++keep;
+        }
+        while (open.size() > keep) {
+            closeTag(open.back());
+            open.pop_back();
+        }
+        bool fontOpen = false;
+        for (int item : open) fontOpen = fontOpen || item == FONT;
+        if (!fontOpen) openColour = NO_COLOUR;
+
+        for (size_t f = 0; f < FLAG_COUNT; ++f) {
+            if (!(run.flags & FLAG_ORDER[f])) continue;
+            bool isOpen = false;
+            for (int item : open) isOpen = isOpen || item == static_cast<int>(f);
+            if (isOpen) continue;
+            out += '<';
+            out += HTML_TAGS[f];
+            out += '>';
+            open.push_back(static_cast<int>(f));
+        }
+        if (colour != NO_COLOUR && !fontOpen) {
+            out += "<font color=\"#";
+            appendHex(out, colour, 6);
+            out += "\">";
+            open.push_back(FONT);
+            openColour = colour;
+        }
+
+        out.append(text, offset, run.length);
+        offset += run.length;
+    }
+    while (!open.empty()) {
+        closeTag(open.back());
+        open.pop_back();
+    }
+}
+
+// Выводятся только изменения оформления между отрезками
+void RichText::formatAss(std::string& out) const {
+    if (alignment || positioned) {
+        out += '{';
+        if (alignment) {
+            out += "\\an";
+            out += static_cast<char>('0' + alignment);
+        }
+        if (positioned) out += "\\pos(" + std::to_string(x) + "," + std::to_string(y) + ")";
+        out += '}';
+    }
+
+    uint8_t flags = 0;
+    uint32_t colour = NO_COLOUR;
+    size_t offset = 0;
+    for (const Run& run : runs) {
+        std::string block;
+        for (size_t f = 0; f < FLAG_COUNT; ++f) {
+            if ((run.flags ^ flags) & FLAG_ORDER[f]) {
+                block += '\\';
+                block += ASS_TAGS[f];
+                block += (run.flags & FLAG_ORDER[f]) ? '1' : '0';
+            }
+        }
+        if (run.colour != colour) {
+            block += "\\c";
+            if (run.colour != NO_COLOUR) {
+                uint32_t bgr = ((run.colour & 0xFF) << 16) | (run.colour & 0xFF00) | ((run.colour >> 16) & 0xFF);
+                block += "&H";
+                appendHex(block, bgr, 6);
+                block += '&';
+            }
+        }
+        if (!block.empty()) out += '{' + block + '}';
+        flags = run.flags;
+        colour = run.colour;
+
+        for (size_t i = offset; i < offset + run.length; ++i) {
+            if (text[i] == '\n') out += "\\N";
+            else out += text[i];
+        }
+        offset += run.length;
+    }
+}
@@ -1,8 +1,12 @@
 #include "SAMISubtitle.h"
-#include <fstream>
-#include <sstream>
-#include <iomanip>
-#include <regex>
+#include "PhaseStats.h"
+#include "Trace.h"
+#include "TagStripper.h"
+#include "MappedFile.h"
+#include "SAMITokenizer.h"
+#include "BufferedWriter.h"
+#include "TimeCode.h"
+#include <cstring>
 #include <stdexcept>
 #include <iostream> // Для диагностики
 
@@ -19,87 +23,158 @@ int64_t SAMISubtitle::parseTime(const std::string& timeStr) {
 }
 
 std::string SAMISubtitle::formatTime(int64_t ms) {
-    return std::to_string(ms);
+    char buf[TimeCode::MAX_LENGTH];
+    return std::string(buf, TimeCode::formatInt(ms, buf));
 }
 
 void SAMISubtitle::read(const std::string& filename) {
-    std::ifstream in(filename);
-    if (!in) throw std::runtime_error("Cannot open file: " + filename);
+    PhaseStats::Scope phase(PhaseStats::PARSE);
+    TRACE_SCOPE("SAMISubtitle::read");
+    readStream(filename, [this](SubtitleEntry&& entry) { entries.push_back(std::move(entry)); });
+}
 
-    std::string line;
-    int64_t previous_end_ms = 0; // Для хранения времени окончания предыдущей строки
-    while (std::getline(in, line)) {
-        if (line.empty()) continue; // пропускаем пустые строки
-
-        // Пропускаем секции <HEAD>, <STYLE>, и другие
-        if (line.find("<HEAD>") != std::string::npos || 
-            line.find("<STYLE") != std::string::npos || 
-            line.find("<SAMIParam>") != std::string::npos ||
-            line.find("<TITLE>") != std::string::npos ||
-            line.find("</HEAD>") != std::string::npos ||
-            line.find("</STYLE>") != std::string::npos ||
-            line.find("</SAMIParam>") != std::string::npos ||
-            line.find("</TITLE>") != std::string::npos) {
-            continue;
-        }
+namespace {
+
+// Текст <P> из файла: переводы строк по краям не нужны, CRLF внутри — LF.
+// Текст без </P> обрывается следующим тегом, поэтому и пробелы перед ним лишние
+std::string cueText(std::string_view raw, bool closedByTag) {
+    while (!raw.empty() && (raw.front() == '\r' || raw.front() == '\n')) raw.remove_prefix(1);
+    const char* trailing = closedByTag ? "\r\n" : " \t\r\n";
+    while (!raw.empty() && std::strchr(trailing, raw.back())) raw.remove_suffix(1);
+
+    std::string text;
+    text.reserve(raw.size());
+    while (!raw.empty()) {
+        const void* cr = std::memchr(raw.data(), '\r', raw.size());
+        size_t n = cr ? static_cast<const char*>(cr) - raw.data() : raw.size();
+        text.append(raw.data(), n);
+        raw.remove_prefix(n);
+        if (raw.empty()) break;
+        if (raw.size() < 2 || raw[1] != '\n') text += '\r';
+        raw.remove_prefix(1);
+    }
+    return text;
+}
 
-        // Найти <SYNC Start=32940><P>1st block of Taito district, Shin-Ueno line.</P></SYNC>
-        size_t syncPos = line.find("<SYNC");
-        if (syncPos != std::string::npos) {
-            size_t startPos = line.find("Start=", syncPos) + 6;
-            size_t endPos = line.find(" ", startPos);
-            std::string startStr = line.substr(startPos, endPos - startPos);
-
-            int64_t start_ms = parseTime(startStr);
-            int64_t end_ms = 0;
-
-            size_t endSyncPos = line.find("End=", syncPos);
-            if (endSyncPos != std::string::npos) {
-                endSyncPos += 4;
-                size_t endSyncEndPos = line.find(">", endSyncPos);
-                std::string endStr = line.substr(endSyncPos, endSyncEndPos - endSyncPos);
-                end_ms = parseTime(endStr);
-            } else {
-                // Если метки End нет, используем начало следующей строки в качестве конца
-                end_ms = start_ms;
-            }
+} // namespace
+
+// Записи и текст могут занимать несколько строк: <SYNC> заканчивается
+// следующим <SYNC>, </SYNC> или </BODY>, текст первого <P> — на </P>,
+// следующем <P> или конце <SYNC>. Разметка внутри <P> (<BR>, <FONT>)
+// сохраняется в тексте как есть.
+void SAMISubtitle::readStream(const std::string& filename, const EntrySink& sink) {
+    TRACE_SCOPE("SAMISubtitle::readStream");
+    MappedFile file(filename);
+    file.decodeText();
+    std::string_view buffer = file.view();
+    SAMITokenizer tokenizer(buffer);
+
+    // Время окончания последней записи известно только в конце файла,
+    // поэтому одна запись задерживается перед передачей в sink
+    SubtitleEntry pending;
+    bool hasPending = false;
+    int64_t previous_end_ms = 0; // Для хранения времени окончания предыдущей строки
 
-            size_t pStart = line.find("<P>", endPos) + 3;
-            size_t pEnd = line.find("</P>", pStart);
-            std::string text = line.substr(pStart, pEnd - pStart);
+    bool inHead = false;
+    bool inSync = false;
+    int64_t start_ms = 0;
+    int64_t end_ms = 0;
+    bool inText = false;   // Внутри первого <P> текущего <SYNC>
+    bool hasText = false;  // Первый <P> уже прочитан
+    size_t textBegin = 0;
+    std::string text;
+
+    auto finishText = [&](size_t textEnd, bool closedByTag) {
+        if (!inText) return;
+        text = cueText(buffer.substr(textBegin, textEnd - textBegin), closedByTag);
+        inText = false;
+        hasText = true;
+    };
+    auto finishSync = [&](size_t syncEnd) {
+        finishText(syncEnd, false);
+        if (!inSync) return;
+        inSync = false;
+
+        // Устанавливаем время окончания предыдущей строки, если оно было равно 0
+        if (previous_end_ms == 0) {
+            previous_end_ms = start_ms;
+        }
 
-            // Устанавливаем время окончания предыдущей строки, если оно было равно 0
-            if (previous_end_ms == 0) {
-                previous_end_ms = start_ms;
+        if (hasPending) sink(std::move(pending));
+        pending = SubtitleEntry(previous_end_ms, start_ms, std::move(text));
+        hasPending = true;
+        previous_end_ms = end_ms;
+        text.clear();
+        hasText = false;
+        file.release(syncEnd);
+    };
+
+    SAMITokenizer::Token token;
+    while (tokenizer.next(token)) {
+        if (token.type != SAMITokenizer::TOKEN_TAG) continue;
+
+        // Пропускаем <HEAD> вместе с <STYLE>, <TITLE> и <SAMIParam>
+        if (SAMITokenizer::equals(token.name, "head")) {
+            inHead = !token.closing;
+            continue;
+        }
+        if (inHead) continue;
+
+        if (SAMITokenizer::equals(token.name, "sync")) {
+            finishSync(token.begin);
+            if (token.closing) continue;
+
+            std::string_view value;
+            if (!SAMITokenizer::attribute(token.attributes, "start", value)) continue;
+            start_ms = parseTime(std::string(value));
+            // Если метки End нет, используем начало следующей строки в качестве конца
+            end_ms = SAMITokenizer::attribute(token.attributes, "end", value) ? parseTime(std::string(value)) : start_ms;
+            inSync = true;
+        } else if (SAMITokenizer::equals(token.name, "p")) {
+            if (inText) {
+                finishText(token.begin, token.closing); // </P> или следующий <P>
+            } else if (!token.closing && inSync && !hasText) {
+                inText = true;
+                textBegin = token.end;
             }
-
-            SubtitleEntry entry;
-            entry.start_ms = previous_end_ms;
-            entry.end_ms = start_ms;
-            entry.text = text;
-
-            entries.push_back(entry);
-            previous_end_ms = end_ms;
+        } else if (token.closing && (SAMITokenizer::equals(token.name, "body") || SAMITokenizer::equals(token.name, "sami"))) {
+            finishSync(token.begin);
         }
     }
+    finishSync(buffer.size());
 
     // Устанавливаем время окончания для последней строки, если необходимо
-    if (!entries.getSize() == 0 && previous_end_ms != 0) {
-        entries[entries.getSize() - 1].end_ms = previous_end_ms;
+    if (hasPending) {
+        if (previous_end_ms != 0) pending.end_ms = previous_end_ms;
+        sink(std::move(pending));
     }
 }
 
 void SAMISubtitle::write(const std::string& filename) const {
-    std::ofstream out(filename);
-    if (!out) throw std::runtime_error("Cannot write file: " + filename);
+    PhaseStats::Scope phase(PhaseStats::FORMAT);
+    TRACE_SCOPE("SAMISubtitle::write");
+    PhaseStats::addCues(entries.getSize());
+    BufferedWriter out(filename);
 
+    writeHeader(out);
+    for (size_t i = 0; i < entries.getSize(); ++i) {
+        writeEntry(out, entries.view(i), i);
+    }
+    writeFooter(out);
+    out.close();
+}
+
+void SAMISubtitle::writeHeader(BufferedWriter& out) {
     // Восстанавливаем структуру SAMI файла
     out << "<SAMI>\n<HEAD>\n<TITLE>file</TITLE>\n<SAMIParam>\n  Metrics {time:ms;}\n  Spec {MSFT:1.0;}\n</SAMIParam>\n";
     out << "<STYLE TYPE=\"text/css\">\n<!--\n  P { font-family: Arial; font-weight: normal; color: white; background-color: black; text-align: center; }\n  .ENUSCC { name: English; lang: en-US ; SAMIType: CC ; }\n-->\n</STYLE>\n</HEAD>\n<BODY>\n";
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        const SubtitleEntry& e = entries[i];
-        out << "<SYNC Start=" << formatTime(e.start_ms) << " End=" << formatTime(e.end_ms) << "><P>" << e.text << "</P></SYNC>\n";
-    }
+}
+
+void SAMISubtitle::writeEntry(BufferedWriter& out, const SubtitleEntryView& e, size_t) {
+    out << "<SYNC Start=" << e.start_ms << " End=" << e.end_ms << "><P>" << e.text << "</P></SYNC>\n";
+}
+
+void SAMISubtitle::writeFooter(BufferedWriter& out) {
     out << "</BODY>\n</SAMI>\n";
 }
 
@@ -108,25 +183,29 @@ SubtitleEntryList& SAMISubtitle::getEntries() {
 }
 
 void SAMISubtitle::removeFormatting() {
-    std::regex removeTags("<[^>]*>");
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        entries[i].text = std::regex_replace(entries[i].text, removeTags, "");
-    }
+    TransformPipeline pipeline;
+    pipeline.setRemoveFormatting(true);
+    transform(pipeline);
 }
 
 void SAMISubtitle::addDefaultStyle(const std::string& style) {
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        entries[i].text = "<" + style + ">" + entries[i].text + "</" + style + ">";
-    }
+    TransformPipeline pipeline;
+    pipeline.setStyle(style);
+    transform(pipeline);
 }
 
 void SAMISubtitle::shiftTime(int64_t delta_ms, TimeShiftType type) {
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        if (type == START_END || type == START_ONLY) {
-            entries[i].start_ms += delta_ms;
-        }
-        if (type == START_END || type == END_ONLY) {
-            entries[i].end_ms += delta_ms;
-        }
-    }
+    PhaseStats::Scope phase(PhaseStats::SHIFT);
+    TRACE_SCOPE("SAMISubtitle::shiftTime");
+    entries.shiftTimes(delta_ms, type == START_END || type == START_ONLY, type == START_END || type == END_ONLY, false);
+}
+
+void SAMISubtitle::remapTime(const TimeRemap& remap) {
+    PhaseStats::Scope phase(PhaseStats::SHIFT);
+    TRACE_SCOPE("SAMISubtitle::remapTime");
+    entries.remapTimes(remap, false);
+}
+
+void SAMISubtitle::transform(const TransformPipeline& pipeline) {
+    pipeline.apply(entries, TagStripper::removeHtmlTags, false);
 }
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "SAMITokenizer.h"
+#include <cstring>
+
+namespace {
+
+char toLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+} // namespace
+
+SAMITokenizer::SAMITokenizer(std::string_view buffer) : buffer(buffer), pos(0), inStyle(false) {}
+
+size_t SAMITokenizer::tell() const {
+    return pos;
+}
+
+bool SAMITokenizer::equals(std::string_view name, std::string_view lowerName) {
+    if (name.size() != lowerName.size()) return false;
+    for (size_t i = 0; i < name.size(); ++i)
+        if (toLower(name[i]) != lowerName[i]) return false;
+    return true;
+}
+
+bool SAMITokenizer::attribute(std::string_view attributes, std::string_view lowerName, std::string_view& value) {
+    size_t i = 0;
+    while (i < attributes.size()) {
+        while (i < attributes.size() && (isSpace(attributes[i]) || attributes[i] == '/')) ++i;
+        size_t nameBegin = i;
+        while (i < attributes.size() && !isSpace(attributes[i]) && attributes[i] != '=') ++i;
+        std::string_view name = attributes.substr(nameBegin, i - nameBegin);
+        while (i < attributes.size() && isSpace(attributes[i])) ++i;
+        if (name.empty()) break;
+
+        std::string_view current;
+        if (i < attributes.size() && attributes[i] == '=') {
+            ++i;
+            while (i < attributes.size() && isSpace(attributes[i])) ++i;
+            if (i < attributes.size() && (attributes[i] == '"' || attributes[i] == '\'')) {
+                char quote = attributes[i++];
+                size_t valueEnd = attributes.find(quote, i);
+                if (valueEnd == std::string_view::npos) valueEnd = attributes.size();
+                current = attributes.substr(i, valueEnd - i);
+                i = valueEnd + 1;
+            } else {
+                size_t valueBegin = i;
+                while (i < attributes.size() && !isSpace(attributes[i])) ++i;
+                current = attributes.substr(valueBegin, i - valueBegin);
+            }
+        }
+        if (equals(name, lowerName)) {
+            value = current;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Поиск "</style" без учёта регистра; конец буфера, если его нет
+size_t SAMITokenizer::findClosingStyle(size_t from) const {
+    const char* data = buffer.data();
+    while (from < buffer.size()) {
+        const void* lt = std::memchr(data + from, '<', buffer.size() - from);
+        if (!lt) break;
+        size_t at = static_cast<const char*>(lt) - data;
+        if (buffer.size() - at >= 7 && buffer[at + 1] == '/' && equals(buffer.substr(at + 2, 5), "style")) return at;
+        from = at + 1;
+    }
+    return buffer.size();
+}
+
+bool SAMITokenizer::next(Token& token) {
+    const char* data = buffer.data();
+    size_t size = buffer.size();
+
+    while (pos < size) {
+        token.name = std::string_view();
+        token.attributes = std::string_view();
+        token.closing = false;
+        token.begin = pos;
+
+        if (inStyle) {
+            inStyle = false;
+            size_t end = findClosingStyle(pos);
+            if (end == pos) continue;
+            token.type = TOKEN_TEXT;
+            token.end = pos = end;
+            return true;
+        }
+
+        if (data[pos] != '<') {
+            const void* lt = std::memchr(data + pos, '<', size - pos);
+            token.type = TOKEN_TEXT;
+            token.end = pos = lt ? static_cast<const char*>(lt) - data : size;
+            return true;
+        }
+
+        // Комментарий пропускается целиком
+        if (buffer.compare(pos, 4, "<!--") == 0) {
+            size_t end = buffer.find("-->", pos + 4);
+            pos = end == std::string_view::npos ? size : end + 3;
+            continue;
+        }
+
+        const void* gt = std::memchr(data + pos + 1, '>', size - pos - 1);
+        if (!gt) {
+            // Незакрытый '<' — просто текст до конца буфера
+            token.type = TOKEN_TEXT;
+            token.end = pos = size;
+            return true;
+        }
+        size_t end = static_cast<const char*>(gt) - data;
+        std::string_view inner = buffer.substr(pos + 1, end - pos - 1);
+        if (!inner.empty() && inner.front() == '/') {
+            token.closing = true;
+            inner.remove_prefix(1);
+        }
+        size_t nameEnd = 0;
+        while (nameEnd < inner.size() && !isSpace(inner[nameEnd]) && inner[nameEnd] != '/') ++nameEnd;
+
+        token.type = TOKEN_TAG;
+        token.name = inner.substr(0, nameEnd);
+        token.attributes = inner.substr(nameEnd);
+        token.end = pos = end + 1;
+        if (!token.closing && equals(token.name, "style")) inStyle = true;
+        return true;
+    }
+    return false;
+}
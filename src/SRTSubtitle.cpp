@@ -1,8 +1,12 @@
 #include "SRTSubtitle.h"
-#include <fstream>
-#include <sstream>
-#include <iomanip>
-#include <regex>
+#include "PhaseStats.h"
+#include "Trace.h"
+#include "TagStripper.h"
+#include "MappedFile.h"
+#include "TimeCode.h"
+#include "ParallelParser.h"
+#include "ParallelWriter.h"
+#include <cstring>
 #include <stdexcept>
 
 int64_t SRTSubtitle::parseTime(const std::string& timeStr) {
@@ -12,32 +16,23 @@ int64_t SRTSubtitle::parseTime(const std::string& timeStr) {
 }
 
 std::string SRTSubtitle::formatTime(int64_t ms) {
-    int h = ms / 3600000;
-    ms %= 3600000;
-    int m = ms / 60000;
-    ms %= 60000;
-    int s = ms / 1000;
-    ms %= 1000;
-    std::ostringstream oss;
-    oss << std::setfill('0') << std::setw(2) << h << ":"
-        << std::setw(2) << m << ":"
-        << std::setw(2) << s << ","
-        << std::setw(3) << ms;
-    return oss.str();
+    return TimeCode::toSRT(ms);
 }
 
-void SRTSubtitle::parseEntry(std::ifstream& in) {
-    std::string line;
-    if (!std::getline(in, line) || line.empty()) return; // Пропускаем номер строки
+void SRTSubtitle::parseEntry(LineReader& in, const EntrySink& sink) {
+    TRACE_SCOPE("SRTSubtitle::parseEntry");
+    std::string_view line;
+    if (!in.getLine(line) || line.empty()) return; // Пропускаем номер строки
 
-    std::string timeLine;
-    if (!std::getline(in, timeLine)) return;
+    std::string_view timeLine;
+    if (!in.getLine(timeLine)) return;
 
     size_t arrow = timeLine.find("-->");
-    if (arrow == std::string::npos) throw std::runtime_error("Invalid time format in SRT file");
+    if (arrow == std::string_view::npos) throw std::runtime_error("Invalid time format in SRT file");
 
-    std::string startStr = timeLine.substr(0, arrow - 1);
-    std::string endStr = timeLine.substr(arrow + 4);
+    // Короткие строки времени помещаются в SSO-буфер std::string и не выделяют память
+    std::string startStr(timeLine.substr(0, arrow - 1));
+    std::string endStr(timeLine.substr(arrow + 4));
 
     int64_t start_ms = parseTime(startStr);
     int64_t end_ms = parseTime(endStr);
@@ -47,47 +42,97 @@ void SRTSubtitle::parseEntry(std::ifstream& in) {
     entry.end_ms = end_ms;
 
     size_t coordPos = timeLine.find("X1:");
-    if (coordPos != std::string::npos) {
-        sscanf(timeLine.c_str() + coordPos, "X1:%d X2:%d Y1:%d Y2:%d", &entry.x1, &entry.x2, &entry.y1, &entry.y2);
+    if (coordPos != std::string_view::npos) {
+        std::string coords(timeLine.substr(coordPos));
+        sscanf(coords.c_str(), "X1:%d X2:%d Y1:%d Y2:%d", &entry.x1, &entry.x2, &entry.y1, &entry.y2);
         entry.has_coordinates = true;
     }
 
-    std::string text;
-    while (std::getline(in, line) && !line.empty()) {
+    std::string& text = entry.text;
+    while (in.getLine(line) && !line.empty()) {
         if (!text.empty()) text += "\n";
         text += line;
     }
 
-    entry.text = text;
-    entries.push_back(entry);
+    sink(std::move(entry));
 }
 
-void SRTSubtitle::writeEntry(std::ofstream& out, const SubtitleEntry& entry, size_t index) const {
-    out << (index + 1) << "\n";
-    out << formatTime(entry.start_ms) << " --> " << formatTime(entry.end_ms);
+void SRTSubtitle::writeEntry(BufferedWriter& out, const SubtitleEntryView& entry, size_t index) {
+    out << (index + 1) << '\n';
+
+    // Метки времени пишутся прямо в буфер вывода
+    char* p = out.reserve(2 * TimeCode::MAX_LENGTH + 5);
+    size_t n = TimeCode::formatSRT(entry.start_ms, p);
+    std::memcpy(p + n, " --> ", 5);
+    n += 5;
+    n += TimeCode::formatSRT(entry.end_ms, p + n);
+    out.commit(n);
+
     if (entry.has_coordinates) {
         out << " X1:" << entry.x1 << " X2:" << entry.x2 << " Y1:" << entry.y1 << " Y2:" << entry.y2;
     }
-    out << "\n";
+    out << '\n';
     out << entry.text << "\n\n";
 }
 
-void SRTSubtitle::read(const std::string& filename) {
-    std::ifstream in(filename);
-    if (!in) throw std::runtime_error("Cannot open file: " + filename);
+size_t SRTSubtitle::entrySize(const SubtitleEntryView& entry, size_t index) {
+    size_t size = TimeCode::lengthInt(static_cast<int64_t>(index + 1)) + 1;
+    size += TimeCode::lengthSRT(entry.start_ms) + 5 + TimeCode::lengthSRT(entry.end_ms);
+    if (entry.has_coordinates) {
+        size += 16 + TimeCode::lengthInt(entry.x1) + TimeCode::lengthInt(entry.x2) +
+                TimeCode::lengthInt(entry.y1) + TimeCode::lengthInt(entry.y2);
+    }
+    return size + 1 + entry.text.size() + 2;
+}
+
+void SRTSubtitle::writeHeader(BufferedWriter&) {}
 
+void SRTSubtitle::writeFooter(BufferedWriter&) {}
+
+void SRTSubtitle::parseChunk(std::string_view chunk, const EntrySink& sink) {
+    LineReader in(chunk);
+    while (!in.eof()) parseEntry(in, sink);
+}
+
+void SRTSubtitle::read(const std::string& filename, size_t threads) {
+    PhaseStats::Scope phase(PhaseStats::PARSE);
+    TRACE_SCOPE("SRTSubtitle::read");
+    // Файл открывается и перекодируется один раз: если ParallelParser
+    // отказался, тот же текст разбирается последовательно
+    MappedFile file(filename);
+    file.decodeText();
+    if (threads != 1 && ParallelParser::parse(file.view(), 0, threads, parseChunk, entries)) return;
+    parseFile(file, [this](SubtitleEntry&& entry) { entries.push_back(std::move(entry)); });
+}
+
+void SRTSubtitle::readStream(const std::string& filename, const EntrySink& sink) {
+    TRACE_SCOPE("SRTSubtitle::readStream");
+    MappedFile file(filename);
+    file.decodeText();
+    parseFile(file, sink);
+}
+
+void SRTSubtitle::parseFile(MappedFile& file, const EntrySink& sink) {
+    LineReader in(file.view());
     while (!in.eof()) {
-        parseEntry(in);
+        parseEntry(in, sink);
+        file.release(in.tell());
     }
 }
 
-void SRTSubtitle::write(const std::string& filename) const {
-    std::ofstream out(filename);
-    if (!out) throw std::runtime_error("Cannot write file: " + filename);
+void SRTSubtitle::write(const std::string& filename, size_t threads) const {
+    PhaseStats::Scope phase(PhaseStats::FORMAT);
+    TRACE_SCOPE("SRTSubtitle::write");
+    PhaseStats::addCues(entries.getSize());
+    if (threads != 1 && ParallelWriter::write(filename, entries, "", "", entrySize, writeEntry, threads)) return;
+    BufferedWriter out(filename);
 
+    writeHeader(out);
     for (size_t i = 0; i < entries.getSize(); ++i) {
-        writeEntry(out, entries[i], i);
+        writeEntry(out, entries.view(i), i);
     }
+    writeFooter(out);
+    out.close();
 }
 
 SubtitleEntryList& SRTSubtitle::getEntries() {
@@ -95,25 +140,29 @@ SubtitleEntryList& SRTSubtitle::getEntries() {
 }
 
 void SRTSubtitle::removeFormatting() {
-    std::regex removeTags("<[^>]*>");
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        entries[i].text = std::regex_replace(entries[i].text, removeTags, "");
-    }
+    TransformPipeline pipeline;
+    pipeline.setRemoveFormatting(true);
+    transform(pipeline);
 }
 
 void SRTSubtitle::addDefaultStyle(const std::string& style) {
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        entries[i].text = "<" + style + ">" + entries[i].text + "</" + style + ">";
-    }
+    TransformPipeline pipeline;
+    pipeline.setStyle(style);
+    transform(pipeline);
 }
 
 void SRTSubtitle::shiftTime(int64_t delta_ms, TimeShiftType type) {
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        if (type == START_END || type == START_ONLY) {
-            entries[i].start_ms += delta_ms;
-        }
-        if (type == START_END || type == END_ONLY) {
-            entries[i].end_ms += delta_ms;
-        }
-    }
+    PhaseStats::Scope phase(PhaseStats::SHIFT);
+    TRACE_SCOPE("SRTSubtitle::shiftTime");
+    entries.shiftTimes(delta_ms, type == START_END || type == START_ONLY, type == START_END || type == END_ONLY, false);
+}
+
+void SRTSubtitle::remapTime(const TimeRemap& remap) {
+    PhaseStats::Scope phase(PhaseStats::SHIFT);
+    TRACE_SCOPE("SRTSubtitle::remapTime");
+    entries.remapTimes(remap, false);
+}
+
+void SRTSubtitle::transform(const TransformPipeline& pipeline) {
+    pipeline.apply(entries, TagStripper::removeHtmlTags, false);
 }
\ No newline at end of file
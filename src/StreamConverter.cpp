@@ -0,0 +1,166 @@
+#include "StreamConverter.h"
+#include "PhaseStats.h"
+#include "Trace.h"
+#include "BoundedQueue.h"
+#include "SRTSubtitle.h"
+#include "VTTSubtitle.h"
+#include "SAMISubtitle.h"
+#include "TagStripper.h"
+#include "TransformPipeline.h"
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum StreamFormat {
+    FORMAT_SRT,
+    FORMAT_VTT,
+    FORMAT_SAMI,
+    FORMAT_NONE
+};
+
+StreamFormat formatFromExtension(const std::string& extension) {
+    if (extension == "srt") return FORMAT_SRT;
+    if (extension == "vtt") return FORMAT_VTT;
+    if (extension == "smi") return FORMAT_SAMI;
+    return FORMAT_NONE;
+}
+
+RichText::Markup markupOf(StreamFormat format) {
+    return format == FORMAT_VTT ? RichText::MARKUP_VTT : RichText::MARKUP_HTML;
+}
+
+// Поток записи закрыл очередь: разбор нужно прекратить
+struct StreamAborted {};
+
+void readStream(StreamFormat format, const std::string& filename, bool keepNotes, const EntrySink& sink) {
+    switch (format) {
+        case FORMAT_SRT: SRTSubtitle().readStream(filename, sink); break;
+        case FORMAT_VTT: VTTSubtitle().readStream(filename, keepNotes, sink); break;
+        case FORMAT_SAMI: SAMISubtitle().readStream(filename, sink); break;
+        case FORMAT_NONE: break;
+    }
+}
+
+void writeHeader(StreamFormat format, BufferedWriter& out) {
+    switch (format) {
+        case FORMAT_SRT: SRTSubtitle::writeHeader(out); break;
+        case FORMAT_VTT: VTTSubtitle::writeHeader(out); break;
+        case FORMAT_SAMI: SAMISubtitle::writeHeader(out); break;
+        case FORMAT_NONE: break;
+    }
+}
+
+void writeEntry(StreamFormat format, BufferedWriter& out, const SubtitleEntry& entry, size_t index) {
+    switch (format) {
+        case FORMAT_SRT: SRTSubtitle::writeEntry(out, entry, index); break;
+        case FORMAT_VTT: VTTSubtitle::writeEntry(out, entry, index); break;
+        case FORMAT_SAMI: SAMISubtitle::writeEntry(out, entry, index); break;
+        case FORMAT_NONE: break;
+    }
+}
+
+void writeFooter(StreamFormat format, BufferedWriter& out) {
+    switch (format) {
+        case FORMAT_SRT: SRTSubtitle::writeFooter(out); break;
+        case FORMAT_VTT: VTTSubtitle::writeFooter(out); break;
+        case FORMAT_SAMI: SAMISubtitle::writeFooter(out); break;
+        case FORMAT_NONE: break;
+    }
+}
+
+} // namespace
+
+StreamConverter::Options::Options()
+    : shiftTimeMs(0), removeFormatting(false), richText(false), batchSize(256), queueDepth(16) {}
+
+bool StreamConverter::canStream(const std::string& inExtension, const std::string& outExtension) {
+    return formatFromExtension(inExtension) != FORMAT_NONE && formatFromExtension(outExtension) != FORMAT_NONE;
+}
+
+void StreamConverter::convert(const std::string& inFile, const std::string& outFile, const Options& options) {
+    std::string inExtension = inFile.substr(inFile.find_last_of(".") + 1);
+    std::string outExtension = outFile.substr(outFile.find_last_of(".") + 1);
+    StreamFormat inFormat = formatFromExtension(inExtension);
+    StreamFormat outFormat = formatFromExtension(outExtension);
+    if (inFormat == FORMAT_NONE || outFormat == FORMAT_NONE) {
+        throw std::runtime_error("Streaming is not supported for " + inExtension + " -> " + outExtension);
+    }
+    bool keepNotes = inFormat == FORMAT_VTT && outFormat == FORMAT_VTT;
+
+    // Те же преобразования, что и у классов субтитров, для каждой записи
+    TransformPipeline pipeline;
+    pipeline.setRemap(options.remap);
+    pipeline.setShift(options.shiftTimeMs);
+    pipeline.setRemoveFormatting(options.removeFormatting);
+    pipeline.setStyle(options.addStyle);
+    if (options.richText) pipeline.setMarkup(markupOf(inFormat), markupOf(outFormat));
+    bool skipNotes = inFormat == FORMAT_VTT;
+    size_t batchSize = options.batchSize ? options.batchSize : 1;
+
+    // Файл открывается до запуска потоков, чтобы ошибка открытия не требовала их остановки
+    BufferedWriter out(outFile);
+
+    using Batch = std::vector<SubtitleEntry>;
+    BoundedQueue<Batch> queue(options.queueDepth);
+    std::exception_ptr parseError;
+
+    // Поток разбора: записи копятся в пакет и передаются в очередь
+    std::thread parser([&] {
+        TRACE_THREAD_NAME("stream parser");
+        Batch batch;
+        batch.reserve(batchSize);
+        EntrySink sink = [&](SubtitleEntry&& entry) {
+            batch.push_back(std::move(entry));
+            if (batch.size() == batchSize) {
+                if (!queue.push(std::move(batch))) throw StreamAborted();
+                batch = Batch();
+                batch.reserve(batchSize);
+            }
+        };
+
+        try {
+            readStream(inFormat, inFile, keepNotes, sink);
+            if (!batch.empty()) queue.push(std::move(batch));
+        } catch (const StreamAborted&) {
+            // Поток записи завершился с ошибкой
+        } catch (...) {
+            parseError = std::current_exception();
+        }
+        queue.close();
+    });
+
+    // Текущий поток преобразует записи и пишет их по мере поступления
+    try {
+        TRACE_SCOPE("StreamConverter::write");
+        writeHeader(outFormat, out);
+
+        size_t index = 0;
+        Batch batch;
+        while (queue.pop(batch)) {
+            for (SubtitleEntry& entry : batch) {
+                pipeline.apply(entry, TagStripper::removeHtmlTags, skipNotes);
+                writeEntry(outFormat, out, entry, index++);
+            }
+        }
+
+        parser.join();
+        if (parseError) std::rethrow_exception(parseError);
+        PhaseStats::addCues(index);
+
+        writeFooter(outFormat, out);
+        out.close();
+    } catch (...) {
+        queue.close();
+        if (parser.joinable()) parser.join();
+        try {
+            out.close();
+        } catch (...) {
+        }
+        std::remove(outFile.c_str()); // Не оставляем частично записанный файл
+        throw;
+    }
+}
@@ -1,47 +1,395 @@
 #include "SubtitleEntryList.h"
+#include "TimeShifter.h"
+#include <algorithm>
 #include <stdexcept>
-#include <cstring>
+#include <utility>
 
-SubtitleEntryList::SubtitleEntryList() : data(nullptr), size(0), capacity(0) {}
+SubtitleEntryList::Table::Table() : data(nullptr), size(0), capacity(0) {}
 
-SubtitleEntryList::~SubtitleEntryList() {
+SubtitleEntryList::Table::~Table() {
     delete[] data;
 }
 
+SubtitleEntryList::EntryRef::EntryRef(SubtitleEntry& entry, int64_t& start, int64_t& end)
+    : start_ms(start), end_ms(end), text(entry.text), formatting(entry.formatting),
+      x1(entry.x1), x2(entry.x2), y1(entry.y1), y2(entry.y2), has_coordinates(entry.has_coordinates) {}
+
+SubtitleEntryList::ConstEntryRef::ConstEntryRef(const SubtitleEntry& entry, const int64_t& start, const int64_t& end)
+    : start_ms(start), end_ms(end), text(entry.text), formatting(entry.formatting),
+      x1(entry.x1), x2(entry.x2), y1(entry.y1), y2(entry.y2), has_coordinates(entry.has_coordinates) {}
+
+// Пустой список не выделяет таблицу до первой вставки
+SubtitleEntryList::SubtitleEntryList() : mode(STORAGE_ENTRIES) {}
+
+SubtitleEntryList::SubtitleEntryList(StorageMode mode) : mode(mode) {}
+
+SubtitleEntryList::~SubtitleEntryList() = default;
+
+// Копия разделяет таблицу с оригиналом, данные копируются только при изменении
+SubtitleEntryList::SubtitleEntryList(const SubtitleEntryList& other) : table(other.table), mode(other.mode) {}
+
+SubtitleEntryList::SubtitleEntryList(SubtitleEntryList&& other) noexcept
+    : table(std::move(other.table)), mode(other.mode) {}
+
+SubtitleEntryList& SubtitleEntryList::operator=(const SubtitleEntryList& other) {
+    table = other.table;
+    mode = other.mode;
+    return *this;
+}
+
+SubtitleEntryList& SubtitleEntryList::operator=(SubtitleEntryList&& other) noexcept {
+    if (this != &other) {
+        table = std::move(other.table);
+        mode = other.mode;
+    }
+    return *this;
+}
+
 void SubtitleEntryList::resize(size_t new_capacity) {
-    SubtitleEntry* new_data = new SubtitleEntry[new_capacity];
-    for (size_t i = 0; i < size; ++i)
-        new_data[i] = data[i];
-    delete[] data;
-    data = new_data;
-    capacity = new_capacity;
+    EntryPtr* new_data = new EntryPtr[new_capacity];
+    for (size_t i = 0; i < table->size; ++i)
+        new_data[i] = std::move(table->data[i]);
+    delete[] table->data;
+    table->data = new_data;
+    table->capacity = new_capacity;
+}
+
+void SubtitleEntryList::detach() {
+    if (!table) {
+        table = std::make_shared<Table>();
+        return;
+    }
+    if (table.use_count() == 1) return;
+
+    auto copy = std::make_shared<Table>();
+    copy->start = table->start;
+    copy->end = table->end;
+    if (mode == STORAGE_ARENA) {
+        // Арена копируется целиком: ссылки на текст в записях остаются верными
+        copy->texts = table->texts;
+        copy->rare = table->rare;
+        copy->arena = table->arena;
+    } else {
+        // Копируем только указатели: записи остаются общими до первого изменения
+        copy->data = new EntryPtr[table->capacity];
+        copy->capacity = table->capacity;
+        copy->size = table->size;
+        for (size_t i = 0; i < table->size; ++i)
+            copy->data[i] = table->data[i];
+    }
+    table = std::move(copy);
+}
+
+SubtitleEntry& SubtitleEntryList::mutableAt(size_t index) {
+    detach();
+    EntryPtr& item = table->data[index];
+    if (item.use_count() > 1)
+        item = std::make_shared<SubtitleEntry>(*item);
+    return *item;
+}
+
+void SubtitleEntryList::checkIndex(size_t index) const {
+    if (index >= getSize()) throw std::out_of_range("Index out of range");
+}
+
+// Записи добавляются только в конец, поэтому таблица уже упорядочена
+const SubtitleEntryList::RareFields* SubtitleEntryList::findRare(size_t index) const {
+    const std::vector<RareFields>& rare = table->rare;
+    if (rare.empty()) return nullptr;
+    auto it = std::lower_bound(rare.begin(), rare.end(), index,
+                               [](const RareFields& fields, size_t i) { return fields.index < i; });
+    return it != rare.end() && it->index == index ? &*it : nullptr;
+}
+
+void SubtitleEntryList::setStorageMode(StorageMode new_mode) {
+    if (new_mode == mode) return;
+
+    SubtitleEntryList converted(new_mode);
+    for (size_t i = 0; i < getSize(); ++i)
+        converted.push_back(view(i));
+    *this = std::move(converted);
+}
+
+SubtitleEntryList::StorageMode SubtitleEntryList::getStorageMode() const {
+    return mode;
 }
 
 void SubtitleEntryList::push_back(const SubtitleEntry& entry) {
-    if (size == capacity) {
-        size_t new_capacity = capacity == 0 ? 4 : capacity * 2;
+    if (mode == STORAGE_ARENA) {
+        push_back(SubtitleEntryView(entry));
+        return;
+    }
+    push_back(SubtitleEntry(entry));
+}
+
+void SubtitleEntryList::push_back(const SubtitleEntryView& entry) {
+    if (mode == STORAGE_ARENA) {
+        detach();
+        if (!entry.formatting.empty() || entry.has_coordinates || entry.x1 || entry.x2 || entry.y1 || entry.y2) {
+            RareFields rare;
+            rare.index = table->texts.size();
+            rare.formatting = table->arena.append(entry.formatting);
+            rare.x1 = entry.x1;
+            rare.x2 = entry.x2;
+            rare.y1 = entry.y1;
+            rare.y2 = entry.y2;
+            rare.has_coordinates = entry.has_coordinates;
+            table->rare.push_back(rare);
+        }
+        table->texts.push_back(table->arena.append(entry.text));
+        table->start.push_back(entry.start_ms);
+        table->end.push_back(entry.end_ms);
+        return;
+    }
+
+    SubtitleEntry copy(entry.start_ms, entry.end_ms, std::string(entry.text));
+    copy.formatting.assign(entry.formatting.data(), entry.formatting.size());
+    copy.x1 = entry.x1;
+    copy.x2 = entry.x2;
+    copy.y1 = entry.y1;
+    copy.y2 = entry.y2;
+    copy.has_coordinates = entry.has_coordinates;
+    push_back(std::move(copy));
+}
+
+void SubtitleEntryList::reserve(size_t count, size_t textBytes) {
+    detach();
+    table->start.reserve(count);
+    table->end.reserve(count);
+    if (mode == STORAGE_ARENA) {
+        table->texts.reserve(count);
+        if (textBytes) table->arena.reserve(textBytes);
+    } else if (count > table->capacity) {
+        resize(count);
+    }
+}
+
+void SubtitleEntryList::push_back(SubtitleEntry&& entry) {
+    if (mode == STORAGE_ARENA) {
+        push_back(SubtitleEntryView(entry));
+        return;
+    }
+    detach();
+    if (table->size == table->capacity) {
+        size_t new_capacity = table->capacity == 0 ? 4 : table->capacity * 2;
         resize(new_capacity);
     }
-    data[size++] = entry;
+    // Времена записи внутри SubtitleEntry не используются: актуальны только столбцы
+    table->start.push_back(entry.start_ms);
+    table->end.push_back(entry.end_ms);
+    table->data[table->size++] = std::make_shared<SubtitleEntry>(std::move(entry));
 }
 
-SubtitleEntry& SubtitleEntryList::operator[](size_t index) {
-    if (index >= size) throw std::out_of_range("Index out of range");
-    return data[index];
+void SubtitleEntryList::append(SubtitleEntryList&& other) {
+    if (&other == this || other.getSize() == 0) return;
+    if (getSize() == 0 && other.mode == mode) {
+        table = std::move(other.table);
+        return;
+    }
+    if (other.mode != mode) {
+        for (size_t i = 0; i < other.getSize(); ++i)
+            push_back(other.view(i));
+        other.clear();
+        return;
+    }
+
+    detach();
+    size_t count = other.getSize();
+    bool unique = !other.isShared(); // Чужую разделяемую таблицу только читаем
+    Table& source = *other.table;
+    table->start.insert(table->start.end(), source.start.begin(), source.start.end());
+    table->end.insert(table->end.end(), source.end.begin(), source.end.end());
+    if (mode == STORAGE_ARENA) {
+        TextArena copy;
+        TextArena& texts = unique ? source.arena : (copy = source.arena);
+        uint32_t slabOffset = table->arena.splice(std::move(texts));
+        size_t base = table->texts.size();
+        table->texts.reserve(base + count);
+        for (TextArena::Ref text : source.texts) {
+            text.slab += slabOffset;
+            table->texts.push_back(text);
+        }
+        for (RareFields rare : source.rare) {
+            rare.index += base;
+            rare.formatting.slab += slabOffset;
+            table->rare.push_back(rare);
+        }
+    } else {
+        if (table->size + count > table->capacity) resize(std::max(table->size + count, table->capacity * 2));
+        for (size_t i = 0; i < count; ++i)
+            table->data[table->size++] = unique ? std::move(source.data[i]) : source.data[i];
+    }
+    other.clear();
 }
 
-const SubtitleEntry& SubtitleEntryList::operator[](size_t index) const {
-    if (index >= size) throw std::out_of_range("Index out of range");
-    return data[index];
+SubtitleEntryList::EntryRef SubtitleEntryList::operator[](size_t index) {
+    if (mode == STORAGE_ARENA) throw std::logic_error("SubtitleEntryList: operator[] is not available in arena mode");
+    checkIndex(index);
+    SubtitleEntry& entry = mutableAt(index);
+    return EntryRef(entry, table->start[index], table->end[index]);
+}
+
+SubtitleEntryList::ConstEntryRef SubtitleEntryList::operator[](size_t index) const {
+    if (mode == STORAGE_ARENA) throw std::logic_error("SubtitleEntryList: operator[] is not available in arena mode");
+    checkIndex(index);
+    return ConstEntryRef(*table->data[index], table->start[index], table->end[index]);
 }
 
 size_t SubtitleEntryList::getSize() const {
-    return size;
+    return table ? table->start.size() : 0;
 }
 
+// Освобождение арены — это освобождение нескольких больших блоков,
+// а не каждой строки по отдельности
 void SubtitleEntryList::clear() {
-    delete[] data;
-    data = nullptr;
-    size = 0;
-    capacity = 0;
-}
\ No newline at end of file
+    table.reset();
+}
+
+SubtitleEntryView SubtitleEntryList::view(size_t index) const {
+    checkIndex(index);
+    SubtitleEntryView v;
+    if (mode != STORAGE_ARENA) {
+        v = SubtitleEntryView(*table->data[index]);
+        v.start_ms = table->start[index];
+        v.end_ms = table->end[index];
+        return v;
+    }
+
+    v.start_ms = table->start[index];
+    v.end_ms = table->end[index];
+    v.text = table->arena.get(table->texts[index]);
+    if (const RareFields* rare = findRare(index)) {
+        v.formatting = table->arena.get(rare->formatting);
+        v.x1 = rare->x1;
+        v.x2 = rare->x2;
+        v.y1 = rare->y1;
+        v.y2 = rare->y2;
+        v.has_coordinates = rare->has_coordinates;
+    }
+    return v;
+}
+
+std::string_view SubtitleEntryList::getText(size_t index) const {
+    checkIndex(index);
+    if (mode == STORAGE_ARENA) return table->arena.get(table->texts[index]);
+    return table->data[index]->text;
+}
+
+int64_t SubtitleEntryList::getStart(size_t index) const {
+    checkIndex(index);
+    return table->start[index];
+}
+
+int64_t SubtitleEntryList::getEnd(size_t index) const {
+    checkIndex(index);
+    return table->end[index];
+}
+
+const int64_t* SubtitleEntryList::startTimes() const {
+    return table ? table->start.data() : nullptr;
+}
+
+const int64_t* SubtitleEntryList::endTimes() const {
+    return table ? table->end.data() : nullptr;
+}
+
+void SubtitleEntryList::setStart(size_t index, int64_t start_ms) {
+    checkIndex(index);
+    detach();
+    table->start[index] = start_ms;
+}
+
+void SubtitleEntryList::setEnd(size_t index, int64_t end_ms) {
+    checkIndex(index);
+    detach();
+    table->end[index] = end_ms;
+}
+
+void SubtitleEntryList::setText(size_t index, std::string_view text) {
+    checkIndex(index);
+    if (mode == STORAGE_ARENA) {
+        detach();
+        table->texts[index] = table->arena.append(text);
+    } else {
+        mutableAt(index).text.assign(text.data(), text.size());
+    }
+}
+
+// В арене новый текст дописывается в конец текущего блока,
+// старый остаётся в блоке до clear()
+void SubtitleEntryList::wrapText(size_t index, std::string_view prefix, std::string_view suffix) {
+    checkIndex(index);
+    if (mode == STORAGE_ARENA) {
+        detach();
+        TextArena::Ref& text = table->texts[index];
+        text = table->arena.append(prefix, table->arena.get(text), suffix);
+    } else {
+        std::string& text = mutableAt(index).text;
+        text.reserve(prefix.size() + text.size() + suffix.size());
+        text.insert(0, prefix.data(), prefix.size());
+        text.append(suffix.data(), suffix.size());
+    }
+}
+
+void SubtitleEntryList::editText(size_t index, TextEditor editor) {
+    checkIndex(index);
+    if (mode == STORAGE_ARENA) {
+        detach();
+        TextArena::Ref& text = table->texts[index];
+        if (text.length != 0)
+            text.length = static_cast<uint32_t>(editor(table->arena.data(text), text.length));
+    } else {
+        std::string& text = mutableAt(index).text;
+        if (!text.empty())
+            text.resize(editor(&text[0], text.size()));
+    }
+}
+
+// Каждая запись правится целиком, пока её текст в кэше: сначала editor на
+// месте, затем обёртка с одним выделением памяти (в арене — одним добавлением)
+void SubtitleEntryList::editTexts(TextEditor editor, std::string_view prefix, std::string_view suffix) {
+    if (getSize() == 0) return;
+    detach();
+    bool wrap = !prefix.empty() || !suffix.empty();
+    if (mode == STORAGE_ARENA) {
+        TextArena& arena = table->arena;
+        for (TextArena::Ref& text : table->texts) {
+            if (editor && text.length != 0)
+                text.length = static_cast<uint32_t>(editor(arena.data(text), text.length));
+            if (wrap) text = arena.append(prefix, arena.get(text), suffix);
+        }
+    } else {
+        for (size_t i = 0; i < table->size; ++i) {
+            std::string& text = mutableAt(i).text;
+            if (editor && !text.empty())
+                text.resize(editor(&text[0], text.size()));
+            if (wrap) {
+                text.reserve(prefix.size() + text.size() + suffix.size());
+                text.insert(0, prefix.data(), prefix.size());
+                text.append(suffix.data(), suffix.size());
+            }
+        }
+    }
+}
+
+void SubtitleEntryList::shiftTimes(int64_t delta_ms, bool shiftStart, bool shiftEnd, bool skipNotes) {
+    if (getSize() == 0) return;
+    detach();
+    TimeShifter::shift(table->start.data(), table->end.data(), getSize(), delta_ms, shiftStart, shiftEnd, skipNotes);
+}
+
+void SubtitleEntryList::clampTimes(int64_t min_ms, int64_t max_ms, bool skipNotes) {
+    if (getSize() == 0) return;
+    detach();
+    TimeShifter::clamp(table->start.data(), table->end.data(), getSize(), min_ms, max_ms, skipNotes);
+}
+
+void SubtitleEntryList::remapTimes(const TimeRemap& remap, bool skipNotes) {
+    if (getSize() == 0 || remap.isIdentity()) return;
+    detach();
+    TimeShifter::remap(table->start.data(), table->end.data(), getSize(), remap, skipNotes);
+}
+
+bool SubtitleEntryList::isShared() const {
+    return table.use_count() > 1;
+}
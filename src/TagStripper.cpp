@@ -0,0 +1,209 @@
+#include "TagStripper.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TAG_STRIPPER_X86 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TAG_STRIPPER_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+
+// Ищет первый из двух символов a/b в [p, end), возвращает end, если не найден
+using FindFn = const char* (*)(const char* p, const char* end, char a, char b);
+
+const char* findScalar(const char* p, const char* end, char a, char b) {
+    for (; p < end; ++p) {
+        if (*p == a || *p == b) return p;
+    }
+    return end;
+}
+
+#ifdef TAG_STRIPPER_X86
+int firstBit(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#endif
+}
+
+const char* findSSE2(const char* p, const char* end, char a, char b) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask) return p + firstBit(mask);
+    }
+    return findScalar(p, end, a, b);
+}
+#endif
+
+#ifdef TAG_STRIPPER_AVX2
+__attribute__((target("avx2")))
+const char* findAVX2(const char* p, const char* end, char a, char b) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    for (; end - p >= 32; p += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask) return p + firstBit(mask);
+    }
+    return findSSE2(p, end, a, b);
+}
+#endif
+
+TagStripper::Kernel detectKernel() {
+#ifdef TAG_STRIPPER_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return TagStripper::KERNEL_AVX2;
+#endif
+#ifdef TAG_STRIPPER_X86
+    return TagStripper::KERNEL_SSE2;
+#else
+    return TagStripper::KERNEL_SCALAR;
+#endif
+}
+
+FindFn kernelFunction(TagStripper::Kernel kernel) {
+    switch (kernel) {
+#ifdef TAG_STRIPPER_AVX2
+        case TagStripper::KERNEL_AVX2: return findAVX2;
+#endif
+#ifdef TAG_STRIPPER_X86
+        case TagStripper::KERNEL_SSE2: return findSSE2;
+#endif
+        default: return findScalar;
+    }
+}
+
+TagStripper::Kernel activeKernel = detectKernel();
+FindFn findAny = kernelFunction(activeKernel);
+
+} // namespace
+
+void TagStripper::removeHtmlTags(std::string& text) {
+    text.resize(removeHtmlTags(&text[0], text.size()));
+}
+
+size_t TagStripper::removeHtmlTags(char* text, size_t length) {
+    char* begin = text;
+    const char* src = begin;
+    const char* end = begin + length;
+    char* dst = begin;
+
+    while (src < end) {
+        const char* open = findAny(src, end, '<', '<');
+        if (open == end) break;
+
+        const char* close = static_cast<const char*>(std::memchr(open + 1, '>', end - open - 1));
+        if (!close) break; // Незакрытый '<' остаётся в тексте, как и при regex
+
+        std::memmove(dst, src, open - src);
+        dst += open - src;
+        src = close + 1;
+    }
+
+    std::memmove(dst, src, end - src);
+    dst += end - src;
+    return dst - begin;
+}
+
+void TagStripper::removeAssTags(std::string& text) {
+    text.resize(removeAssTags(&text[0], text.size()));
+}
+
+size_t TagStripper::removeAssTags(char* text, size_t length) {
+    char* begin = text;
+    const char* src = begin;
+    const char* end = begin + length;
+    char* dst = begin;
+    bool hasClosingBrace = true; // Сбрасывается, когда после '{' больше нет '}'
+
+    while (src < end) {
+        const char* special = findAny(src, end, '\\', hasClosingBrace ? '{' : '\\');
+        std::memmove(dst, src, special - src);
+        dst += special - src;
+        if (special == end) {
+            src = end;
+            break;
+        }
+
+        if (*special == '\\') {
+            // "\N" удаляется целиком, одиночный '\' удаляется последней заменой
+            src = special + ((special + 1 < end && special[1] == 'N') ? 2 : 1);
+            continue;
+        }
+
+        const char* close = static_cast<const char*>(std::memchr(special + 1, '}', end - special - 1));
+        if (!close) {
+            hasClosingBrace = false;
+            *dst++ = '{';
+            src = special + 1;
+            continue;
+        }
+        src = close + 1;
+    }
+
+    return dst - begin;
+}
+
+bool TagStripper::setKernel(Kernel kernel) {
+    if (kernel == KERNEL_AUTO) kernel = detectKernel();
+    if (!isSupported(kernel)) return false;
+    activeKernel = kernel;
+    findAny = kernelFunction(kernel);
+    return true;
+}
+
+TagStripper::Kernel TagStripper::getKernel() {
+    return activeKernel;
+}
+
+bool TagStripper::isSupported(Kernel kernel) {
+    switch (kernel) {
+        case KERNEL_AUTO:
+        case KERNEL_SCALAR:
+            return true;
+        case KERNEL_SSE2:
+#ifdef TAG_STRIPPER_X86
+            return true;
+#else
+            return false;
+#endif
+        case KERNEL_AVX2:
+#ifdef TAG_STRIPPER_AVX2
+            return detectKernel() == KERNEL_AVX2;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+bool TagStripper::parseKernel(const std::string& name, Kernel& kernel) {
+    if (name == "auto") kernel = KERNEL_AUTO;
+    else if (name == "scalar") kernel = KERNEL_SCALAR;
+    else if (name == "sse2") kernel = KERNEL_SSE2;
+    else if (name == "avx2") kernel = KERNEL_AVX2;
+    else return false;
+    return true;
+}
+
+const char* TagStripper::kernelName(Kernel kernel) {
+    switch (kernel) {
+        case KERNEL_AUTO: return "auto";
+        case KERNEL_SCALAR: return "scalar";
+        case KERNEL_SSE2: return "sse2";
+        case KERNEL_AVX2: return "avx2";
+    }
+    return "unknown";
+}
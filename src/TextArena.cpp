@@ -0,0 +1,139 @@
+#include "TextArena.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// Смещение внутри блока хранится в Ref 32-битным, поэтому блок не больше 4 ГиБ
+const size_t MAX_SLAB_SIZE = std::numeric_limits<uint32_t>::max();
+
+char* copyTo(char* p, std::string_view str) {
+    if (!str.empty()) std::memcpy(p, str.data(), str.size());
+    return p + str.size();
+}
+
+} // namespace
+
+TextArena::TextArena(size_t slabSize) : slabSize(slabSize ? slabSize : DEFAULT_SLAB_SIZE), usedBytes(0) {}
+
+TextArena::TextArena(const TextArena& other) : slabSize(other.slabSize), usedBytes(other.usedBytes) {
+    slabs.reserve(other.slabs.size());
+    for (const Slab& slab : other.slabs) {
+        // Ссылки на строки остаются прежними, поэтому блок копируется с тем же номером
+        Slab copy;
+        copy.data.reset(new char[slab.used ? slab.used : 1]);
+        copy.size = slab.used;
+        copy.used = slab.used;
+        std::memcpy(copy.data.get(), slab.data.get(), slab.used);
+        slabs.push_back(std::move(copy));
+    }
+}
+
+TextArena::TextArena(TextArena&& other) noexcept
+    : slabs(std::move(other.slabs)), slabSize(other.slabSize), usedBytes(other.usedBytes) {
+    other.slabs.clear();
+    other.usedBytes = 0;
+}
+
+TextArena& TextArena::operator=(const TextArena& other) {
+    if (this != &other)
+        *this = TextArena(other);
+    return *this;
+}
+
+TextArena& TextArena::operator=(TextArena&& other) noexcept {
+    if (this != &other) {
+        slabs = std::move(other.slabs);
+        slabSize = other.slabSize;
+        usedBytes = other.usedBytes;
+        other.slabs.clear();
+        other.usedBytes = 0;
+    }
+    return *this;
+}
+
+char* TextArena::allocate(size_t length, Ref& ref) {
+    if (length > std::numeric_limits<uint32_t>::max())
+        throw std::length_error("TextArena: string is too long");
+
+    // Строка длиннее блока получает собственный блок
+    reserve(length);
+
+    Slab& slab = slabs.back();
+    assert(slab.used + length <= MAX_SLAB_SIZE);
+    ref.slab = static_cast<uint32_t>(slabs.size() - 1);
+    ref.offset = static_cast<uint32_t>(slab.used);
+    ref.length = static_cast<uint32_t>(length);
+    slab.used += length;
+    usedBytes += length;
+    return slab.data.get() + ref.offset;
+}
+
+void TextArena::reserve(size_t bytes) {
+    // Больше одного блока не зарезервировать: остальное займут следующие блоки
+    bytes = std::min(bytes, MAX_SLAB_SIZE);
+    if (!slabs.empty() && slabs.back().size - slabs.back().used >= bytes) return;
+    Slab slab;
+    slab.size = std::min(std::max(slabSize, bytes), MAX_SLAB_SIZE);
+    slab.used = 0;
+    slab.data.reset(new char[slab.size]);
+    slabs.push_back(std::move(slab));
+}
+
+uint32_t TextArena::splice(TextArena&& other) {
+    uint32_t offset = static_cast<uint32_t>(slabs.size());
+    if (&other == this) return 0;
+    for (Slab& slab : other.slabs) slabs.push_back(std::move(slab));
+    usedBytes += other.usedBytes;
+    other.slabs.clear();
+    other.usedBytes = 0;
+    return offset;
+}
+
+TextArena::Ref TextArena::append(std::string_view str) {
+    Ref ref;
+    if (str.empty()) return ref;
+    std::memcpy(allocate(str.size(), ref), str.data(), str.size());
+    return ref;
+}
+
+TextArena::Ref TextArena::append(std::string_view prefix, std::string_view str, std::string_view suffix) {
+    Ref ref;
+    size_t length = prefix.size() + str.size() + suffix.size();
+    if (length == 0) return ref;
+
+    // str может указывать в эту же арену: новый блок старые не сдвигает,
+    // а в текущем блоке запись идёт после уже занятой части
+    char* p = allocate(length, ref);
+    p = copyTo(p, prefix);
+    p = copyTo(p, str);
+    copyTo(p, suffix);
+    return ref;
+}
+
+std::string_view TextArena::get(Ref ref) const {
+    if (ref.length == 0) return std::string_view();
+    return std::string_view(slabs[ref.slab].data.get() + ref.offset, ref.length);
+}
+
+char* TextArena::data(Ref ref) {
+    if (ref.length == 0) return nullptr;
+    return slabs[ref.slab].data.get() + ref.offset;
+}
+
+void TextArena::clear() {
+    slabs.clear();
+    usedBytes = 0;
+}
+
+size_t TextArena::getUsedBytes() const {
+    return usedBytes;
+}
+
+size_t TextArena::getSlabCount() const {
+    return slabs.size();
+}
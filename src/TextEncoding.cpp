@@ -0,0 +1,686 @@
+#include "TextEncoding.h"
+#include "BufferedWriter.h"
+#include "MappedFile.h"
+#include "Trace.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TEXT_ENCODING_X86 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TEXT_ENCODING_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+
+// Windows-1251 и Windows-1252: коды символов для байтов 0x80-0xFF.
+// Неопределённые позиции отображаются в управляющие символы C1 с тем же
+// номером, как это делают MultiByteToWideChar и WHATWG Encoding
+const uint16_t CP1251[128] = {
+    0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+    0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x0098, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+    0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7,
+    0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+    0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7,
+    0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+    0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+    0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+};
+
+const uint16_t CP1252[128] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+    0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+    0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+    0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+    0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+    0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+    0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+    0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+    0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+    0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+    0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+    0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+    0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF,
+};
+
+const uint32_t REPLACEMENT = 0xFFFD;
+
+// Обратная таблица кодовой страницы, упорядоченная по коду символа
+struct ReverseEntry {
+    uint16_t code;
+    unsigned char byte;
+};
+using ReverseTable = std::array<ReverseEntry, 128>;
+
+ReverseTable buildReverse(const uint16_t* table) {
+    ReverseTable reverse;
+    for (size_t i = 0; i < 128; ++i) reverse[i] = {table[i], static_cast<unsigned char>(0x80 + i)};
+    std::sort(reverse.begin(), reverse.end(),
+              [](const ReverseEntry& a, const ReverseEntry& b) { return a.code < b.code; });
+    return reverse;
+}
+
+const uint16_t* codePage(TextEncoding::Encoding encoding) {
+    return encoding == TextEncoding::ENCODING_CP1251 ? CP1251 : CP1252;
+}
+
+const ReverseTable& reverseCodePage(TextEncoding::Encoding encoding) {
+    static const ReverseTable reverse1251 = buildReverse(CP1251);
+    static const ReverseTable reverse1252 = buildReverse(CP1252);
+    return encoding == TextEncoding::ENCODING_CP1251 ? reverse1251 : reverse1252;
+}
+
+char* encodeUtf8(uint32_t code, char* out) {
+    if (code < 0x80) {
+        *out++ = static_cast<char>(code);
+    } else if (code < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (code >> 6));
+        *out++ = static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        *out++ = static_cast<char>(0xE0 | (code >> 12));
+        *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        *out++ = static_cast<char>(0xF0 | (code >> 18));
+        *out++ = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code & 0x3F));
+    }
+    return out;
+}
+
+// Разбирает последовательность UTF-8 в начале [p, end), возвращает её длину
+// или 0, если она неверна
+size_t decodeUtf8(const unsigned char* p, const unsigned char* end, uint32_t& code) {
+    unsigned char lead = *p;
+    size_t tail;
+    if (lead < 0x80) {
+        code = lead;
+        return 1;
+    } else if (lead >= 0xC2 && lead <= 0xDF) {
+        tail = 1;
+        code = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        tail = 2;
+        code = lead & 0x0F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        tail = 3;
+        code = lead & 0x07;
+    } else {
+        return 0;
+    }
+    if (static_cast<size_t>(end - p) <= tail) return 0;
+    for (size_t i = 1; i <= tail; ++i) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+        code = (code << 6) | (p[i] & 0x3F);
+    }
+    if (tail == 2 && (code < 0x800 || (code >= 0xD800 && code <= 0xDFFF))) return 0;
+    if (tail == 3 && (code < 0x10000 || code > 0x10FFFF)) return 0;
+    return tail + 1;
+}
+
+// Длина начального отрезка ASCII
+using AsciiFn = size_t (*)(const char* p, size_t size);
+using ValidateFn = bool (*)(const char* p, size_t size);
+
+size_t asciiScalar(const char* p, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, sizeof(word));
+        if (word & 0x8080808080808080ULL) break;
+    }
+    while (i < size && static_cast<unsigned char>(p[i]) < 0x80) ++i;
+    return i;
+}
+
+// ASCII пропускается векторно, многобайтовые последовательности проверяются по одной
+template <AsciiFn Ascii>
+bool validateRuns(const char* data, size_t size) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    while (p < end) {
+        p += Ascii(reinterpret_cast<const char*>(p), end - p);
+        while (p < end && *p >= 0x80) {
+            uint32_t code;
+            size_t length = decodeUtf8(p, end, code);
+            if (!length) return false;
+            p += length;
+        }
+    }
+    return true;
+}
+
+#ifdef TEXT_ENCODING_X86
+int firstBit(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#endif
+}
+
+size_t asciiSSE2(const char* p, size_t size) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i))));
+        if (mask) return i + firstBit(mask);
+    }
+    return i + asciiScalar(p + i, size - i);
+}
+
+// 8 символов UTF-16 за итерацию, пока все они ASCII; возвращает число скопированных символов
+template <bool BigEndian>
+size_t asciiUnitsSSE2(const unsigned char* p, size_t units, char* out) {
+    const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= units; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2 * i));
+        if (BigEndian) v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, nonAscii), zero)) != 0xFFFF) break;
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(v, v));
+    }
+    return i;
+}
+#endif
+
+#ifdef TEXT_ENCODING_AVX2
+__attribute__((target("avx2")))
+size_t asciiAVX2(const char* p, size_t size) {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i))));
+        if (mask) return i + firstBit(mask);
+    }
+    return i + asciiSSE2(p + i, size - i);
+}
+
+// Проверка UTF-8 по таблицам (Keiser, Lemire, "Validating UTF-8 in less than
+// one instruction per byte", 2021). Ошибки в паре соседних байтов находятся
+// пересечением трёх таблиц по полубайтам: старшему и младшему первого байта
+// и старшему второго. Третий и четвёртый байты длинных последовательностей
+// проверяются отдельно, по байтам, стоящим на две и три позиции раньше.
+enum : uint8_t {
+    TOO_SHORT = 1 << 0,      // 11______ 0_______, 11______ 11______
+    TOO_LONG = 1 << 1,       // 0_______ 10______
+    OVERLONG_3 = 1 << 2,     // 11100000 100_____
+    TOO_LARGE = 1 << 3,      // 11110100 1001____, 11110100 101_____, 11110101..11111111
+    SURROGATE = 1 << 4,      // 11101101 101_____
+    OVERLONG_2 = 1 << 5,     // 1100000_ 10______
+    TOO_LARGE_1000 = 1 << 6, // 11110101..11111111 1000____
+    OVERLONG_4 = 1 << 6,     // 11110000 1000____
+    TWO_CONTS = 1 << 7,      // 10______ 10______
+    CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS
+};
+
+__attribute__((target("avx2")))
+inline __m256i table16(uint8_t t0, uint8_t t1, uint8_t t2, uint8_t t3, uint8_t t4, uint8_t t5, uint8_t t6, uint8_t t7,
+                       uint8_t t8, uint8_t t9, uint8_t t10, uint8_t t11, uint8_t t12, uint8_t t13, uint8_t t14,
+                       uint8_t t15) {
+    return _mm256_setr_epi8(t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15,
+                            t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15);
+}
+
+// Байты input, сдвинутые на N позиций к концу; освободившиеся места занимает хвост prev
+template <int N>
+__attribute__((target("avx2")))
+inline __m256i previous(__m256i input, __m256i prev) {
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+}
+
+__attribute__((target("avx2")))
+inline __m256i highNibbles(__m256i v) {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+__attribute__((target("avx2")))
+bool validateAVX2(const char* data, size_t size) {
+    const __m256i byte1High = table16(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const __m256i byte1Low = table16(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000);
+    const __m256i byte2High = table16(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+    // Последовательность, начатая в последних трёх байтах блока, продолжается в следующем
+    const __m256i incompleteMax = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+    const __m256i thirdByte = _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80));
+    const __m256i fourthByte = _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80));
+    const __m256i highBit = _mm256_set1_epi8(static_cast<char>(0x80));
+    const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+
+    __m256i error = _mm256_setzero_si256();
+    __m256i prevInput = _mm256_setzero_si256();
+    __m256i prevIncomplete = _mm256_setzero_si256();
+    alignas(32) char tail[32];
+
+    for (size_t i = 0; i < size; i += 32) {
+        __m256i input;
+        if (size - i >= 32) {
+            input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        } else {
+            // Хвост дополняется нулями: обрыв последовательности в конце станет ошибкой TOO_SHORT
+            std::memset(tail, 0, sizeof(tail));
+            std::memcpy(tail, data + i, size - i);
+            input = _mm256_load_si256(reinterpret_cast<const __m256i*>(tail));
+        }
+
+        if (_mm256_movemask_epi8(input) == 0) {
+            error = _mm256_or_si256(error, prevIncomplete);
+        } else {
+            __m256i prev1 = previous<1>(input, prevInput);
+            __m256i special = _mm256_and_si256(
+                _mm256_and_si256(_mm256_shuffle_epi8(byte1High, highNibbles(prev1)),
+                                 _mm256_shuffle_epi8(byte1Low, _mm256_and_si256(prev1, lowNibble))),
+                _mm256_shuffle_epi8(byte2High, highNibbles(input)));
+            __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(previous<2>(input, prevInput), thirdByte),
+                                             _mm256_subs_epu8(previous<3>(input, prevInput), fourthByte));
+            error = _mm256_or_si256(error, _mm256_xor_si256(_mm256_and_si256(must23, highBit), special));
+            prevIncomplete = _mm256_subs_epu8(input, incompleteMax);
+        }
+        prevInput = input;
+        if (!_mm256_testz_si256(error, error)) return false;
+    }
+    error = _mm256_or_si256(error, prevIncomplete);
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+TextEncoding::Kernel detectKernel() {
+#ifdef TEXT_ENCODING_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return TagStripper::KERNEL_AVX2;
+#endif
+#ifdef TEXT_ENCODING_X86
+    return TagStripper::KERNEL_SSE2;
+#else
+    return TagStripper::KERNEL_SCALAR;
+#endif
+}
+
+AsciiFn asciiFunction(TextEncoding::Kernel kernel) {
+    switch (kernel) {
+#ifdef TEXT_ENCODING_AVX2
+        case TagStripper::KERNEL_AVX2: return asciiAVX2;
+#endif
+#ifdef TEXT_ENCODING_X86
+        case TagStripper::KERNEL_SSE2: return asciiSSE2;
+#endif
+        default: return asciiScalar;
+    }
+}
+
+ValidateFn validateFunction(TextEncoding::Kernel kernel) {
+    switch (kernel) {
+#ifdef TEXT_ENCODING_AVX2
+        case TagStripper::KERNEL_AVX2: return validateAVX2;
+#endif
+#ifdef TEXT_ENCODING_X86
+        case TagStripper::KERNEL_SSE2: return validateRuns<asciiSSE2>;
+#endif
+        default: return validateRuns<asciiScalar>;
+    }
+}
+
+TextEncoding::Kernel activeKernel = detectKernel();
+AsciiFn asciiLength = asciiFunction(activeKernel);
+ValidateFn validate = validateFunction(activeKernel);
+TextEncoding::Encoding inputEncoding = TextEncoding::ENCODING_AUTO;
+
+// Для определения кодировки без BOM достаточно начала файла
+const size_t SAMPLE_SIZE = 64 << 10;
+
+template <bool BigEndian>
+uint32_t unitAt(const unsigned char* p) {
+    return BigEndian ? (uint32_t(p[0]) << 8) | p[1] : (uint32_t(p[1]) << 8) | p[0];
+}
+
+template <bool BigEndian>
+std::string utf16ToUtf8(const unsigned char* p, size_t size) {
+    size_t units = size / 2;
+    // Символ UTF-16 занимает в UTF-8 не больше трёх байтов, суррогатная пара — четыре
+    std::string result(units * 3 + 3, '\0');
+    char* out = &result[0];
+    size_t i = 0;
+    while (i < units) {
+#ifdef TEXT_ENCODING_X86
+        if (activeKernel != TagStripper::KERNEL_SCALAR) {
+            size_t n = asciiUnitsSSE2<BigEndian>(p + 2 * i, units - i, out);
+            i += n;
+            out += n;
+            if (i == units) break;
+        }
+#endif
+        uint32_t code = unitAt<BigEndian>(p + 2 * i++);
+        if (code >= 0xD800 && code <= 0xDBFF && i < units) {
+            uint32_t low = unitAt<BigEndian>(p + 2 * i);
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            } else {
+                code = REPLACEMENT;
+            }
+        } else if (code >= 0xD800 && code <= 0xDFFF) {
+            code = REPLACEMENT;
+        }
+        out = encodeUtf8(code, out);
+    }
+    if (size % 2) out = encodeUtf8(REPLACEMENT, out); // Оборванный последний символ
+    result.resize(out - result.data());
+    return result;
+}
+
+std::string codePageToUtf8(const char* data, size_t size, const uint16_t* table) {
+    std::string result(size * 3, '\0');
+    char* out = &result[0];
+    size_t i = 0;
+    while (i < size) {
+        size_t n = asciiLength(data + i, size - i);
+        std::memcpy(out, data + i, n);
+        out += n;
+        i += n;
+        for (; i < size && static_cast<unsigned char>(data[i]) >= 0x80; ++i) {
+            out = encodeUtf8(table[static_cast<unsigned char>(data[i]) - 0x80], out);
+        }
+    }
+    result.resize(out - result.data());
+    return result;
+}
+
+char* putUnit(uint32_t unit, bool bigEndian, char* out) {
+    out[bigEndian ? 0 : 1] = static_cast<char>(unit >> 8);
+    out[bigEndian ? 1 : 0] = static_cast<char>(unit & 0xFF);
+    return out + 2;
+}
+
+std::string utf8ToUtf16(std::string_view utf8, bool bigEndian) {
+    // BOM и не больше двух байтов на каждый байт UTF-8
+    std::string result(utf8.size() * 2 + 2, '\0');
+    char* out = putUnit(0xFEFF, bigEndian, &result[0]);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(utf8.data());
+    const unsigned char* end = p + utf8.size();
+    while (p < end) {
+        uint32_t code;
+        size_t length = decodeUtf8(p, end, code);
+        if (!length) {
+            code = REPLACEMENT;
+            length = 1;
+        }
+        p += length;
+        if (code >= 0x10000) {
+            code -= 0x10000;
+            out = putUnit(0xD800 + (code >> 10), bigEndian, out);
+            out = putUnit(0xDC00 + (code & 0x3FF), bigEndian, out);
+        } else {
+            out = putUnit(code, bigEndian, out);
+        }
+    }
+    result.resize(out - result.data());
+    return result;
+}
+
+std::string utf8ToCodePage(std::string_view utf8, TextEncoding::Encoding encoding) {
+    const ReverseTable& reverse = reverseCodePage(encoding);
+    std::string result(utf8.size(), '\0');
+    char* out = &result[0];
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(utf8.data());
+    const unsigned char* end = p + utf8.size();
+    while (p < end) {
+        size_t n = asciiLength(reinterpret_cast<const char*>(p), end - p);
+        std::memcpy(out, p, n);
+        out += n;
+        p += n;
+        while (p < end && *p >= 0x80) {
+            uint32_t code;
+            size_t length = decodeUtf8(p, end, code);
+            if (!length) {
+                // Неверная последовательность: code не заполнен
+                *out++ = '?';
+                ++p;
+                continue;
+            }
+            p += length;
+            auto it = std::lower_bound(reverse.begin(), reverse.end(), code,
+                                       [](const ReverseEntry& entry, uint32_t c) { return entry.code < c; });
+            *out++ = it != reverse.end() && it->code == code ? static_cast<char>(it->byte) : '?';
+        }
+    }
+    result.resize(out - result.data());
+    return result;
+}
+
+// UTF-16 без BOM: у текста, где много ASCII, каждый второй байт нулевой
+TextEncoding::Encoding detectUtf16(const unsigned char* p, size_t size) {
+    size_t evenZeros = 0, oddZeros = 0;
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        evenZeros += p[i] == 0;
+        oddZeros += p[i + 1] == 0;
+    }
+    size_t units = size / 2;
+    if (units >= 2 && oddZeros * 4 > units && evenZeros * 16 < units) return TextEncoding::ENCODING_UTF16LE;
+    if (units >= 2 && evenZeros * 4 > units && oddZeros * 16 < units) return TextEncoding::ENCODING_UTF16BE;
+    return TextEncoding::ENCODING_UNKNOWN;
+}
+
+// UTF-8 с отдельными повреждёнными байтами: верных многобайтовых
+// последовательностей не меньше, чем байтов, которые не удалось разобрать.
+// В тексте Windows-1251/1252 старшие байты почти никогда не складываются
+// в верную последовательность UTF-8
+bool mostlyUtf8(const unsigned char* p, size_t size) {
+    const unsigned char* end = p + size;
+    size_t valid = 0, invalid = 0;
+    while (p < end) {
+        p += asciiLength(reinterpret_cast<const char*>(p), end - p);
+        while (p < end && *p >= 0x80) {
+            uint32_t code;
+            size_t length = decodeUtf8(p, end, code);
+            if (length) ++valid;
+            else ++invalid;
+            p += length ? length : 1;
+        }
+    }
+    return valid >= invalid;
+}
+
+// Однобайтовая кодовая страница по началу файла, который не является UTF-8.
+// Байты 0x80-0xFF делятся на «слова» между байтами ASCII: в двухбайтовых
+// кодировках (CP949, Shift_JIS, GBK) их длина почти всегда чётная, такой
+// текст не перекодируется. Русские слова в Windows-1251 целиком состоят из
+// старших байтов, а в западноевропейском тексте Windows-1252 это отдельные
+// буквы с диакритикой среди ASCII.
+TextEncoding::Encoding detectCodePage(const unsigned char* p, size_t size) {
+    size_t runs = 0, evenRuns = 0, high = 0, longRuns = 0;
+    size_t i = 0;
+    while (i < size) {
+        if (p[i] < 0x80) {
+            ++i;
+            continue;
+        }
+        size_t begin = i;
+        while (i < size && p[i] >= 0x80) ++i;
+        size_t length = i - begin;
+        ++runs;
+        evenRuns += length % 2 == 0;
+        longRuns += length >= 3;
+        high += length;
+    }
+    if (runs >= 8 && evenRuns * 10 >= runs * 9) return TextEncoding::ENCODING_UNKNOWN;
+    return longRuns * 2 >= runs ? TextEncoding::ENCODING_CP1251 : TextEncoding::ENCODING_CP1252;
+}
+
+} // namespace
+
+bool TextEncoding::isValidUtf8(std::string_view data) {
+    return validate(data.data(), data.size());
+}
+
+TextEncoding::Encoding TextEncoding::detect(std::string_view data, size_t& bomLength) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+    bomLength = 0;
+    if (data.size() >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
+        bomLength = 3;
+        return ENCODING_UTF8;
+    }
+    if (data.size() >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+        bomLength = 2;
+        return ENCODING_UTF16LE;
+    }
+    if (data.size() >= 2 && p[0] == 0xFE && p[1] == 0xFF) {
+        bomLength = 2;
+        return ENCODING_UTF16BE;
+    }
+
+    size_t sample = std::min(data.size(), SAMPLE_SIZE);
+    Encoding utf16 = detectUtf16(p, sample);
+    if (utf16 != ENCODING_UNKNOWN) return utf16;
+    if (isValidUtf8(data) || mostlyUtf8(p, data.size())) return ENCODING_UTF8;
+    return detectCodePage(p, sample);
+}
+
+std::string TextEncoding::toUtf8(std::string_view data, Encoding from) {
+    TRACE_SCOPE("TextEncoding::toUtf8");
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+    switch (from) {
+        case ENCODING_UTF16LE:
+            if (data.size() >= 2 && p[0] == 0xFF && p[1] == 0xFE) p += 2;
+            return utf16ToUtf8<false>(p, data.size() - (p - reinterpret_cast<const unsigned char*>(data.data())));
+        case ENCODING_UTF16BE:
+            if (data.size() >= 2 && p[0] == 0xFE && p[1] == 0xFF) p += 2;
+            return utf16ToUtf8<true>(p, data.size() - (p - reinterpret_cast<const unsigned char*>(data.data())));
+        case ENCODING_CP1251:
+        case ENCODING_CP1252:
+            return codePageToUtf8(data.data(), data.size(), codePage(from));
+        case ENCODING_UTF8:
+            if (data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0) data.remove_prefix(3);
+            return std::string(data);
+        default:
+            return std::string(data);
+    }
+}
+
+std::string TextEncoding::fromUtf8(std::string_view utf8, Encoding to) {
+    TRACE_SCOPE("TextEncoding::fromUtf8");
+    switch (to) {
+        case ENCODING_UTF16LE: return utf8ToUtf16(utf8, false);
+        case ENCODING_UTF16BE: return utf8ToUtf16(utf8, true);
+        case ENCODING_CP1251:
+        case ENCODING_CP1252: return utf8ToCodePage(utf8, to);
+        default: return std::string(utf8);
+    }
+}
+
+bool TextEncoding::normalize(std::string_view data, std::string& utf8) {
+    TRACE_SCOPE("TextEncoding::normalize");
+    Encoding encoding = inputEncoding;
+    if (encoding == ENCODING_AUTO) {
+        size_t bomLength;
+        encoding = detect(data, bomLength);
+    }
+    // BOM UTF-8 читатели пропускают сами
+    if (encoding == ENCODING_UTF8 || encoding == ENCODING_UNKNOWN) return false;
+    utf8 = toUtf8(data, encoding);
+    return true;
+}
+
+void TextEncoding::convertFile(const std::string& filename, Encoding to) {
+    if (to == ENCODING_AUTO || to == ENCODING_UTF8 || to == ENCODING_UNKNOWN) return;
+    TRACE_SCOPE("TextEncoding::convertFile");
+    std::string encoded;
+    {
+        // Отображение нужно закрыть до того, как файл будет перезаписан
+        MappedFile file(filename);
+        encoded = fromUtf8(file.view(), to);
+    }
+    BufferedWriter out(filename);
+    out.write(encoded);
+    out.close();
+}
+
+void TextEncoding::setInputEncoding(Encoding encoding) {
+    inputEncoding = encoding;
+}
+
+TextEncoding::Encoding TextEncoding::getInputEncoding() {
+    return inputEncoding;
+}
+
+bool TextEncoding::parseEncoding(const std::string& name, Encoding& encoding) {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (lower == "auto") encoding = ENCODING_AUTO;
+    else if (lower == "utf-8" || lower == "utf8") encoding = ENCODING_UTF8;
+    else if (lower == "utf-16le" || lower == "utf16le" || lower == "utf-16") encoding = ENCODING_UTF16LE;
+    else if (lower == "utf-16be" || lower == "utf16be") encoding = ENCODING_UTF16BE;
+    else if (lower == "cp1251" || lower == "windows-1251") encoding = ENCODING_CP1251;
+    else if (lower == "cp1252" || lower == "windows-1252") encoding = ENCODING_CP1252;
+    else return false;
+    return true;
+}
+
+const char* TextEncoding::encodingName(Encoding encoding) {
+    switch (encoding) {
+        case ENCODING_AUTO: return "auto";
+        case ENCODING_UTF8: return "utf-8";
+        case ENCODING_UTF16LE: return "utf-16le";
+        case ENCODING_UTF16BE: return "utf-16be";
+        case ENCODING_CP1251: return "cp1251";
+        case ENCODING_CP1252: return "cp1252";
+        default: return "unknown";
+    }
+}
+
+bool TextEncoding::setKernel(Kernel kernel) {
+    if (kernel == TagStripper::KERNEL_AUTO) kernel = detectKernel();
+    if (!TagStripper::isSupported(kernel)) return false;
+    activeKernel = kernel;
+    asciiLength = asciiFunction(kernel);
+    validate = validateFunction(kernel);
+    return true;
+}
+
+TextEncoding::Kernel TextEncoding::getKernel() {
+    return activeKernel;
+}
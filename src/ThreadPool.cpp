@@ -0,0 +1,121 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <utility>
+
+namespace {
+
+// Пул и номер потока, в котором выполняется текущая задача
+thread_local ThreadPool* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads)
+    : queued(0), pending(0), stopping(false), nextWorker(0) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (size_t i = 0; i < threads; ++i)
+        workers.push_back(std::make_unique<Worker>());
+    for (size_t i = 0; i < threads; ++i)
+        this->threads.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+void ThreadPool::submit(Task task) {
+    size_t index = currentPool == this ? currentIndex : nextWorker++ % workers.size();
+
+    // Счётчики увеличиваются до вставки, чтобы взявший задачу поток
+    // никогда не уменьшил их раньше времени
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++queued;
+        ++pending;
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    wakeUp.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    idle.wait(lock, [this] { return pending == 0; });
+    if (firstError) {
+        std::exception_ptr error = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+size_t ThreadPool::getSize() const {
+    return workers.size();
+}
+
+bool ThreadPool::popLocal(size_t index, Task& task) {
+    Worker& worker = *workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) return false;
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, Task& task) {
+    for (size_t i = 1; i < workers.size(); ++i) {
+        Worker& victim = *workers[(thief + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) continue;
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::execute(Task& task) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        --queued;
+    }
+
+    std::exception_ptr error;
+    try {
+        task();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    task = nullptr;
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (error && !firstError) firstError = error;
+    if (--pending == 0) idle.notify_all();
+}
+
+void ThreadPool::run(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+    TRACE_THREAD_NAME("worker " + std::to_string(index));
+
+    Task task;
+    for (;;) {
+        if (popLocal(index, task) || steal(index, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        wakeUp.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
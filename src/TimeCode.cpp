@@ -0,0 +1,186 @@
+#include "TimeCode.h"
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+inline char* put2(char* out, int value) {
+    std::memcpy(out, DIGIT_PAIRS + value * 2, 2);
+    return out + 2;
+}
+
+inline char* put3(char* out, int value) {
+    *out++ = static_cast<char>('0' + value / 100);
+    return put2(out, value % 100);
+}
+
+inline char* putInt(char* out, int64_t value) {
+    return std::to_chars(out, out + 32, value).ptr;
+}
+
+// Быстрый путь покрывает неотрицательные метки, часы которых помещаются в int
+// (прежний код хранил часы в int)
+const int64_t FAST_PATH_LIMIT = static_cast<int64_t>(INT_MAX) * 3600000;
+
+// Медленный путь: точное повторение прежнего форматирования через поток
+size_t copyOut(const std::string& str, char* out) {
+    std::memcpy(out, str.data(), str.size());
+    return str.size();
+}
+
+std::string slowSRT(int64_t ms) {
+    int h = ms / 3600000;
+    ms %= 3600000;
+    int m = ms / 60000;
+    ms %= 60000;
+    int s = ms / 1000;
+    ms %= 1000;
+    std::ostringstream oss;
+    oss << std::setfill('0') << std::setw(2) << h << ":"
+        << std::setw(2) << m << ":"
+        << std::setw(2) << s << ","
+        << std::setw(3) << ms;
+    return oss.str();
+}
+
+std::string slowVTT(int64_t ms) {
+    int h = static_cast<int>(ms / 3600000);
+    ms %= 3600000;
+    int m = static_cast<int>(ms / 60000);
+    ms %= 60000;
+    int s = static_cast<int>(ms / 1000);
+    ms %= 1000;
+    std::ostringstream oss;
+    oss << h << ":"
+        << std::setw(2) << std::setfill('0') << m << ":"
+        << std::setw(2) << std::setfill('0') << s << "."
+        << std::setw(3) << std::setfill('0') << ms;
+    return oss.str();
+}
+
+std::string slowASS(int64_t ms) {
+    int h = static_cast<int>(ms / 3600000);
+    ms %= 3600000;
+    int m = static_cast<int>(ms / 60000);
+    ms %= 60000;
+    int s = static_cast<int>(ms / 1000);
+    ms %= 1000;
+    int cs = static_cast<int>(ms / 10);
+    std::ostringstream oss;
+    oss << h << ":"
+        << std::setw(2) << std::setfill('0') << m << ":"
+        << std::setw(2) << std::setfill('0') << s << "."
+        << std::setw(2) << std::setfill('0') << cs;
+    return oss.str();
+}
+
+} // namespace
+
+size_t TimeCode::formatSRT(int64_t ms, char* out) {
+    if (ms < 0 || ms >= FAST_PATH_LIMIT) return copyOut(slowSRT(ms), out);
+
+    int64_t h = ms / 3600000;
+    char* p = h < 100 ? put2(out, static_cast<int>(h)) : putInt(out, h);
+    *p++ = ':';
+    p = put2(p, static_cast<int>(ms / 60000 % 60));
+    *p++ = ':';
+    p = put2(p, static_cast<int>(ms / 1000 % 60));
+    *p++ = ',';
+    p = put3(p, static_cast<int>(ms % 1000));
+    return p - out;
+}
+
+size_t TimeCode::formatVTT(int64_t ms, char* out) {
+    if (ms < 0 || ms >= FAST_PATH_LIMIT) return copyOut(slowVTT(ms), out);
+
+    char* p = putInt(out, ms / 3600000);
+    *p++ = ':';
+    p = put2(p, static_cast<int>(ms / 60000 % 60));
+    *p++ = ':';
+    p = put2(p, static_cast<int>(ms / 1000 % 60));
+    *p++ = '.';
+    p = put3(p, static_cast<int>(ms % 1000));
+    return p - out;
+}
+
+size_t TimeCode::formatASS(int64_t ms, char* out) {
+    if (ms < 0 || ms >= FAST_PATH_LIMIT) return copyOut(slowASS(ms), out);
+
+    char* p = putInt(out, ms / 3600000);
+    *p++ = ':';
+    p = put2(p, static_cast<int>(ms / 60000 % 60));
+    *p++ = ':';
+    p = put2(p, static_cast<int>(ms / 1000 % 60));
+    *p++ = '.';
+    p = put2(p, static_cast<int>(ms % 1000 / 10));
+    return p - out;
+}
+
+size_t TimeCode::formatInt(int64_t value, char* out) {
+    return putInt(out, value) - out;
+}
+
+namespace {
+
+size_t digitCount(uint64_t value) {
+    size_t digits = 1;
+    while (value >= 10) {
+        value /= 10;
+        ++digits;
+    }
+    return digits;
+}
+
+} // namespace
+
+// После часов всегда ":MM:SS,mmm" (10 знаков) или ":MM:SS.cc" (9 знаков)
+size_t TimeCode::lengthSRT(int64_t ms) {
+    if (ms < 0 || ms >= FAST_PATH_LIMIT) return slowSRT(ms).size();
+    int64_t h = ms / 3600000;
+    return (h < 100 ? 2 : digitCount(h)) + 10;
+}
+
+size_t TimeCode::lengthVTT(int64_t ms) {
+    if (ms < 0 || ms >= FAST_PATH_LIMIT) return slowVTT(ms).size();
+    return digitCount(ms / 3600000) + 10;
+}
+
+size_t TimeCode::lengthASS(int64_t ms) {
+    if (ms < 0 || ms >= FAST_PATH_LIMIT) return slowASS(ms).size();
+    return digitCount(ms / 3600000) + 9;
+}
+
+size_t TimeCode::lengthInt(int64_t value) {
+    if (value >= 0) return digitCount(static_cast<uint64_t>(value));
+    return digitCount(0 - static_cast<uint64_t>(value)) + 1;
+}
+
+std::string TimeCode::toSRT(int64_t ms) {
+    char buf[MAX_LENGTH];
+    return std::string(buf, formatSRT(ms, buf));
+}
+
+std::string TimeCode::toVTT(int64_t ms) {
+    char buf[MAX_LENGTH];
+    return std::string(buf, formatVTT(ms, buf));
+}
+
+std::string TimeCode::toASS(int64_t ms) {
+    char buf[MAX_LENGTH];
+    return std::string(buf, formatASS(ms, buf));
+}
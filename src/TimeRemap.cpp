@@ -0,0 +1,188 @@
+#include "TimeRemap.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+// Округление num/den до ближайшего целого, половина — вверх; den > 0
+template <typename T>
+T roundDiv(T num, T den) {
+    T n = 2 * num + den;
+    T d = 2 * den;
+    T q = n / d;
+    if ((n % d != 0) && (n < 0)) --q; // Деление с округлением вниз
+    return q;
+}
+
+// Рациональное число из "25", "23.976" или "24000/1001"
+void parseRational(const std::string& text, int64_t& num, int64_t& den) {
+    size_t slash = text.find('/');
+    try {
+        size_t used = 0;
+        if (slash != std::string::npos) {
+            num = std::stoll(text.substr(0, slash), &used);
+            if (used != slash) throw std::invalid_argument(text);
+            den = std::stoll(text.substr(slash + 1), &used);
+            if (used != text.size() - slash - 1) throw std::invalid_argument(text);
+        } else {
+            size_t dot = text.find('.');
+            std::string digits = text;
+            den = 1;
+            if (dot != std::string::npos) {
+                digits.erase(dot, 1);
+                for (size_t i = dot; i < digits.size(); ++i) den *= 10;
+            }
+            num = std::stoll(digits, &used);
+            if (used != digits.size() || den > 1000000000) throw std::invalid_argument(text);
+        }
+    } catch (const std::logic_error&) {
+        throw std::runtime_error("Invalid number in time remap: " + text);
+    }
+    if (den == 0) throw std::runtime_error("Invalid number in time remap: " + text);
+    if (den < 0) {
+        num = -num;
+        den = -den;
+    }
+    int64_t g = std::gcd(num, den);
+    if (g > 1) {
+        num /= g;
+        den /= g;
+    }
+}
+
+std::vector<std::string> split(const std::string& text, char delimiter) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (size_t pos; (pos = text.find(delimiter, start)) != std::string::npos; start = pos + 1)
+        parts.push_back(text.substr(start, pos - start));
+    parts.push_back(text.substr(start));
+    return parts;
+}
+
+TimeRemap::Segment makeSegment(int64_t from, int64_t srcBase, int64_t dstBase, int64_t num, int64_t den) {
+    if (den < 0) {
+        num = -num;
+        den = -den;
+    }
+    int64_t g = std::gcd(num, den);
+    if (g > 1) {
+        num /= g;
+        den /= g;
+    }
+    return TimeRemap::Segment{from, srcBase, dstBase, num, den};
+}
+
+} // namespace
+
+TimeRemap::TimeRemap() {}
+
+TimeRemap TimeRemap::linear(int64_t num, int64_t den, int64_t offsetMs) {
+    if (den == 0) throw std::runtime_error("Time remap scale has a zero denominator");
+    TimeRemap remap;
+    remap.segments.push_back(makeSegment(std::numeric_limits<int64_t>::min(), 0, offsetMs, num, den));
+    return remap;
+}
+
+TimeRemap TimeRemap::framerate(const std::string& fromFps, const std::string& toFps) {
+    int64_t fromNum, fromDen, toNum, toDen;
+    parseRational(fromFps, fromNum, fromDen);
+    parseRational(toFps, toNum, toDen);
+    if (fromNum <= 0 || toNum <= 0) throw std::runtime_error("Frame rate must be positive");
+
+    // Кадр n показывается в n / fps, поэтому время умножается на from / to
+    return linear(fromNum * toDen, fromDen * toNum, 0);
+}
+
+TimeRemap TimeRemap::anchors(std::vector<std::pair<int64_t, int64_t>> points) {
+    std::sort(points.begin(), points.end());
+    if (points.empty()) throw std::runtime_error("Time remap needs at least one anchor");
+    for (size_t i = 1; i < points.size(); ++i) {
+        if (points[i].first == points[i - 1].first)
+            throw std::runtime_error("Time remap anchors must have distinct source times");
+    }
+
+    // Одна точка — это сдвиг
+    if (points.size() == 1) return linear(1, 1, points[0].second - points[0].first);
+
+    TimeRemap remap;
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        int64_t from = i == 0 ? std::numeric_limits<int64_t>::min() : points[i].first;
+        remap.segments.push_back(makeSegment(from, points[i].first, points[i].second,
+                                             points[i + 1].second - points[i].second,
+                                             points[i + 1].first - points[i].first));
+    }
+    return remap;
+}
+
+TimeRemap TimeRemap::parse(const std::string& spec) {
+    std::vector<std::string> parts = split(spec, ':');
+    try {
+        if (parts[0] == "fps" && parts.size() == 3) {
+            return framerate(parts[1], parts[2]);
+        }
+        if (parts[0] == "linear" && (parts.size() == 2 || parts.size() == 3)) {
+            int64_t num, den;
+            parseRational(parts[1], num, den);
+            return linear(num, den, parts.size() == 3 ? std::stoll(parts[2]) : 0);
+        }
+        if (parts[0] == "anchors" && parts.size() == 2) {
+            std::vector<std::pair<int64_t, int64_t>> points;
+            for (const std::string& point : split(parts[1], ',')) {
+                size_t eq = point.find('=');
+                if (eq == std::string::npos) throw std::invalid_argument(point);
+                points.emplace_back(std::stoll(point.substr(0, eq)), std::stoll(point.substr(eq + 1)));
+            }
+            return anchors(std::move(points));
+        }
+    } catch (const std::logic_error&) {
+        // Ошибки std::stoll сообщаются ниже вместе со всей строкой
+    }
+    throw std::runtime_error("Invalid time remap: " + spec);
+}
+
+TimeRemap TimeRemap::shifted(int64_t deltaMs) const {
+    if (isIdentity()) return deltaMs == 0 ? TimeRemap() : linear(1, 1, deltaMs);
+    TimeRemap result = *this;
+    for (Segment& s : result.segments) s.dstBase += deltaMs;
+    return result;
+}
+
+bool TimeRemap::isIdentity() const {
+    return segments.empty();
+}
+
+const std::vector<TimeRemap::Segment>& TimeRemap::getSegments() const {
+    return segments;
+}
+
+size_t TimeRemap::findSegment(int64_t t, size_t hint) const {
+    // Времена обычно идут по возрастанию: сначала проверяем участок предыдущего значения
+    if (hint < segments.size() && segments[hint].from <= t &&
+        (hint + 1 == segments.size() || t < segments[hint + 1].from))
+        return hint;
+
+    auto it = std::upper_bound(segments.begin(), segments.end(), t,
+                               [](int64_t value, const Segment& s) { return value < s.from; });
+    return it == segments.begin() ? 0 : static_cast<size_t>(it - segments.begin() - 1);
+}
+
+int64_t TimeRemap::map(int64_t t) const {
+    size_t hint = 0;
+    return map(t, hint);
+}
+
+int64_t TimeRemap::map(int64_t t, size_t& hint) const {
+    if (segments.empty()) return t;
+    hint = findSegment(t, hint);
+    const Segment& s = segments[hint];
+#if defined(__SIZEOF_INT128__)
+    __int128 delta = static_cast<__int128>(t - s.srcBase) * s.num;
+    return s.dstBase + static_cast<int64_t>(roundDiv<__int128>(delta, s.den));
+#else
+    long double delta = static_cast<long double>(t - s.srcBase) * s.num;
+    return s.dstBase + static_cast<int64_t>(std::floor(delta / s.den + 0.5L));
+#endif
+}
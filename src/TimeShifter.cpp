@@ -0,0 +1,268 @@
+#include "TimeShifter.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TIME_SHIFTER_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+inline bool isNote(int64_t start, int64_t end) {
+    return start == -1 && end == -1;
+}
+
+template <bool SkipNotes>
+void shiftScalar(int64_t* start, int64_t* end, size_t count, int64_t delta, bool shiftStart, bool shiftEnd) {
+    for (size_t i = 0; i < count; ++i) {
+        if (SkipNotes && isNote(start[i], end[i])) continue;
+        if (shiftStart) start[i] += delta;
+        if (shiftEnd) end[i] += delta;
+    }
+}
+
+template <bool SkipNotes>
+void clampScalar(int64_t* start, int64_t* end, size_t count, int64_t minMs, int64_t maxMs) {
+    for (size_t i = 0; i < count; ++i) {
+        if (SkipNotes && isNote(start[i], end[i])) continue;
+        start[i] = std::min(std::max(start[i], minMs), maxMs);
+        end[i] = std::min(std::max(end[i], minMs), maxMs);
+    }
+}
+
+template <bool SkipNotes>
+void remapScalar(int64_t* start, int64_t* end, size_t count, const TimeRemap& remap,
+                 size_t& startHint, size_t& endHint) {
+    for (size_t i = 0; i < count; ++i) {
+        if (SkipNotes && isNote(start[i], end[i])) continue;
+        start[i] = remap.map(start[i], startHint);
+        end[i] = remap.map(end[i], endHint);
+    }
+}
+
+#ifdef TIME_SHIFTER_AVX2
+// По 4 записи за итерацию; у заметок маска обнуляет прибавляемый сдвиг
+template <bool SkipNotes, bool ShiftStart, bool ShiftEnd>
+__attribute__((target("avx2")))
+void shiftAVX2(int64_t* start, int64_t* end, size_t count, int64_t delta) {
+    const __m256i vdelta = _mm256_set1_epi64x(delta);
+    const __m256i minusOne = _mm256_set1_epi64x(-1);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(start + i));
+        __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(end + i));
+        __m256i d = vdelta;
+        if (SkipNotes) {
+            __m256i note = _mm256_and_si256(_mm256_cmpeq_epi64(s, minusOne), _mm256_cmpeq_epi64(e, minusOne));
+            d = _mm256_andnot_si256(note, vdelta);
+        }
+        if (ShiftStart) _mm256_storeu_si256(reinterpret_cast<__m256i*>(start + i), _mm256_add_epi64(s, d));
+        if (ShiftEnd) _mm256_storeu_si256(reinterpret_cast<__m256i*>(end + i), _mm256_add_epi64(e, d));
+    }
+    shiftScalar<SkipNotes>(start + i, end + i, count - i, delta, ShiftStart, ShiftEnd);
+}
+
+template <bool SkipNotes>
+__attribute__((target("avx2")))
+void shiftAVX2(int64_t* start, int64_t* end, size_t count, int64_t delta, bool shiftStart, bool shiftEnd) {
+    if (shiftStart && shiftEnd) shiftAVX2<SkipNotes, true, true>(start, end, count, delta);
+    else if (shiftStart) shiftAVX2<SkipNotes, true, false>(start, end, count, delta);
+    else if (shiftEnd) shiftAVX2<SkipNotes, false, true>(start, end, count, delta);
+}
+
+__attribute__((target("avx2")))
+inline __m256i clampVector(__m256i v, __m256i lo, __m256i hi) {
+    v = _mm256_blendv_epi8(v, lo, _mm256_cmpgt_epi64(lo, v));
+    return _mm256_blendv_epi8(v, hi, _mm256_cmpgt_epi64(v, hi));
+}
+
+template <bool SkipNotes>
+__attribute__((target("avx2")))
+void clampAVX2(int64_t* start, int64_t* end, size_t count, int64_t minMs, int64_t maxMs) {
+    const __m256i lo = _mm256_set1_epi64x(minMs);
+    const __m256i hi = _mm256_set1_epi64x(maxMs);
+    const __m256i minusOne = _mm256_set1_epi64x(-1);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(start + i));
+        __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(end + i));
+        __m256i cs = clampVector(s, lo, hi);
+        __m256i ce = clampVector(e, lo, hi);
+        if (SkipNotes) {
+            __m256i note = _mm256_and_si256(_mm256_cmpeq_epi64(s, minusOne), _mm256_cmpeq_epi64(e, minusOne));
+            cs = _mm256_blendv_epi8(cs, s, note);
+            ce = _mm256_blendv_epi8(ce, e, note);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(start + i), cs);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(end + i), ce);
+    }
+    clampScalar<SkipNotes>(start + i, end + i, count - i, minMs, maxMs);
+}
+
+// Целые |x| < 2^51 переводятся в double и обратно через мантиссу 1.5 * 2^52
+const double MAGIC = 6755399441055744.0;
+
+__attribute__((target("avx2")))
+inline __m256i toDoubleBits(__m256i x) {
+    return _mm256_add_epi64(x, _mm256_castpd_si256(_mm256_set1_pd(MAGIC)));
+}
+
+__attribute__((target("avx2")))
+inline __m256d toDouble(__m256i x) {
+    return _mm256_sub_pd(_mm256_castsi256_pd(toDoubleBits(x)), _mm256_set1_pd(MAGIC));
+}
+
+__attribute__((target("avx2")))
+inline __m256i toInt64(__m256d x) {
+    return _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(x, _mm256_set1_pd(MAGIC))),
+                            _mm256_castpd_si256(_mm256_set1_pd(MAGIC)));
+}
+
+// Участок отображения в виде констант для векторного расчёта
+struct VectorSegment {
+    __m256i low, high;       // Границы участка
+    __m256i srcBase, dstBase;
+    __m256i limit, minusLimit; // Допустимое |t - srcBase| для точного расчёта в double
+    __m256d num2, den, den2;
+};
+
+__attribute__((target("avx2")))
+VectorSegment makeVectorSegment(const TimeRemap& remap, size_t index) {
+    const std::vector<TimeRemap::Segment>& segments = remap.getSegments();
+    const TimeRemap::Segment& s = segments[index];
+    int64_t high = index + 1 < segments.size() ? segments[index + 1].from - 1 : INT64_MAX;
+
+    // 2 * |d| * |num| + den < 2^51: все промежуточные значения — точные целые в double
+    int64_t num = s.num < 0 ? -s.num : s.num;
+    int64_t limit = (int64_t(1) << 51) - s.den;
+    limit = num == 0 ? (int64_t(1) << 50) : std::min<int64_t>(limit / (2 * num) - 1, int64_t(1) << 50);
+
+    VectorSegment v;
+    v.low = _mm256_set1_epi64x(s.from);
+    v.high = _mm256_set1_epi64x(high);
+    v.srcBase = _mm256_set1_epi64x(s.srcBase);
+    v.dstBase = _mm256_set1_epi64x(s.dstBase);
+    v.limit = _mm256_set1_epi64x(limit);
+    v.minusLimit = _mm256_set1_epi64x(-limit);
+    v.num2 = _mm256_set1_pd(2.0 * static_cast<double>(s.num));
+    v.den = _mm256_set1_pd(static_cast<double>(s.den));
+    v.den2 = _mm256_set1_pd(2.0 * static_cast<double>(s.den));
+    return v;
+}
+
+// Возвращает false, если хотя бы одно значение блока не лежит в участке
+// или слишком велико для точного расчёта
+__attribute__((target("avx2")))
+inline bool remapVector(__m256i t, const VectorSegment& seg, __m256i& result) {
+    __m256i d = _mm256_sub_epi64(t, seg.srcBase);
+    __m256i bad = _mm256_or_si256(_mm256_cmpgt_epi64(seg.low, t), _mm256_cmpgt_epi64(t, seg.high));
+    bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(d, seg.limit));
+    bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(seg.minusLimit, d));
+    if (!_mm256_testz_si256(bad, bad)) return false;
+
+    // floor((2 * d * num + den) / (2 * den)) — округление до ближайшего, половина вверх
+    __m256d p = _mm256_add_pd(_mm256_mul_pd(toDouble(d), seg.num2), seg.den);
+    __m256d q = _mm256_floor_pd(_mm256_div_pd(p, seg.den2));
+    result = _mm256_add_epi64(toInt64(q), seg.dstBase);
+    return true;
+}
+
+template <bool SkipNotes>
+__attribute__((target("avx2")))
+void remapAVX2(int64_t* start, int64_t* end, size_t count, const TimeRemap& remap) {
+    const __m256i minusOne = _mm256_set1_epi64x(-1);
+    size_t startHint = 0, endHint = 0;
+    VectorSegment startSeg = makeVectorSegment(remap, 0);
+    VectorSegment endSeg = startSeg;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Участок ищется по первому значению блока, остальные проверяются векторно
+        size_t hint = remap.findSegment(start[i], startHint);
+        if (hint != startHint) startSeg = makeVectorSegment(remap, startHint = hint);
+        hint = remap.findSegment(end[i], endHint);
+        if (hint != endHint) endSeg = makeVectorSegment(remap, endHint = hint);
+
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(start + i));
+        __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(end + i));
+        __m256i rs, re;
+        if (!remapVector(s, startSeg, rs) || !remapVector(e, endSeg, re)) {
+            remapScalar<SkipNotes>(start + i, end + i, 4, remap, startHint, endHint);
+            continue;
+        }
+        if (SkipNotes) {
+            __m256i note = _mm256_and_si256(_mm256_cmpeq_epi64(s, minusOne), _mm256_cmpeq_epi64(e, minusOne));
+            rs = _mm256_blendv_epi8(rs, s, note);
+            re = _mm256_blendv_epi8(re, e, note);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(start + i), rs);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(end + i), re);
+    }
+    remapScalar<SkipNotes>(start + i, end + i, count - i, remap, startHint, endHint);
+}
+#endif
+
+TimeShifter::Kernel detectKernel() {
+#ifdef TIME_SHIFTER_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return TagStripper::KERNEL_AVX2;
+#endif
+    return TagStripper::KERNEL_SCALAR;
+}
+
+TimeShifter::Kernel activeKernel = detectKernel();
+
+} // namespace
+
+void TimeShifter::shift(int64_t* start, int64_t* end, size_t count, int64_t deltaMs,
+                        bool shiftStart, bool shiftEnd, bool skipNotes) {
+    if (deltaMs == 0 || (!shiftStart && !shiftEnd)) return;
+#ifdef TIME_SHIFTER_AVX2
+    if (activeKernel == TagStripper::KERNEL_AVX2) {
+        if (skipNotes) shiftAVX2<true>(start, end, count, deltaMs, shiftStart, shiftEnd);
+        else shiftAVX2<false>(start, end, count, deltaMs, shiftStart, shiftEnd);
+        return;
+    }
+#endif
+    if (skipNotes) shiftScalar<true>(start, end, count, deltaMs, shiftStart, shiftEnd);
+    else shiftScalar<false>(start, end, count, deltaMs, shiftStart, shiftEnd);
+}
+
+void TimeShifter::clamp(int64_t* start, int64_t* end, size_t count, int64_t minMs, int64_t maxMs, bool skipNotes) {
+#ifdef TIME_SHIFTER_AVX2
+    if (activeKernel == TagStripper::KERNEL_AVX2) {
+        if (skipNotes) clampAVX2<true>(start, end, count, minMs, maxMs);
+        else clampAVX2<false>(start, end, count, minMs, maxMs);
+        return;
+    }
+#endif
+    if (skipNotes) clampScalar<true>(start, end, count, minMs, maxMs);
+    else clampScalar<false>(start, end, count, minMs, maxMs);
+}
+
+void TimeShifter::remap(int64_t* start, int64_t* end, size_t count, const TimeRemap& remap, bool skipNotes) {
+    if (remap.isIdentity()) return;
+#ifdef TIME_SHIFTER_AVX2
+    if (activeKernel == TagStripper::KERNEL_AVX2) {
+        if (skipNotes) remapAVX2<true>(start, end, count, remap);
+        else remapAVX2<false>(start, end, count, remap);
+        return;
+    }
+#endif
+    size_t startHint = 0, endHint = 0;
+    if (skipNotes) remapScalar<true>(start, end, count, remap, startHint, endHint);
+    else remapScalar<false>(start, end, count, remap, startHint, endHint);
+}
+
+bool TimeShifter::setKernel(Kernel kernel) {
+    if (kernel == TagStripper::KERNEL_AUTO) kernel = detectKernel();
+    if (!TagStripper::isSupported(kernel)) return false;
+    // Для SSE2 отдельной реализации нет
+    activeKernel = kernel == TagStripper::KERNEL_AVX2 ? kernel : TagStripper::KERNEL_SCALAR;
+    return true;
+}
+
+TimeShifter::Kernel TimeShifter::getKernel() {
+    return activeKernel;
+}
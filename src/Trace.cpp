@@ -0,0 +1,152 @@
+#include "Trace.h"
+#include "BufferedWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+std::atomic<bool> Trace::active(false);
+
+namespace {
+
+struct Event {
+    const char* name;
+    uint64_t startNs;
+    uint64_t endNs;
+    std::string detail;
+};
+
+// Буфер событий одного потока. Пишет в него только сам поток, поэтому
+// запись события не берёт блокировку; буферы живут до конца программы,
+// чтобы события завершившихся потоков попали в файл
+struct ThreadBuffer {
+    int tid;
+    std::string name;
+    bool named; // Имя задано setThreadName
+    std::vector<Event> events;
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+thread_local ThreadBuffer* localBuffer = nullptr;
+
+ThreadBuffer& buffer() {
+    if (!localBuffer) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+        localBuffer = registry.back().get();
+        localBuffer->tid = static_cast<int>(registry.size());
+        localBuffer->name = "thread " + std::to_string(localBuffer->tid);
+        localBuffer->named = false;
+    }
+    return *localBuffer;
+}
+
+void writeJsonString(BufferedWriter& out, std::string_view str) {
+    out << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out << buf;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// Микросекунды с тремя знаками после точки, как ожидает формат trace events
+void writeMicros(BufferedWriter& out, uint64_t ns) {
+    char buf[8];
+    std::snprintf(buf, sizeof(buf), ".%03u", static_cast<unsigned>(ns % 1000));
+    out << static_cast<int64_t>(ns / 1000) << buf;
+}
+
+} // namespace
+
+void Trace::start() {
+    // Поток, включивший трассировку, — основной, если его не назвали иначе
+    ThreadBuffer& caller = buffer();
+    if (!caller.named) caller.name = "main";
+    active.store(true, std::memory_order_relaxed);
+}
+
+void Trace::stop() {
+    active.store(false, std::memory_order_relaxed);
+}
+
+bool Trace::isCompiledIn() {
+#ifdef SUBTITLE_ENABLE_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Trace::setThreadName(const std::string& name) {
+    ThreadBuffer& thread = buffer();
+    thread.name = name;
+    thread.named = true;
+}
+
+uint64_t Trace::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Trace::record(const char* name, uint64_t startNs, uint64_t endNs, const std::string& detail) {
+    buffer().events.push_back(Event{name, startNs, endNs, detail});
+}
+
+void Trace::clear() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& thread : registry) thread->events.clear();
+}
+
+// Вызывается, когда потоки с трассировкой уже закончили работу. На время
+// записи трассировка приостанавливается: сам вывод идёт через BufferedWriter
+// с точками трассировки
+void Trace::write(const std::string& filename) {
+    bool wasActive = active.exchange(false);
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    uint64_t origin = UINT64_MAX;
+    for (const auto& thread : registry)
+        for (const Event& event : thread->events) origin = std::min(origin, event.startNs);
+    if (origin == UINT64_MAX) origin = 0;
+
+    BufferedWriter out(filename);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& thread : registry) {
+        out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->tid
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, thread->name);
+        out << "}}";
+        first = false;
+
+        for (const Event& event : thread->events) {
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->tid << ",\"ts\":";
+            writeMicros(out, event.startNs - origin);
+            out << ",\"dur\":";
+            writeMicros(out, event.endNs - event.startNs);
+            if (!event.detail.empty()) {
+                out << ",\"args\":{\"detail\":";
+                writeJsonString(out, event.detail);
+                out << '}';
+            }
+            out << '}';
+        }
+    }
+    out << "\n]}\n";
+    out.close();
+    if (wasActive) active.store(true, std::memory_order_relaxed);
+}
@@ -0,0 +1,126 @@
+#include "TransformPipeline.h"
+#include "PhaseStats.h"
+#include "Trace.h"
+
+TransformPipeline::TransformPipeline()
+    : shiftMs(0), removeFormatting(false), styleFlags(0), richText(false), fromMarkup(RichText::MARKUP_HTML),
+      toMarkup(RichText::MARKUP_HTML) {}
+
+void TransformPipeline::setRemap(const TimeRemap& remap) {
+    this->remap = remap;
+}
+
+void TransformPipeline::setShift(int64_t deltaMs) {
+    shiftMs = deltaMs;
+}
+
+void TransformPipeline::setRemoveFormatting(bool remove) {
+    removeFormatting = remove;
+}
+
+// Обёртка строится один раз, а не для каждой записи
+void TransformPipeline::setStyle(const std::string& style) {
+    this->style = style;
+    prefix = style.empty() ? std::string() : "<" + style + ">";
+    suffix = style.empty() ? std::string() : "</" + style + ">";
+    styleFlags = RichText::flagOf(style);
+}
+
+void TransformPipeline::setMarkup(RichText::Markup from, RichText::Markup to) {
+    richText = true;
+    fromMarkup = from;
+    toMarkup = to;
+}
+
+const TimeRemap& TransformPipeline::getRemap() const {
+    return remap;
+}
+
+int64_t TransformPipeline::getShift() const {
+    return shiftMs;
+}
+
+bool TransformPipeline::getRemoveFormatting() const {
+    return removeFormatting;
+}
+
+const std::string& TransformPipeline::getStyle() const {
+    return style;
+}
+
+bool TransformPipeline::convertsMarkup() const {
+    return richText;
+}
+
+bool TransformPipeline::isEmpty() const {
+    return !changesTimes() && !changesText();
+}
+
+bool TransformPipeline::changesTimes() const {
+    return !remap.isIdentity() || shiftMs != 0;
+}
+
+bool TransformPipeline::changesText() const {
+    return removeFormatting || !style.empty() || richText;
+}
+
+void TransformPipeline::apply(SubtitleEntryList& entries, TextEditor stripper, bool skipNotes) const {
+    if (changesTimes()) {
+        PhaseStats::Scope phase(PhaseStats::SHIFT);
+        TRACE_SCOPE("TransformPipeline::times");
+        // Чистый сдвиг быстрее общего remap, поэтому remap нужен только при его наличии
+        if (remap.isIdentity()) {
+            entries.shiftTimes(shiftMs, true, true, skipNotes);
+        } else {
+            entries.remapTimes(remap.shifted(shiftMs), skipNotes);
+        }
+    }
+    if (changesText()) {
+        // Общий проход по тексту учитывается как удаление разметки, если оно есть
+        PhaseStats::Scope phase(removeFormatting ? PhaseStats::STRIP : PhaseStats::STYLE);
+        TRACE_SCOPE("TransformPipeline::text");
+        if (!richText) {
+            entries.editTexts(removeFormatting ? stripper : nullptr, prefix, suffix);
+            return;
+        }
+        for (size_t i = 0; i < entries.getSize(); ++i) {
+            if (skipNotes && entries.getStart(i) == -1 && entries.getEnd(i) == -1) continue;
+            entries.setText(i, convertMarkup(entries.getText(i)));
+        }
+    }
+}
+
+void TransformPipeline::apply(SubtitleEntry& entry, TextEditor stripper, bool skipNotes) const {
+    bool isNote = skipNotes && entry.start_ms == -1 && entry.end_ms == -1;
+    if (!isNote && !remap.isIdentity()) {
+        entry.start_ms = remap.map(entry.start_ms);
+        entry.end_ms = remap.map(entry.end_ms);
+    }
+    if (!isNote) {
+        entry.start_ms += shiftMs;
+        entry.end_ms += shiftMs;
+    }
+
+    std::string& text = entry.text;
+    if (richText) {
+        if (!isNote) text = convertMarkup(text);
+        return;
+    }
+    if (removeFormatting && !text.empty())
+        text.resize(stripper(&text[0], text.size()));
+    if (!style.empty()) {
+        text.reserve(prefix.size() + text.size() + suffix.size());
+        text.insert(0, prefix);
+        text.append(suffix);
+    }
+}
+
+// Стиль, который не выражается отрезками, оборачивает результат как раньше
+std::string TransformPipeline::convertMarkup(std::string_view text) const {
+    RichText rich = RichText::parse(text, fromMarkup);
+    if (removeFormatting) rich.clearFormatting();
+    if (styleFlags) rich.addFlags(styleFlags);
+    std::string out = rich.format(toMarkup);
+    if (!style.empty() && !styleFlags) return prefix + out + suffix;
+    return out;
+}
@@ -0,0 +1,189 @@
+#include "VTTSegmenter.h"
+#include "SRTSubtitle.h"
+#include "SAMISubtitle.h"
+#include "ASSSubtitle.h"
+#include "VTTSubtitle.h"
+#include "BufferedWriter.h"
+#include "Converter.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+// Сегменты маленькие, большой буфер для каждого файла не нужен
+const size_t SEGMENT_BUFFER_SIZE = 64 << 10;
+
+bool overlaps(int64_t start, int64_t end, int64_t segmentStart, int64_t segmentEnd) {
+    if (start == end) return start >= segmentStart && start < segmentEnd;
+    return start < segmentEnd && end > segmentStart;
+}
+
+// "6.000" для #EXTINF
+void writeSeconds(BufferedWriter& out, int64_t ms) {
+    out << ms / 1000 << '.';
+    int64_t rest = ms % 1000;
+    out.put(static_cast<char>('0' + rest / 100));
+    out.put(static_cast<char>('0' + rest / 10 % 10));
+    out.put(static_cast<char>('0' + rest % 10));
+}
+
+} // namespace
+
+VTTSegmenter::Options::Options()
+    : outputDir("."), segmentMs(6000), mpegts(0), durationMs(0),
+      segmentPrefix("segment"), playlistName("playlist.m3u8") {}
+
+VTTSegmenter::VTTSegmenter(const Options& options) : options(options), lastEnd(0), finished(false), ordered(true) {
+    if (this->options.segmentMs <= 0) throw std::runtime_error("Segment duration must be positive");
+    std::filesystem::create_directories(this->options.outputDir);
+}
+
+void VTTSegmenter::add(const SubtitleEntryView& entry) {
+    if (entry.start_ms == -1 && entry.end_ms == -1) return; // Заметка
+    if (entry.end_ms < entry.start_ms) return;
+    if (options.durationMs > 0 && entry.start_ms >= options.durationMs) return;
+    // После сдвига назад запись может начаться до нуля: закончившаяся до
+    // начала дорожки не выводится, остальные начинаются с нуля
+    if (entry.start_ms < 0 && entry.end_ms <= 0) return;
+    int64_t start = std::max<int64_t>(entry.start_ms, 0);
+    if (!ordered) return;
+    // Сегменты до текущего уже записаны: такую запись можно вывести, только нарезав всё заново
+    if (start < static_cast<int64_t>(durations.size()) * options.segmentMs) {
+        ordered = false;
+        return;
+    }
+
+    // Все сегменты, закончившиеся до начала записи, уже полные
+    while (start >= static_cast<int64_t>(durations.size() + 1) * options.segmentMs)
+        writeSegment(static_cast<int64_t>(durations.size() + 1) * options.segmentMs);
+
+    active.push_back(Cue{start, entry.end_ms, std::string(entry.text)});
+    lastEnd = std::max(lastEnd, entry.end_ms);
+}
+
+void VTTSegmenter::finish() {
+    if (finished) return;
+    if (!ordered) throw std::runtime_error("VTTSegmenter: cues are not sorted by start time");
+    finished = true;
+
+    int64_t total = options.durationMs > 0 ? options.durationMs : lastEnd;
+    while (durations.empty() || static_cast<int64_t>(durations.size()) * options.segmentMs < total) {
+        int64_t segmentEnd = static_cast<int64_t>(durations.size() + 1) * options.segmentMs;
+        writeSegment(total > 0 ? std::min(segmentEnd, total) : segmentEnd);
+    }
+
+    int64_t longest = *std::max_element(durations.begin(), durations.end());
+    BufferedWriter out((std::filesystem::path(options.outputDir) / options.playlistName).string(), SEGMENT_BUFFER_SIZE);
+    out << "#EXTM3U\n"
+        << "#EXT-X-VERSION:3\n"
+        << "#EXT-X-TARGETDURATION:" << (longest + 999) / 1000 << "\n"
+        << "#EXT-X-MEDIA-SEQUENCE:0\n"
+        << "#EXT-X-PLAYLIST-TYPE:VOD\n";
+    for (size_t i = 0; i < durations.size(); ++i) {
+        out << "#EXTINF:";
+        writeSeconds(out, durations[i]);
+        out << ",\n" << options.segmentPrefix << i << ".vtt\n";
+    }
+    out << "#EXT-X-ENDLIST\n";
+    out.close();
+}
+
+bool VTTSegmenter::isOrdered() const {
+    return ordered;
+}
+
+size_t VTTSegmenter::getSegmentCount() const {
+    return durations.size();
+}
+
+void VTTSegmenter::writeSegment(int64_t segmentEnd) {
+    TRACE_SCOPE("VTTSegmenter::writeSegment");
+    size_t index = durations.size();
+    int64_t segmentStart = static_cast<int64_t>(index) * options.segmentMs;
+    std::string name = options.segmentPrefix + std::to_string(index) + ".vtt";
+
+    BufferedWriter out((std::filesystem::path(options.outputDir) / name).string(), SEGMENT_BUFFER_SIZE);
+    out << "WEBVTT\nX-TIMESTAMP-MAP=MPEGTS:" << options.mpegts << ",LOCAL:00:00:00.000\n\n";
+
+    // Запись остаётся в active, пока не закончится; отсортированный вход
+    // гарантирует, что все записи сегмента уже добавлены
+    size_t kept = 0;
+    for (size_t i = 0; i < active.size(); ++i) {
+        Cue& cue = active[i];
+        if (overlaps(cue.start_ms, cue.end_ms, segmentStart, segmentEnd)) {
+            SubtitleEntryView view;
+            view.start_ms = cue.start_ms;
+            view.end_ms = cue.end_ms;
+            view.text = cue.text;
+            VTTSubtitle::writeEntry(out, view, i);
+        }
+        bool done = cue.start_ms == cue.end_ms ? cue.start_ms < segmentEnd : cue.end_ms <= segmentEnd;
+        if (!done) {
+            if (kept != i) active[kept] = std::move(cue);
+            ++kept;
+        }
+    }
+    active.resize(kept);
+    out.close();
+
+    durations.push_back(segmentEnd - segmentStart);
+}
+
+void VTTSegmenter::segment(const SubtitleEntryList& entries, const Options& options) {
+    TRACE_SCOPE("VTTSegmenter::segment");
+    std::vector<size_t> order(entries.getSize());
+    std::iota(order.begin(), order.end(), size_t(0));
+    const int64_t* start = entries.startTimes();
+    std::stable_sort(order.begin(), order.end(), [start](size_t a, size_t b) { return start[a] < start[b]; });
+
+    VTTSegmenter segmenter(options);
+    for (size_t index : order)
+        segmenter.add(entries.view(index));
+    segmenter.finish();
+}
+
+void VTTSegmenter::segmentFile(const std::string& inFile, const Options& options) {
+    std::string extension = Converter::extensionOf(inFile);
+    if (extension == "ass" || extension == "ssa") {
+        ASSSubtitle ass;
+        ass.read(inFile);
+        segment(ass.getEntries(), options);
+        return;
+    }
+
+    VTTSegmenter segmenter(options);
+    EntrySink sink = [&segmenter](SubtitleEntry&& entry) { segmenter.add(entry); };
+    if (extension == "srt") {
+        SRTSubtitle().readStream(inFile, sink);
+    } else if (extension == "vtt") {
+        VTTSubtitle().readStream(inFile, false, sink);
+    } else if (extension == "smi") {
+        SAMISubtitle().readStream(inFile, sink);
+    } else {
+        throw std::runtime_error("Unsupported input file format: " + extension);
+    }
+    if (segmenter.isOrdered()) {
+        segmenter.finish();
+        return;
+    }
+
+    // Записи идут не по порядку: читаем файл целиком и нарезаем с сортировкой,
+    // сегменты первого прохода перезаписываются
+    if (extension == "srt") {
+        SRTSubtitle srt;
+        srt.read(inFile);
+        segment(srt.getEntries(), options);
+    } else if (extension == "vtt") {
+        VTTSubtitle vtt;
+        vtt.read(inFile, false);
+        segment(vtt.getEntries(), options);
+    } else {
+        SAMISubtitle sami;
+        sami.read(inFile);
+        segment(sami.getEntries(), options);
+    }
+}
@@ -1,9 +1,15 @@
 #include "VTTSubtitle.h"
-#include <fstream>
-#include <sstream>
+#include "PhaseStats.h"
+#include "Trace.h"
+#include "TagStripper.h"
+#include "MappedFile.h"
+#include "LineReader.h"
+#include "BufferedWriter.h"
+#include "TimeCode.h"
+#include "ParallelParser.h"
+#include "ParallelWriter.h"
+#include <cstring>
 #include <stdexcept>
-#include <regex>
-#include <iomanip> // Для setw и setfill
 
 // Конвертирует строку времени в миллисекунды
 int64_t VTTSubtitle::parseTime(const std::string& timeStr) {
@@ -30,45 +36,55 @@ int64_t VTTSubtitle::parseTime(const std::string& timeStr) {
 
 // Конвертирует миллисекунды в строку времени
 std::string VTTSubtitle::formatTime(int64_t ms) {
-    int h = static_cast<int>(ms / 3600000);
-    ms %= 3600000;
-    int m = static_cast<int>(ms / 60000);
-    ms %= 60000;
-    int s = static_cast<int>(ms / 1000);
-    ms %= 1000;
-
-    std::ostringstream oss;
-    oss << h << ":"
-        << std::setw(2) << std::setfill('0') << m << ":"
-        << std::setw(2) << std::setfill('0') << s << "."
-        << std::setw(3) << std::setfill('0') << ms;
-    return oss.str();
+    return TimeCode::toVTT(ms);
 }
 
 // Чтение VTT-файла
-void VTTSubtitle::read(const std::string& filename, bool keepNotes) {
-    std::ifstream in(filename, std::ios::binary);
-    if (!in.is_open()) {
-        throw std::runtime_error("Cannot open file: " + filename);
+void VTTSubtitle::read(const std::string& filename, bool keepNotes, size_t threads) {
+    PhaseStats::Scope phase(PhaseStats::PARSE);
+    TRACE_SCOPE("VTTSubtitle::read");
+    // Файл открывается и перекодируется один раз: если ParallelParser
+    // отказался, тот же текст разбирается последовательно
+    MappedFile file(filename);
+    file.decodeText();
+    LineReader in(file.view());
+    readHeader(in);
+    if (threads != 1) {
+        auto parser = [keepNotes](std::string_view chunk, const EntrySink& sink) {
+            LineReader part(chunk);
+            parseCues(part, keepNotes, sink, nullptr);
+        };
+        if (ParallelParser::parse(file.view(), in.tell(), threads, parser, entries)) return;
     }
+    parseCues(in, keepNotes, [this](SubtitleEntry&& entry) { entries.push_back(std::move(entry)); }, &file);
+}
 
-    std::string line;
-    std::getline(in, line);
-
-// Удаляем BOM и пробелы
-if (!line.empty() && line[0] == '\xEF' && line[1] == '\xBB' && line[2] == '\xBF') {
-    line = line.substr(3); // Удаляем первые 3 байта BOM
+// Потоковое чтение VTT-файла
+void VTTSubtitle::readStream(const std::string& filename, bool keepNotes, const EntrySink& sink) {
+    TRACE_SCOPE("VTTSubtitle::readStream");
+    MappedFile file(filename);
+    file.decodeText();
+    LineReader in(file.view()); // BOM и CRLF обрабатываются сканером
+    readHeader(in);
+    parseCues(in, keepNotes, sink, &file);
 }
-line.erase(0, line.find_first_not_of(" \t\r\n"));
-line.erase(line.find_last_not_of(" \t\r\n") + 1);
 
-if (line != "WEBVTT") {
-    throw std::runtime_error("Invalid VTT file: Missing WEBVTT header");
+void VTTSubtitle::readHeader(LineReader& in) {
+    std::string_view line;
+    in.getLine(line);
+    line = LineReader::trim(line);
+
+    if (line != "WEBVTT") {
+        throw std::runtime_error("Invalid VTT file: Missing WEBVTT header");
+    }
 }
 
-    while (std::getline(in, line)) {
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
+// Записи и заметки до конца in; после пустой строки всегда начинается новый блок
+void VTTSubtitle::parseCues(LineReader& in, bool keepNotes, const EntrySink& sink, MappedFile* file) {
+    std::string_view line;
+    while (in.getLine(line)) {
+        if (file) file->release(in.tell());
+        line = LineReader::trim(line);
 
         if (line.empty()) continue;
 
@@ -76,7 +92,7 @@ if (line != "WEBVTT") {
         if (line.substr(0, 4) == "NOTE") {
             if (!keepNotes) {
                 // Пропускаем заметки, если они не нужны
-                while (std::getline(in, line) && !line.empty()) {
+                while (in.getLine(line) && !line.empty()) {
                     // Просто читаем до конца заметки
                 }
                 continue;
@@ -87,94 +103,123 @@ if (line != "WEBVTT") {
             entry.end_ms = -1; // Временные метки для заметки
             entry.text = line.substr(4);
 
-            while (std::getline(in, line) && !line.empty()) {
-                entry.text += "\n" + line;
+            while (in.getLine(line) && !line.empty()) {
+                entry.text += '\n';
+                entry.text += line;
             }
 
-            entries.push_back(entry);
+            sink(std::move(entry));
             continue;
         }
 
         // Обработка субтитров (временные метки и текст)
-        if (line.find("-->") != std::string::npos) {
-            std::string startStr = line.substr(0, line.find("-->"));
-            std::string endStr = line.substr(line.find("-->") + 3);
-
-            startStr.erase(0, startStr.find_first_not_of(" \t\r\n"));
-            startStr.erase(startStr.find_last_not_of(" \t\r\n") + 1);
-            endStr.erase(0, endStr.find_first_not_of(" \t\r\n"));
-            endStr.erase(endStr.find_last_not_of(" \t\r\n") + 1);
+        size_t arrow = line.find("-->");
+        if (arrow != std::string_view::npos) {
+            std::string startStr(LineReader::trim(line.substr(0, arrow)));
+            std::string endStr(LineReader::trim(line.substr(arrow + 3)));
 
             int64_t startMs = parseTime(startStr);
             int64_t endMs = parseTime(endStr);
 
-            std::string text;
-            while (std::getline(in, line) && !line.empty()) {
-                if (!text.empty()) text += "\n";
-                text += line;
-            }
-
             SubtitleEntry entry;
             entry.start_ms = startMs;
             entry.end_ms = endMs;
-            entry.text = text;
 
-            entries.push_back(entry);
+            std::string& text = entry.text;
+            while (in.getLine(line) && !line.empty()) {
+                if (!text.empty()) text += '\n';
+                text += line;
+            }
+
+            sink(std::move(entry));
         }
     }
 }
 // Запись VTT-файла
-void VTTSubtitle::write(const std::string& filename) const {
-    std::ofstream out(filename);
-    if (!out.is_open()) {
-        throw std::runtime_error("Cannot write file: " + filename);
+void VTTSubtitle::write(const std::string& filename, size_t threads) const {
+    PhaseStats::Scope phase(PhaseStats::FORMAT);
+    TRACE_SCOPE("VTTSubtitle::write");
+    PhaseStats::addCues(entries.getSize());
+    if (threads != 1) {
+        BufferedWriter header(64), footer(64);
+        writeHeader(header);
+        writeFooter(footer);
+        if (ParallelWriter::write(filename, entries, header.view(), footer.view(), entrySize, writeEntry, threads))
+            return;
     }
+    BufferedWriter out(filename);
 
+    writeHeader(out);
+    for (size_t i = 0; i < entries.getSize(); ++i) {
+        writeEntry(out, entries.view(i), i);
+    }
+    writeFooter(out);
+    out.close();
+}
+
+void VTTSubtitle::writeSegments(const VTTSegmenter::Options& options) const {
+    VTTSegmenter::segment(entries, options);
+}
+
+size_t VTTSubtitle::entrySize(const SubtitleEntryView& entry, size_t) {
+    if (entry.start_ms == -1 && entry.end_ms == -1) return 5 + entry.text.size() + 2;
+    return TimeCode::lengthVTT(entry.start_ms) + 5 + TimeCode::lengthVTT(entry.end_ms) + 1 + entry.text.size() + 2;
+}
+
+void VTTSubtitle::writeHeader(BufferedWriter& out) {
     out << "WEBVTT" << "\n\n";
+}
 
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        const auto& entry = entries[i];
-
-        if (entry.start_ms == -1 && entry.end_ms == -1) {
-            // Это заметка
-            out << "NOTE " << entry.text << "\n\n";
-        } else {
-            // Это субтитры
-            out << formatTime(entry.start_ms) << " --> " << formatTime(entry.end_ms) << "\n";
-            out << entry.text << "\n\n";
-        }
+void VTTSubtitle::writeEntry(BufferedWriter& out, const SubtitleEntryView& entry, size_t) {
+    if (entry.start_ms == -1 && entry.end_ms == -1) {
+        // Это заметка
+        out << "NOTE " << entry.text << "\n\n";
+    } else {
+        // Это субтитры: метки времени пишутся прямо в буфер вывода
+        char* p = out.reserve(2 * TimeCode::MAX_LENGTH + 6);
+        size_t n = TimeCode::formatVTT(entry.start_ms, p);
+        std::memcpy(p + n, " --> ", 5);
+        n += 5;
+        n += TimeCode::formatVTT(entry.end_ms, p + n);
+        p[n++] = '\n';
+        out.commit(n);
+        out << entry.text << "\n\n";
     }
 }
 
+void VTTSubtitle::writeFooter(BufferedWriter&) {}
+
 SubtitleEntryList& VTTSubtitle::getEntries() {
     return entries;
 }
 
 void VTTSubtitle::removeFormatting() {
-    std::regex removeTags("<[^>]*>");
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        entries[i].text = std::regex_replace(entries[i].text, removeTags, "");
-    }
+    TransformPipeline pipeline;
+    pipeline.setRemoveFormatting(true);
+    transform(pipeline);
 }
 
 void VTTSubtitle::addDefaultStyle(const std::string& style) {
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        entries[i].text = "<" + style + ">" + entries[i].text + "</" + style + ">";
-    }
+    TransformPipeline pipeline;
+    pipeline.setStyle(style);
+    transform(pipeline);
 }
 
 void VTTSubtitle::shiftTime(int64_t delta_ms, TimeShiftType type) {
-    for (size_t i = 0; i < entries.getSize(); ++i) {
-        if (entries[i].start_ms == -1 && entries[i].end_ms == -1) {
-            // Пропускаем заметки
-            continue;
-        }
+    PhaseStats::Scope phase(PhaseStats::SHIFT);
+    TRACE_SCOPE("VTTSubtitle::shiftTime");
+    // Заметки (-1/-1) не сдвигаются
+    entries.shiftTimes(delta_ms, type == START_END || type == START_ONLY, type == START_END || type == END_ONLY, true);
+}
 
-        if (type == START_ONLY || type == START_END) {
-            entries[i].start_ms += delta_ms;
-        }
-        if (type == END_ONLY || type == START_END) {
-            entries[i].end_ms += delta_ms;
-        }
-    }
+void VTTSubtitle::remapTime(const TimeRemap& remap) {
+    PhaseStats::Scope phase(PhaseStats::SHIFT);
+    TRACE_SCOPE("VTTSubtitle::remapTime");
+    // Заметки (-1/-1) не меняются
+    entries.remapTimes(remap, true);
+}
+
+void VTTSubtitle::transform(const TransformPipeline& pipeline) {
+    // Заметки (-1/-1) не сдвигаются
+    pipeline.apply(entries, TagStripper::removeHtmlTags, true);
 }
\ No newline at end of file
@@ -1,177 +1,202 @@
-#include "SRTSubtitle.h"
-#include "SAMISubtitle.h"
-#include "ASSSubtitle.h"
-#include "VTTSubtitle.h"
-
+#include "Converter.h"
+#include "BatchConverter.h"
+#include "VTTSegmenter.h"
+#include "TagStripper.h"
+#include "TimeShifter.h"
+#include "TextEncoding.h"
+#include "PhaseStats.h"
+#include "Trace.h"
+
+#include <fstream>
 #include <iostream>
 #include <string>
-#include <filesystem>
 #include <stdexcept>
+#include <vector>
+
+// Prints the JSON summary to stderr or writes it to a file
+static void writeStats(const std::string& json, const std::string& statsFile) {
+    if (statsFile.empty()) {
+        std::cerr << json;
+        return;
+    }
+    std::ofstream out(statsFile);
+    if (!out || !(out << json)) throw std::runtime_error("Cannot write file: " + statsFile);
+}
 
+// Writes the recorded timeline if --trace was given
+static void writeTrace(const std::string& traceFile) {
+    if (traceFile.empty() || !Trace::isActive()) return;
+    Trace::stop();
+    Trace::write(traceFile);
+}
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
         std::cerr << "Usage: converter_subs <in_file> <out_file> [options]\n";
+        std::cerr << "       converter_subs --batch <dir|list_file> <out_pattern> --format <ext> [options]\n";
+        std::cerr << "       converter_subs --hls <in_file> <out_dir> [--segment-duration <s>] [--mpegts <ticks>]\n";
         std::cerr << "Options:\n";
         std::cerr << "  --shift-time <ms>        Shift subtitles by <ms> milliseconds.\n";
+        std::cerr << "  --remap <spec>           Retime before shifting: fps:<from>:<to>, linear:<scale>:<offset_ms>,\n";
+        std::cerr << "                           anchors:<src_ms>=<dst_ms>,<src_ms>=<dst_ms>,...\n";
         std::cerr << "  --remove-formatting      Remove formatting from subtitles.\n";
         std::cerr << "  --add-style <styleName>  Add a style to the subtitles.\n";
+        std::cerr << "  --simd <kernel>          Tag stripping/UTF-8 validation kernel: auto, scalar, sse2, avx2.\n";
+        std::cerr << "  --input-encoding <enc>   Input encoding: auto (BOM/content), utf-8, utf-16le, utf-16be,\n";
+        std::cerr << "                           cp1251, cp1252 (default: auto).\n";
+        std::cerr << "  --output-encoding <enc>  Output encoding: utf-8, utf-16le, utf-16be, cp1251, cp1252.\n";
+        std::cerr << "  --stream                 Convert SRT/VTT/SMI -> SRT/VTT/SMI with constant memory.\n";
+        std::cerr << "  --arena                  Keep cue text in large contiguous blocks.\n";
+        std::cerr << "  --parse-threads <n>      Parse one large SRT/VTT file on <n> threads (0: all cores).\n";
+        std::cerr << "  --write-threads <n>      Write one large SRT/VTT/ASS file on <n> threads (0: all cores).\n";
+        std::cerr << "  --rich-text              Carry bold/italic/underline/colour/position markup across formats.\n";
+        std::cerr << "  --stats                  Print per-phase timings and counters as JSON to stderr.\n";
+        std::cerr << "  --stats-file <path>      Write the --stats JSON summary to <path> instead.\n";
+        std::cerr << "  --trace <file.json>      Write a Chrome/Perfetto trace of the conversion to <file.json>.\n";
+        std::cerr << "Batch options:\n";
+        std::cerr << "  --format <ext>           Output format: srt, vtt, smi, ass, subbin.\n";
+        std::cerr << "  --jobs <n>               Worker threads (default: number of cores).\n";
+        std::cerr << "  <out_pattern> is an output directory or a path with {dir}, {name}, {ext}.\n";
+        std::cerr << "HLS options:\n";
+        std::cerr << "  --segment-duration <s>   WebVTT segment length in seconds (default: 6).\n";
+        std::cerr << "  --mpegts <ticks>         MPEGTS value of X-TIMESTAMP-MAP (default: 0).\n";
         return 1;
     }
 
-    std::string inFile = argv[1];
-    std::string outFile = argv[2];
+    bool batchMode = std::string(argv[1]) == "--batch";
+    bool hlsMode = std::string(argv[1]) == "--hls";
+    if ((batchMode || hlsMode) && argc < 4) {
+        std::cerr << "Error: " << argv[1] << " requires an input and an output\n";
+        return 1;
+    }
 
-    int64_t shiftTimeMs = 0;
-    bool removeFormatting = false;
-    std::string addStyle;
+    std::string inFile = batchMode || hlsMode ? argv[2] : argv[1];
+    std::string outFile = batchMode || hlsMode ? argv[3] : argv[2];
+
+    ConversionOptions options;
+    std::string format;
+    size_t jobs = 0;
+    std::string remapSpec;
+    VTTSegmenter::Options hlsOptions;
+    PhaseStats stats;
+    std::string statsFile;
+    std::string traceFile;
 
     // Parse optional arguments
-    for (int i = 3; i < argc; ++i) {
+    for (int i = batchMode || hlsMode ? 4 : 3; i < argc; ++i) {
         if (std::string(argv[i]) == "--shift-time" && i + 1 < argc) {
-            shiftTimeMs = std::stoll(argv[++i]);
+            options.shiftTimeMs = std::stoll(argv[++i]);
+        } else if (std::string(argv[i]) == "--remap" && i + 1 < argc) {
+            remapSpec = argv[++i];
         } else if (std::string(argv[i]) == "--remove-formatting") {
-            removeFormatting = true;
+            options.removeFormatting = true;
         } else if (std::string(argv[i]) == "--add-style" && i + 1 < argc) {
-            addStyle = argv[++i];
+            options.addStyle = argv[++i];
+        } else if (std::string(argv[i]) == "--stream") {
+            options.stream = true;
+        } else if (std::string(argv[i]) == "--arena") {
+            options.arena = true;
+        } else if (std::string(argv[i]) == "--parse-threads" && i + 1 < argc) {
+            options.parseThreads = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--write-threads" && i + 1 < argc) {
+            options.writeThreads = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--rich-text") {
+            options.richText = true;
+        } else if (std::string(argv[i]) == "--stats") {
+            options.stats = &stats;
+        } else if (std::string(argv[i]) == "--stats-file" && i + 1 < argc) {
+            options.stats = &stats;
+            statsFile = argv[++i];
+        } else if (std::string(argv[i]) == "--trace" && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (std::string(argv[i]) == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        } else if (std::string(argv[i]) == "--segment-duration" && i + 1 < argc) {
+            hlsOptions.segmentMs = static_cast<int64_t>(std::stod(argv[++i]) * 1000 + 0.5);
+        } else if (std::string(argv[i]) == "--mpegts" && i + 1 < argc) {
+            hlsOptions.mpegts = std::stoll(argv[++i]);
+        } else if (std::string(argv[i]) == "--jobs" && i + 1 < argc) {
+            jobs = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--simd" && i + 1 < argc) {
+            TagStripper::Kernel kernel;
+            std::string name = argv[++i];
+            if (!TagStripper::parseKernel(name, kernel) || !TagStripper::setKernel(kernel)) {
+                std::cerr << "Warning: SIMD kernel '" << name << "' is not available, using "
+                          << TagStripper::kernelName(TagStripper::getKernel()) << "\n";
+            }
+            TimeShifter::setKernel(TagStripper::getKernel());
+            TextEncoding::setKernel(TagStripper::getKernel());
+        } else if ((std::string(argv[i]) == "--input-encoding" || std::string(argv[i]) == "--output-encoding") &&
+                   i + 1 < argc) {
+            bool input = std::string(argv[i]) == "--input-encoding";
+            std::string name = argv[++i];
+            TextEncoding::Encoding encoding;
+            if (!TextEncoding::parseEncoding(name, encoding) || (!input && encoding == TextEncoding::ENCODING_AUTO)) {
+                std::cerr << "Error: unsupported encoding '" << name << "'\n";
+                return 1;
+            }
+            if (input) TextEncoding::setInputEncoding(encoding);
+            else options.outputEncoding = encoding;
         }
     }
 
-    try {
-        SRTSubtitle srtSubs;
-        SAMISubtitle samiSubs;
-        ASSSubtitle assSubs;
-        VTTSubtitle vttSubs;
-
-        std::string inExtension = inFile.substr(inFile.find_last_of(".") + 1);
-        std::string outExtension = outFile.substr(outFile.find_last_of(".") + 1);
-
-        bool keepNotes = (inExtension == "vtt" && outExtension == "vtt");
-
-        // Determine the input format
-        if (inExtension == "srt") {
-            srtSubs.read(inFile);
+    if (!traceFile.empty()) {
+        if (Trace::isCompiledIn()) {
+            Trace::start();
+        } else {
+            std::cerr << "Warning: --trace is ignored, tracing was disabled at build time\n";
+        }
+    }
 
-            // Apply optional operations only if specified
-            if (shiftTimeMs != 0) {
-                srtSubs.shiftTime(shiftTimeMs, START_END);
-            }
-            if (removeFormatting) {
-                srtSubs.removeFormatting();
-            }
-            if (!addStyle.empty()) {
-                srtSubs.addDefaultStyle(addStyle);
-            }
+    try {
+        if (!remapSpec.empty()) {
+            options.remap = TimeRemap::parse(remapSpec);
+        }
 
-            // Write output
-            if (outExtension == "smi") {
-                samiSubs.getEntries() = srtSubs.getEntries();
-                samiSubs.write(outFile);
-            } else if (outExtension == "ass" || outExtension == "ssa") {
-                assSubs.getEntries() = srtSubs.getEntries();
-                assSubs.write(outFile);
-            } else if (outExtension == "vtt") {
-                vttSubs.getEntries() = srtSubs.getEntries();
-                vttSubs.write(outFile);
-            } else {
-                srtSubs.write(outFile);
-            }
-        } else if (inExtension == "smi") {
-            samiSubs.read(inFile);
+        if (hlsMode) {
+            hlsOptions.outputDir = outFile;
+            VTTSegmenter::segmentFile(inFile, hlsOptions);
+            writeTrace(traceFile);
+            std::cout << "Segmentation complete.\n";
+            return 0;
+        }
 
-            // Apply optional operations only if specified
-            if (shiftTimeMs != 0) {
-                samiSubs.shiftTime(shiftTimeMs, START_END);
-            }
-            if (removeFormatting) {
-                samiSubs.removeFormatting();
-            }
-            if (!addStyle.empty()) {
-                samiSubs.addDefaultStyle(addStyle);
-            }
+        if (!batchMode) {
+            Converter::convertFile(inFile, outFile, options);
+            writeTrace(traceFile);
+            std::cout << "Conversion complete.\n";
+            if (options.stats) writeStats(stats.toJson(inFile, outFile), statsFile);
+            return 0;
+        }
 
-            // Write output
-            if (outExtension == "srt") {
-                srtSubs.getEntries() = samiSubs.getEntries();
-                srtSubs.write(outFile);
-            } else if (outExtension == "ass" || outExtension == "ssa") {
-                assSubs.getEntries() = samiSubs.getEntries();
-                assSubs.write(outFile);
-            } else if (outExtension == "vtt") {
-                vttSubs.getEntries() = samiSubs.getEntries();
-                vttSubs.write(outFile);
-            } else {
-                samiSubs.write(outFile);
-            }
-        } else if (inExtension == "ass" || inExtension == "ssa") {
-            assSubs.read(inFile);
+        if (format.empty()) {
+            throw std::runtime_error("--batch requires --format <ext>");
+        }
 
-            // Apply optional operations only if specified
-            if (shiftTimeMs != 0) {
-                assSubs.shiftTime(shiftTimeMs, START_END);
-            }
-            if (removeFormatting) {
-                assSubs.removeFormatting();
-            }
-            if (!addStyle.empty()) {
-                assSubs.addDefaultStyle(addStyle);
-            }
+        BatchConverter::Options batchOptions;
+        batchOptions.conversion = options;
+        batchOptions.format = format;
+        batchOptions.pattern = outFile;
+        batchOptions.jobs = jobs;
 
-            // Write output
-            if (outExtension == "srt") {
-                srtSubs.getEntries() = assSubs.getEntries();
-                srtSubs.write(outFile);
-            } else if (outExtension == "smi") {
-                samiSubs.getEntries() = assSubs.getEntries();
-                samiSubs.write(outFile);
-            } else if (outExtension == "vtt") {
-                vttSubs.getEntries() = assSubs.getEntries();
-                vttSubs.write(outFile);
-            } else {
-                assSubs.write(outFile);
-            }
-        } else if (inExtension == "vtt") {
-            vttSubs.read(inFile, keepNotes);
+        std::vector<BatchConverter::Result> results =
+            BatchConverter::run(BatchConverter::collectInputs(inFile), batchOptions);
 
-            // Apply optional operations only if specified
-            if (shiftTimeMs != 0) {
-                vttSubs.shiftTime(shiftTimeMs, START_END);
-            }
-            if (removeFormatting) {
-                vttSubs.removeFormatting();
-            }
-            if (!addStyle.empty()) {
-                // Only allow certain styles in VTT
-                if (addStyle == "b" || addStyle == "i" || addStyle == "u" || addStyle == "c") {
-                    vttSubs.addDefaultStyle(addStyle);
-                } else {
-                    std::cerr << "Warning: Style '" << addStyle
-                              << "' is not supported in WebVTT. Allowed: b, i, u, c\n";
-                }
-            }
+        writeTrace(traceFile);
 
-            // Write output
-            if (outExtension == "srt") {
-                srtSubs.getEntries() = vttSubs.getEntries();
-                srtSubs.write(outFile);
-            } else if (outExtension == "smi") {
-                samiSubs.getEntries() = vttSubs.getEntries();
-                samiSubs.write(outFile);
-            } else if (outExtension == "ass" || outExtension == "ssa") {
-                assSubs.getEntries() = vttSubs.getEntries();
-                assSubs.write(outFile);
-            } else {
-                vttSubs.write(outFile);
+        size_t failed = 0;
+        for (const BatchConverter::Result& result : results) {
+            if (!result.ok) {
+                std::cerr << "Failed: " << result.input << ": " << result.error << "\n";
+                ++failed;
             }
-        } else {
-            throw std::runtime_error("Unsupported input file format: " + inExtension);
         }
-
-        std::cout << "Conversion complete.\n";
+        std::cout << "Batch complete: " << results.size() - failed << " of " << results.size()
+                  << " files converted.\n";
+        if (options.stats) writeStats(stats.toJson(), statsFile);
+        return failed == 0 ? 0 : 1;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
         return 1;
     }
-
-    return 0;
-}
\ No newline at end of file
+}
@@ -3,7 +3,31 @@
 #include "SAMISubtitle.h"
 #include "ASSSubtitle.h"
 #include "VTTSubtitle.h"
+#include "LineReader.h"
+#include "TagStripper.h"
+#include "TimeCode.h"
+#include "TimeShifter.h"
+#include "StreamConverter.h"
+#include "Converter.h"
+#include "BatchConverter.h"
+#include "ThreadPool.h"
+#include "IntervalIndex.h"
+#include "VTTSegmenter.h"
+#include "BinarySubtitle.h"
+#include "CorpusGenerator.h"
+#include "ParallelParser.h"
+#include "Trace.h"
+#include "RichText.h"
+#include "SAMITokenizer.h"
+#include "TextEncoding.h"
+#include <atomic>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <random>
+#include <regex>
 
 // Utility to compare two files line by line
 bool compareFiles(const std::string& file1, const std::string& file2) {
@@ -205,6 +229,1060 @@ TEST(SubtitleTest, TestRFormat9_ASS) {
     ASSERT_TRUE(compareFiles("../../test/OutPutSUBs/TestRFormat9_out.ass", "../../test/refSUBs/TestRFormat9.ass"));
 }
 
+TEST(SubtitleTest, ASS_EventFormatOrder) {
+    std::string path = testing::TempDir() + "format_order.ass";
+    {
+        std::ofstream out(path);
+        out << "[Events]\n"
+            << "Format: Start, End, Style, Text\n"
+            << "Dialogue: 0:00:01.00,0:00:02.00,Default,Hello, {\\i1}world\\Nagain\n";
+    }
+    ASSSubtitle sub;
+    sub.read(path);
+    ASSERT_EQ(sub.getEntries().getSize(), 1u);
+    ASSERT_EQ(sub.getEntries()[0].start_ms, 1000);
+    ASSERT_EQ(sub.getEntries()[0].end_ms, 2000);
+    ASSERT_EQ(sub.getEntries()[0].text, "Hello, world\nagain");
+    std::remove(path.c_str());
+}
+
+TEST(SubtitleTest, StreamMatchesInMemoryConversion) {
+    std::string streamed = testing::TempDir() + "stream_out.vtt";
+    std::string inMemory = testing::TempDir() + "memory_out.vtt";
+
+    StreamConverter::Options options;
+    options.shiftTimeMs = 1500;
+    options.removeFormatting = true;
+    options.batchSize = 3; // Много маленьких пакетов через очередь
+    options.queueDepth = 2;
+    StreamConverter::convert("../../test/srcSUBs/Test13.srt", streamed, options);
+
+    SRTSubtitle srt;
+    srt.read("../../test/srcSUBs/Test13.srt");
+    srt.shiftTime(1500, START_END);
+    srt.removeFormatting();
+    VTTSubtitle vtt;
+    vtt.getEntries() = std::move(srt.getEntries());
+    vtt.write(inMemory);
+
+    ASSERT_TRUE(compareFiles(streamed, inMemory));
+    std::remove(streamed.c_str());
+    std::remove(inMemory.c_str());
+}
+
+// ==== SubtitleEntryList ====
+
+TEST(SubtitleEntryListTest, CopySharesUntilMutation) {
+    SubtitleEntryList list;
+    list.push_back(SubtitleEntry(0, 1000, "first"));
+    list.push_back(SubtitleEntry(1000, 2000, "second"));
+
+    SubtitleEntryList copy = list;
+    ASSERT_TRUE(list.isShared());
+    const SubtitleEntryList& constCopy = copy;
+    ASSERT_EQ(&constCopy[1].text, &static_cast<const SubtitleEntryList&>(list)[1].text);
+
+    copy[0].text = "changed";
+    ASSERT_FALSE(list.isShared());
+    ASSERT_EQ(list[0].text, "first");
+    ASSERT_EQ(copy[0].text, "changed");
+    // Неизменённая запись остаётся общей
+    ASSERT_EQ(&constCopy[1].text, &static_cast<const SubtitleEntryList&>(list)[1].text);
+}
+
+TEST(SubtitleEntryListTest, MoveTransfersEntries) {
+    SRTSubtitle srt;
+    srt.read("../../test/srcSUBs/Test13.srt");
+    size_t count = srt.getEntries().getSize();
+
+    VTTSubtitle vtt;
+    vtt.getEntries() = std::move(srt.getEntries());
+    ASSERT_EQ(vtt.getEntries().getSize(), count);
+    ASSERT_EQ(srt.getEntries().getSize(), 0u);
+}
+
+// ==== LineReader ====
+
+TEST(SubtitleEntryListTest, ArenaModeMatchesEntries) {
+    SubtitleEntryList list(SubtitleEntryList::STORAGE_ARENA);
+    for (int i = 0; i < 1000; ++i)
+        list.push_back(SubtitleEntry(i * 1000, i * 1000 + 500, "<b>cue " + std::to_string(i) + "</b>"));
+
+    SubtitleEntryList copy = list;
+    for (size_t i = 0; i < list.getSize(); ++i) {
+        list.editText(i, TagStripper::removeHtmlTags);
+        list.wrapText(i, "<i>", "</i>");
+        list.setStart(i, list.getStart(i) + 100);
+    }
+
+    // Копия не видит изменений, сделанных после копирования
+    ASSERT_EQ(copy.getText(7), "<b>cue 7</b>");
+    ASSERT_EQ(list.getText(7), "<i>cue 7</i>");
+    ASSERT_EQ(list.view(7).start_ms, 7100);
+    ASSERT_THROW(list[0], std::logic_error);
+
+    list.setStorageMode(SubtitleEntryList::STORAGE_ENTRIES);
+    ASSERT_EQ(list.getSize(), 1000u);
+    ASSERT_EQ(list[999].text, "<i>cue 999</i>");
+    ASSERT_EQ(list[999].end_ms, 999500);
+}
+
+TEST(SubtitleEntryListTest, ArenaKeepsRareFieldsAside) {
+    auto withCoordinates = [](int i) {
+        SubtitleEntry entry(i * 1000, i * 1000 + 500, "cue " + std::to_string(i));
+        if (i % 100 == 3) {
+            entry.has_coordinates = true;
+            entry.x1 = i;
+            entry.y2 = -i;
+        }
+        return entry;
+    };
+    SubtitleEntryList first(SubtitleEntryList::STORAGE_ARENA), second(SubtitleEntryList::STORAGE_ARENA);
+    for (int i = 0; i < 500; ++i) first.push_back(withCoordinates(i));
+    for (int i = 500; i < 1000; ++i) second.push_back(withCoordinates(i));
+    first.append(std::move(second));
+
+    // Копия получает свою таблицу редких полей при первом изменении
+    SubtitleEntryList copy = first;
+    copy.setText(503, "changed");
+    for (const SubtitleEntryList* list : {&first, &copy}) {
+        ASSERT_EQ(list->getSize(), 1000u);
+        for (size_t i = 0; i < list->getSize(); ++i) {
+            SubtitleEntryView v = list->view(i);
+            ASSERT_EQ(v.has_coordinates, i % 100 == 3) << i;
+            ASSERT_EQ(v.x1, v.has_coordinates ? static_cast<int>(i) : 0) << i;
+            ASSERT_EQ(v.y2, v.has_coordinates ? -static_cast<int>(i) : 0) << i;
+        }
+    }
+    ASSERT_EQ(first.getText(503), "cue 503");
+    ASSERT_EQ(copy.getText(503), "changed");
+}
+
+TEST(SubtitleTest, ArenaConversionMatchesDefault) {
+    std::string arenaOut = testing::TempDir() + "arena_out.srt";
+    std::string defaultOut = testing::TempDir() + "default_out.srt";
+
+    ConversionOptions options;
+    options.shiftTimeMs = 250;
+    options.removeFormatting = true;
+    options.addStyle = "i";
+    Converter::convertFile("../../test/srcSUBs/Test10.ass", defaultOut, options);
+    options.arena = true;
+    Converter::convertFile("../../test/srcSUBs/Test10.ass", arenaOut, options);
+
+    ASSERT_TRUE(compareFiles(arenaOut, defaultOut));
+    std::remove(arenaOut.c_str());
+    std::remove(defaultOut.c_str());
+}
+
+TEST(TransformPipelineTest, SinglePassMatchesSeparateSteps) {
+    TimeRemap remap = TimeRemap::framerate("25", "23.976");
+    for (SubtitleEntryList::StorageMode mode : {SubtitleEntryList::STORAGE_ENTRIES, SubtitleEntryList::STORAGE_ARENA}) {
+        VTTSubtitle stepwise;
+        stepwise.getEntries().setStorageMode(mode);
+        stepwise.getEntries().push_back(SubtitleEntry(1000, 2000, "<b>bold</b> text"));
+        stepwise.getEntries().push_back(SubtitleEntry(-1, -1, "NOTE <kept>"));
+        stepwise.getEntries().push_back(SubtitleEntry(3600000, 3600500, ""));
+        VTTSubtitle fused = stepwise;
+
+        stepwise.remapTime(remap);
+        stepwise.shiftTime(-250, START_END);
+        stepwise.removeFormatting();
+        stepwise.addDefaultStyle("i");
+
+        TransformPipeline pipeline;
+        pipeline.setRemap(remap);
+        pipeline.setShift(-250);
+        pipeline.setRemoveFormatting(true);
+        pipeline.setStyle("i");
+        fused.transform(pipeline);
+
+        const SubtitleEntryList& a = stepwise.getEntries();
+        const SubtitleEntryList& b = fused.getEntries();
+        ASSERT_EQ(a.getSize(), b.getSize());
+        for (size_t i = 0; i < a.getSize(); ++i) {
+            ASSERT_EQ(a.getStart(i), b.getStart(i)) << i;
+            ASSERT_EQ(a.getEnd(i), b.getEnd(i)) << i;
+            ASSERT_EQ(a.getText(i), b.getText(i)) << i;
+        }
+        ASSERT_EQ(b.getStart(0), 1043 - 250);
+        ASSERT_EQ(b.getText(0), "<i>bold text</i>");
+        ASSERT_EQ(b.getStart(1), -1); // Заметка не сдвигается
+        ASSERT_EQ(b.getText(1), "<i>NOTE </i>");
+        ASSERT_EQ(b.getText(2), "<i></i>");
+    }
+}
+
+TEST(ParallelParserTest, SplitsOnlyAfterBlankLines) {
+    std::string buffer;
+    for (int i = 0; i < 200; ++i)
+        buffer += std::to_string(i + 1) + "\r\n00:00:01,000 --> 00:00:02,000\r\nline\r\n\r\n";
+    buffer += "\xEF\xBB\xBFtail\n";
+    std::vector<size_t> bounds = ParallelParser::split(buffer, 0, 16);
+    ASSERT_GT(bounds.size(), 10u);
+    ASSERT_EQ(bounds.front(), 0u);
+    ASSERT_EQ(bounds.back(), buffer.size());
+    for (size_t i = 1; i + 1 < bounds.size(); ++i) {
+        ASSERT_GT(bounds[i], bounds[i - 1]);
+        ASSERT_EQ(buffer.compare(bounds[i] - 4, 4, "\r\n\r\n"), 0) << bounds[i];
+        ASSERT_NE(buffer[bounds[i]], '\xEF');
+    }
+}
+
+TEST(ParallelParserTest, ParallelReadMatchesSequential) {
+    std::string base = testing::TempDir() + "parallel_corpus";
+    CorpusGenerator::Options corpus;
+    corpus.cues = 40000;
+    corpus.noteShare = 0.05;
+    corpus.tagDensity = 0.2;
+    CorpusGenerator(corpus).write(base + ".srt");
+    CorpusGenerator(corpus).write(base + ".vtt");
+
+    for (SubtitleEntryList::StorageMode mode : {SubtitleEntryList::STORAGE_ENTRIES, SubtitleEntryList::STORAGE_ARENA}) {
+        SRTSubtitle srt, srtParallel;
+        srt.getEntries().setStorageMode(mode);
+        srtParallel.getEntries().setStorageMode(mode);
+        srt.read(base + ".srt");
+        srtParallel.read(base + ".srt", 4);
+        VTTSubtitle vtt, vttParallel;
+        vtt.getEntries().setStorageMode(mode);
+        vttParallel.getEntries().setStorageMode(mode);
+        vtt.read(base + ".vtt", true);
+        vttParallel.read(base + ".vtt", true, 4);
+
+        for (auto lists : {std::make_pair(&srt.getEntries(), &srtParallel.getEntries()),
+                           std::make_pair(&vtt.getEntries(), &vttParallel.getEntries())}) {
+            const SubtitleEntryList& a = *lists.first;
+            const SubtitleEntryList& b = *lists.second;
+            ASSERT_GE(a.getSize(), corpus.cues);
+            ASSERT_EQ(a.getSize(), b.getSize());
+            ASSERT_EQ(b.getStorageMode(), mode);
+            for (size_t i = 0; i < a.getSize(); ++i) {
+                SubtitleEntryView x = a.view(i), y = b.view(i);
+                ASSERT_EQ(x.start_ms, y.start_ms) << i;
+                ASSERT_EQ(x.end_ms, y.end_ms) << i;
+                ASSERT_EQ(x.text, y.text) << i;
+                ASSERT_EQ(x.has_coordinates, y.has_coordinates) << i;
+            }
+        }
+    }
+    std::remove((base + ".srt").c_str());
+    std::remove((base + ".vtt").c_str());
+}
+
+TEST(ParallelWriterTest, ParallelWriteMatchesSequential) {
+    std::string base = testing::TempDir() + "parallel_writer";
+    CorpusGenerator::Options corpus;
+    corpus.cues = 30000;
+    corpus.noteShare = 0.05;
+    corpus.tagDensity = 0.2;
+    CorpusGenerator(corpus).write(base + ".vtt");
+
+    VTTSubtitle vtt;
+    vtt.read(base + ".vtt", true);
+    SubtitleEntryList& entries = vtt.getEntries();
+    // Отрицательные метки и координаты проверяют медленный путь и все поля SRT
+    entries.shiftTimes(-5000, true, true, true);
+    entries[1].has_coordinates = true;
+    entries[1].x1 = -12;
+    entries[1].y2 = 480;
+
+    SRTSubtitle srt;
+    ASSSubtitle ass;
+    srt.getEntries() = entries;
+    ass.getEntries() = entries;
+
+    auto readAll = [](const std::string& name) {
+        std::ifstream in(name, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    for (const char* ext : {".srt", ".vtt", ".ass"}) {
+        std::string sequential = base + "_seq" + ext, parallel = base + "_par" + ext;
+        if (ext == std::string(".srt")) {
+            srt.write(sequential);
+            srt.write(parallel, 4);
+        } else if (ext == std::string(".vtt")) {
+            vtt.write(sequential);
+            vtt.write(parallel, 4);
+        } else {
+            ass.write(sequential);
+            ass.write(parallel, 4);
+        }
+        std::string expected = readAll(sequential);
+        ASSERT_GT(expected.size(), 0u) << ext;
+        ASSERT_TRUE(expected == readAll(parallel)) << ext;
+        std::remove(sequential.c_str());
+        std::remove(parallel.c_str());
+    }
+    std::remove((base + ".vtt").c_str());
+}
+
+TEST(ASSStyleTableTest, KeepsEveryStyleAndFindsByName) {
+    ASSSubtitle empty;
+    ASSERT_TRUE(empty.getStyles().isEmpty());
+    ASSERT_EQ(empty.findStyle("Default"), nullptr);
+
+    std::string base = testing::TempDir() + "many_styles";
+    CorpusGenerator::Options corpus;
+    corpus.cues = 50;
+    corpus.styles = 250;
+    CorpusGenerator(corpus).write(base + ".ass");
+
+    ASSSubtitle ass;
+    ass.read(base + ".ass");
+    ASSERT_EQ(ass.getStyles().getSize(), 250u);
+    ASSERT_EQ(ass.getStyles().indexOf("Style249"), 249u);
+    const ASSStyle* style = ass.findStyle("Style150");
+    ASSERT_NE(style, nullptr);
+    ASSERT_EQ(style->name, "Style150");
+    ASSERT_EQ(ass.findStyle("Missing"), nullptr);
+
+    // Копия таблицы ищет по своим строкам
+    ASSStyleTable copy = ass.getStyles();
+    ASSERT_EQ(copy.find("Default"), &copy[0]);
+
+    ass.write(base + "_out.ass");
+    std::ifstream in(base + "_out.ass");
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT_NE(text.find("Style: Style249,"), std::string::npos);
+
+    // События ссылаются на свои стили; стили, которых нет в [V4+ Styles], дописываются
+    {
+        std::ofstream out(base + ".ass", std::ios::binary);
+        out << "[Script Info]\nScriptType: v4.00+\n\n[V4+ Styles]\n"
+               "Style: Main,Arial,40.5,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,0,0,0,0,100,100,0.5,0,1,2.0,1.5,2,10,10,10,1\n\n"
+               "[Events]\nFormat: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n"
+               "Dialogue: 0,0:00:01.00,0:00:02.00,Main,,0,0,0,,main\n"
+               "Dialogue: 0,0:00:03.00,0:00:04.00,Default,,0,0,0,,default\n"
+               "Dialogue: 0,0:00:05.00,0:00:06.00,Sign,,0,0,0,,sign\n";
+    }
+    ASSSubtitle styled;
+    styled.read(base + ".ass");
+    ASSERT_EQ(styled.getEntries().getSize(), 3u);
+    ASSERT_EQ(styled.getStyles().getSize(), 1u);
+    ASSERT_NE(styled.findStyle(styled.getEntries().view(0).formatting), nullptr);
+    ASSERT_TRUE(styled.getEntries().view(1).formatting.empty());
+    styled.write(base + "_out.ass", 2);
+    std::ifstream styledIn(base + "_out.ass");
+    text.assign(std::istreambuf_iterator<char>(styledIn), std::istreambuf_iterator<char>());
+    // Дробные поля стиля записываются так же, как были в файле
+    ASSERT_NE(text.find("Style: Main,Arial,40.5,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,0,0,0,0,100,100,0.5,0,1,2.0,1.5,2,10,10,10,1\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("Style: Default,"), std::string::npos);
+    ASSERT_NE(text.find("Style: Sign,"), std::string::npos);
+    ASSERT_NE(text.find("0:00:01.00,0:00:02.00,Main,,0,0,0,,main\n"), std::string::npos);
+    ASSERT_NE(text.find("0:00:03.00,0:00:04.00,Default,,0,0,0,,default\n"), std::string::npos);
+    ASSERT_NE(text.find("0:00:05.00,0:00:06.00,Sign,,0,0,0,,sign\n"), std::string::npos);
+    std::remove((base + ".ass").c_str());
+    std::remove((base + "_out.ass").c_str());
+}
+
+TEST(RichTextTest, TranslatesMarkupBetweenFormats) {
+    RichText html = RichText::parse("<i>Hello <b>world</b></i>\n<font color=\"#FF0000\">red</font>",
+                                    RichText::MARKUP_HTML);
+    ASSERT_EQ(html.getText(), "Hello world\nred");
+    ASSERT_EQ(html.getRuns().size(), 4u);
+    ASSERT_EQ(html.format(RichText::MARKUP_ASS), "{\\i1}Hello {\\b1}world{\\b0\\i0}\\N{\\c&H0000FF&}red");
+    ASSERT_EQ(html.format(RichText::MARKUP_VTT), "<i>Hello <b>world</b></i>\nred");
+
+    RichText ass = RichText::parse("{\\an8}{\\i1}Hi\\Nthere{\\i0} {\\bord2\\c&H00FF00&}g", RichText::MARKUP_ASS);
+    ASSERT_EQ(ass.getAlignment(), 8);
+    ASSERT_EQ(ass.format(RichText::MARKUP_HTML), "{\\an8}<i>Hi\nthere</i> <font color=\"#00FF00\">g</font>");
+
+    // Удаление разметки и стиль — правки отрезков, без повторного разбора текста
+    TransformPipeline pipeline;
+    pipeline.setRemoveFormatting(true);
+    pipeline.setStyle("b");
+    pipeline.setMarkup(RichText::MARKUP_HTML, RichText::MARKUP_ASS);
+    SubtitleEntry entry;
+    entry.start_ms = 0;
+    entry.end_ms = 1000;
+    entry.text = "<i>one</i>\ntwo";
+    pipeline.apply(entry, TagStripper::removeHtmlTags, false);
+    ASSERT_EQ(entry.text, "{\\b1}one\\Ntwo");
+
+    // Двоичный кэш хранит разметку в HTML: ASS -> subbin -> SRT не теряет стиль
+    std::string base = testing::TempDir() + "rich";
+    {
+        std::ofstream out(base + ".ass", std::ios::binary);
+        out << "[Events]\nFormat: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n"
+               "Dialogue: 0,0:00:01.00,0:00:02.00,Default,,0,0,0,,{\\i1}Hi\\Nthere{\\i0}\n";
+    }
+    ConversionOptions options;
+    options.richText = true;
+    Converter::convertFile(base + ".ass", base + ".subbin", options);
+    Converter::convertFile(base + ".subbin", base + ".srt", options);
+    std::ifstream srtIn(base + ".srt");
+    std::string srt((std::istreambuf_iterator<char>(srtIn)), std::istreambuf_iterator<char>());
+    ASSERT_NE(srt.find("<i>Hi\nthere</i>"), std::string::npos) << srt;
+    for (const char* ext : {".ass", ".subbin", ".srt"}) std::remove((base + ext).c_str());
+}
+
+TEST(SAMITokenizerTest, ReadsMultiLineSyncBlocks) {
+    std::string path = testing::TempDir() + "multiline.smi";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "<sami>\r\n<head><style type=\"text/css\"><!-- P { } --> .x { } <SYNC Start=1></style></head>\r\n"
+               "<body>\r\n"
+               "<sync start=\"1000\"\r\n end=2000>\r\n"
+               "  <p class=ENCC>first line<br>\r\n  second line  \r\n"
+               "  <p class=KRCC>other language\r\n"
+               "<SYNC Start=3000><P>third</P></SYNC>\r\n"
+               "</body></sami>\r\n";
+    }
+    SAMISubtitle sami;
+    sami.read(path);
+    SubtitleEntryList& entries = sami.getEntries();
+    ASSERT_EQ(entries.getSize(), 2u);
+    ASSERT_EQ(entries.getText(0), "first line<br>\n  second line");
+    ASSERT_EQ(entries.getStart(0), 1000);
+    ASSERT_EQ(entries.getEnd(0), 1000);
+    ASSERT_EQ(entries.getText(1), "third");
+    ASSERT_EQ(entries.getStart(1), 2000);
+    ASSERT_EQ(entries.getEnd(1), 3000);
+
+    std::string_view value;
+    ASSERT_TRUE(SAMITokenizer::attribute(" Start='5' END = \"7\"", "end", value));
+    ASSERT_EQ(value, "7");
+    ASSERT_FALSE(SAMITokenizer::attribute(" Start=5", "end", value));
+    std::remove(path.c_str());
+}
+
+TEST(TextEncodingTest, ReadsUtf16AndCodePagesAsUtf8) {
+    // "Привет" в UTF-8, UTF-16LE с BOM и Windows-1251
+    const std::string utf8 = "1\n00:00:01,000 --> 00:00:02,000\n\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82\n\n";
+    std::string utf16 = TextEncoding::fromUtf8(utf8, TextEncoding::ENCODING_UTF16LE);
+    std::string cp1251 = TextEncoding::fromUtf8(utf8, TextEncoding::ENCODING_CP1251);
+    ASSERT_EQ(utf16.substr(0, 4), std::string("\xFF\xFE" "1\0", 4));
+    ASSERT_EQ(cp1251.substr(cp1251.size() - 8), "\xCF\xF0\xE8\xE2\xE5\xF2\n\n");
+
+    size_t bomLength;
+    ASSERT_EQ(TextEncoding::detect(utf16, bomLength), TextEncoding::ENCODING_UTF16LE);
+    ASSERT_EQ(bomLength, 2u);
+    ASSERT_EQ(TextEncoding::detect(utf8, bomLength), TextEncoding::ENCODING_UTF8);
+    ASSERT_EQ(TextEncoding::detect(cp1251, bomLength), TextEncoding::ENCODING_CP1251);
+    // Один повреждённый байт в UTF-8 не превращает файл в Windows-1251
+    std::string damaged = utf8 + "\x96\n";
+    std::string unchanged;
+    ASSERT_EQ(TextEncoding::detect(damaged, bomLength), TextEncoding::ENCODING_UTF8);
+    ASSERT_FALSE(TextEncoding::normalize(damaged, unchanged));
+    ASSERT_EQ(TextEncoding::detect("\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xFF", bomLength), TextEncoding::ENCODING_UTF8);
+    ASSERT_EQ(TextEncoding::toUtf8(utf16, TextEncoding::ENCODING_UTF16LE), utf8);
+    ASSERT_EQ(TextEncoding::toUtf8(TextEncoding::fromUtf8(utf8, TextEncoding::ENCODING_UTF16BE),
+                                   TextEncoding::ENCODING_UTF16BE), utf8);
+
+    std::string path = testing::TempDir() + "utf16.srt";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << utf16;
+    }
+    SRTSubtitle srt;
+    srt.read(path);
+    ASSERT_EQ(srt.getEntries().getSize(), 1u);
+    ASSERT_EQ(srt.getEntries().getText(0), "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82");
+    // Маленький файл ParallelParser не делит: разбирается уже перекодированный текст
+    SRTSubtitle threaded;
+    threaded.read(path, 2);
+    ASSERT_EQ(threaded.getEntries().getSize(), 1u);
+    ASSERT_EQ(threaded.getEntries().getText(0), srt.getEntries().getText(0));
+    std::remove(path.c_str());
+
+    // Ошибки на границах 32-байтовых блоков векторной проверки и в хвосте
+    for (TagStripper::Kernel kernel : {TagStripper::KERNEL_SCALAR, TagStripper::KERNEL_SSE2, TagStripper::KERNEL_AVX2}) {
+        if (!TextEncoding::setKernel(kernel)) continue;
+        for (size_t pos = 25; pos < 70; ++pos) {
+            std::string text(80, 'a');
+            text.replace(pos, 3, "\xE2\x82\xAC");
+            ASSERT_TRUE(TextEncoding::isValidUtf8(text)) << pos;
+            ASSERT_FALSE(TextEncoding::isValidUtf8(text.substr(0, pos + 2))) << pos;
+            std::string surrogate = text;
+            surrogate.replace(pos, 3, "\xED\xA0\x80");
+            ASSERT_FALSE(TextEncoding::isValidUtf8(surrogate)) << pos;
+            std::string overlong = text;
+            overlong.replace(pos, 2, "\xC0\xAF");
+            ASSERT_FALSE(TextEncoding::isValidUtf8(overlong)) << pos;
+            std::string stray = text;
+            stray[pos + 2] = 'a';
+            ASSERT_FALSE(TextEncoding::isValidUtf8(stray)) << pos;
+            ASSERT_TRUE(TextEncoding::isValidUtf8(text.substr(0, pos) + "\xF0\x9F\x98\x80" + text.substr(pos)));
+        }
+    }
+    TextEncoding::setKernel(TagStripper::KERNEL_AUTO);
+}
+
+TEST(LineReaderTest, HandlesBomAndCrlf) {
+    LineReader in("\xEF\xBB\xBFWEBVTT\r\n\r\nlast");
+    std::string_view line;
+    ASSERT_TRUE(in.getLine(line));
+    ASSERT_EQ(line, "WEBVTT");
+    ASSERT_TRUE(in.getLine(line));
+    ASSERT_TRUE(line.empty());
+    ASSERT_TRUE(in.getLine(line));
+    ASSERT_EQ(line, "last");
+    ASSERT_FALSE(in.getLine(line));
+    ASSERT_TRUE(in.eof());
+}
+
+// ==== TagStripper ====
+
+// Случайный текст с высокой плотностью служебных символов
+static std::string randomMarkup(std::mt19937& rng) {
+    static const char alphabet[] = "<>{}\\Nab \n";
+    std::uniform_int_distribution<int> length(0, 80);
+    std::uniform_int_distribution<int> pick(0, sizeof(alphabet) - 2);
+    std::string text(length(rng), ' ');
+    for (char& c : text) c = alphabet[pick(rng)];
+    return text;
+}
+
+TEST(TagStripperTest, MatchesRegexForAllKernels) {
+    const TagStripper::Kernel kernels[] = {
+        TagStripper::KERNEL_SCALAR, TagStripper::KERNEL_SSE2, TagStripper::KERNEL_AVX2
+    };
+    for (TagStripper::Kernel kernel : kernels) {
+        if (!TagStripper::setKernel(kernel)) continue;
+
+        std::mt19937 rng(42);
+        for (int i = 0; i < 2000; ++i) {
+            std::string source = randomMarkup(rng);
+
+            std::string html = source;
+            TagStripper::removeHtmlTags(html);
+            ASSERT_EQ(html, std::regex_replace(source, std::regex("<[^>]*>"), ""));
+
+            std::string ass = source;
+            TagStripper::removeAssTags(ass);
+            std::string expected = std::regex_replace(source, std::regex("\\\\N"), "");
+            expected = std::regex_replace(expected, std::regex("\\{[^}]*\\}"), "");
+            expected = std::regex_replace(expected, std::regex("\\\\"), "");
+            ASSERT_EQ(ass, expected) << "kernel " << TagStripper::kernelName(kernel);
+        }
+    }
+    TagStripper::setKernel(TagStripper::KERNEL_AUTO);
+}
+
+// ==== TimeCode ====
+
+TEST(BufferedWriterTest, ReserveGrowsSmallBuffer) {
+    std::string path = testing::TempDir() + "tiny_buffer.srt";
+    SubtitleEntry entry(3723004, 3724005, "text");
+    {
+        BufferedWriter out(path, 4); // Меньше одной строки времени
+        SRTSubtitle::writeEntry(out, entry, 0);
+        out << int64_t(-1234567890123);
+        out.close();
+    }
+    std::ifstream in(path);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(text, "1\n01:02:03,004 --> 01:02:04,005\ntext\n\n-1234567890123");
+    std::remove(path.c_str());
+}
+
+TEST(TimeCodeTest, MatchesStreamFormatting) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int64_t> dist(-5000, 4000000000LL);
+    for (int i = 0; i < 20000; ++i) {
+        int64_t ms = dist(rng);
+        int h = static_cast<int>(ms / 3600000);
+        int m = static_cast<int>(ms % 3600000 / 60000);
+        int s = static_cast<int>(ms % 60000 / 1000);
+        int rest = static_cast<int>(ms % 1000);
+
+        std::ostringstream srt, vtt, ass;
+        srt << std::setfill('0') << std::setw(2) << h << ":" << std::setw(2) << m << ":"
+            << std::setw(2) << s << "," << std::setw(3) << rest;
+        vtt << h << ":" << std::setfill('0') << std::setw(2) << m << ":"
+            << std::setw(2) << s << "." << std::setw(3) << rest;
+        ass << h << ":" << std::setfill('0') << std::setw(2) << m << ":"
+            << std::setw(2) << s << "." << std::setw(2) << rest / 10;
+
+        ASSERT_EQ(TimeCode::toSRT(ms), srt.str());
+        ASSERT_EQ(TimeCode::toVTT(ms), vtt.str());
+        ASSERT_EQ(TimeCode::toASS(ms), ass.str());
+    }
+}
+
+TEST(ThreadPoolTest, RunsNestedTasks) {
+    ThreadPool pool(4);
+    std::atomic<int> done(0);
+    for (int i = 0; i < 64; ++i) {
+        // Вложенные задачи попадают в очередь текущего потока и могут быть перехвачены
+        pool.submit([&pool, &done] {
+            for (int j = 0; j < 16; ++j)
+                pool.submit([&done] { ++done; });
+            ++done;
+        });
+    }
+    pool.wait();
+    ASSERT_EQ(done.load(), 64 * 17);
+
+    pool.submit([] { throw std::runtime_error("task failed"); });
+    ASSERT_THROW(pool.wait(), std::runtime_error);
+}
+
+TEST(BatchConverterTest, ConvertsListAndReportsFailures) {
+    std::string dir = testing::TempDir() + "batch_out";
+    std::string list = testing::TempDir() + "batch_list.txt";
+    std::ofstream(list) << "../../test/srcSUBs/Test13.srt\n"
+                        << "../../test/srcSUBs/missing.srt\n\n"
+                        << "../../test/srcSUBs/Test14.srt\n";
+
+    std::vector<std::string> inputs = BatchConverter::collectInputs(list);
+    ASSERT_EQ(inputs.size(), 3u);
+    ASSERT_EQ(BatchConverter::makeOutputPath("a/b/x.srt", "{dir}/out/{name}_conv.{ext}", "vtt"), "a/b/out/x_conv.vtt");
+
+    BatchConverter::Options options;
+    options.format = "vtt";
+    options.pattern = dir;
+    options.jobs = 2;
+    std::vector<BatchConverter::Result> results = BatchConverter::run(inputs, options);
+
+    ASSERT_EQ(results.size(), 3u);
+    ASSERT_TRUE(results[0].ok);
+    ASSERT_FALSE(results[1].ok);
+    ASSERT_FALSE(results[1].error.empty());
+    ASSERT_TRUE(results[2].ok);
+
+    std::string single = testing::TempDir() + "batch_single.vtt";
+    Converter::convertFile("../../test/srcSUBs/Test14.srt", single, ConversionOptions());
+    ASSERT_TRUE(compareFiles(results[2].output, single));
+
+    // Большой файл один в пакете: разбор и запись делятся между свободными потоками
+    std::string large = testing::TempDir() + "batch_large.srt";
+    CorpusGenerator::Options corpus;
+    corpus.cues = 40000;
+    CorpusGenerator(corpus).write(large);
+    options.streamThreshold = 0;
+    options.jobs = 4;
+    options.format = "ass";
+    results = BatchConverter::run({large}, options);
+    ASSERT_EQ(results.size(), 1u);
+    ASSERT_TRUE(results[0].ok) << results[0].error;
+    std::string largeSingle = testing::TempDir() + "batch_large_single.ass";
+    Converter::convertFile(large, largeSingle, ConversionOptions());
+    ASSERT_TRUE(compareFiles(results[0].output, largeSingle));
+
+    std::filesystem::remove_all(dir);
+    std::remove(list.c_str());
+    std::remove(single.c_str());
+    std::remove(large.c_str());
+    std::remove(largeSingle.c_str());
+}
+
+TEST(TimeShifterTest, KernelsMatchScalarAndKeepNotes) {
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int64_t> dist(-3000, 100000);
+    std::vector<int64_t> start(1003), end(1003);
+    for (size_t i = 0; i < start.size(); ++i) {
+        bool note = i % 7 == 0;
+        start[i] = note ? -1 : dist(rng);
+        end[i] = note ? -1 : dist(rng);
+    }
+
+    TimeShifter::Kernel original = TimeShifter::getKernel();
+    for (bool skipNotes : {false, true}) {
+        for (int type = 0; type < 3; ++type) {
+            bool shiftStart = type != 2, shiftEnd = type != 1;
+            std::vector<int64_t> s1 = start, e1 = end, s2 = start, e2 = end;
+
+            ASSERT_TRUE(TimeShifter::setKernel(TagStripper::KERNEL_SCALAR));
+            TimeShifter::shift(s1.data(), e1.data(), s1.size(), -1500, shiftStart, shiftEnd, skipNotes);
+            TimeShifter::clamp(s1.data(), e1.data(), s1.size(), 0, 90000, skipNotes);
+            TimeShifter::setKernel(TagStripper::KERNEL_AUTO);
+            TimeShifter::shift(s2.data(), e2.data(), s2.size(), -1500, shiftStart, shiftEnd, skipNotes);
+            TimeShifter::clamp(s2.data(), e2.data(), s2.size(), 0, 90000, skipNotes);
+
+            ASSERT_EQ(s1, s2);
+            ASSERT_EQ(e1, e2);
+            ASSERT_EQ(s1[7] == -1 && e1[7] == -1, skipNotes);
+        }
+    }
+    TimeShifter::setKernel(original);
+}
+
+TEST(TimeRemapTest, ExactRationalMapping) {
+    // 25 -> 23.976 fps: t * 25 * 1001 / 24000, округление до ближайшего
+    TimeRemap fps = TimeRemap::parse("fps:25:23.976");
+    ASSERT_EQ(fps.map(0), 0);
+    ASSERT_EQ(fps.map(1000), 1043);
+    ASSERT_EQ(fps.map(3600000), 3753754);
+    ASSERT_EQ(TimeRemap::parse("fps:24000/1001:24").map(1001000), 1000000);
+
+    TimeRemap drift = TimeRemap::parse("linear:1.001:-200");
+    ASSERT_EQ(drift.map(1000000), 1000800);
+
+    TimeRemap piecewise = TimeRemap::parse("anchors:0=0,1000=2000,3000=3000");
+    ASSERT_EQ(piecewise.map(500), 1000);
+    ASSERT_EQ(piecewise.map(2000), 2500);
+    ASSERT_EQ(piecewise.map(5000), 4000); // Продолжение последнего участка
+    ASSERT_EQ(piecewise.map(-100), -200);
+
+    ASSERT_THROW(TimeRemap::parse("fps:25"), std::runtime_error);
+    ASSERT_THROW(TimeRemap::parse("anchors:0=0,0=5"), std::runtime_error);
+}
+
+TEST(TimeRemapTest, KernelsMatchScalar) {
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int64_t> small(-1000, 20000000);
+    std::uniform_int_distribution<int64_t> huge(-(1LL << 55), 1LL << 55);
+    std::vector<int64_t> start(2001), end(2001);
+    for (size_t i = 0; i < start.size(); ++i) {
+        bool note = i % 9 == 0;
+        start[i] = note ? -1 : (i % 101 == 0 ? huge(rng) : small(rng));
+        end[i] = note ? -1 : small(rng);
+    }
+
+    const char* specs[] = {"fps:25:23.976", "linear:-7/3:11", "anchors:0=0,5000000=5000100,9000000=8999000,15000000=15000000"};
+    TimeShifter::Kernel original = TimeShifter::getKernel();
+    for (const char* spec : specs) {
+        TimeRemap remap = TimeRemap::parse(spec);
+        for (bool skipNotes : {false, true}) {
+            std::vector<int64_t> s1 = start, e1 = end, s2 = start, e2 = end;
+            ASSERT_TRUE(TimeShifter::setKernel(TagStripper::KERNEL_SCALAR));
+            TimeShifter::remap(s1.data(), e1.data(), s1.size(), remap, skipNotes);
+            TimeShifter::setKernel(TagStripper::KERNEL_AUTO);
+            TimeShifter::remap(s2.data(), e2.data(), s2.size(), remap, skipNotes);
+            ASSERT_EQ(s1, s2) << spec;
+            ASSERT_EQ(e1, e2) << spec;
+            for (size_t i = 1; i < start.size(); i += 97) {
+                if (skipNotes && start[i] == -1 && end[i] == -1) continue;
+                ASSERT_EQ(s1[i], remap.map(start[i])) << spec;
+            }
+        }
+    }
+    TimeShifter::setKernel(original);
+}
+
+TEST(IntervalIndexTest, MatchesLinearScan) {
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int64_t> startDist(0, 600000);
+    std::uniform_int_distribution<int64_t> lengthDist(0, 20000);
+    SubtitleEntryList list;
+    for (int i = 0; i < 3000; ++i) {
+        int64_t start = startDist(rng);
+        list.push_back(SubtitleEntry(start, start + lengthDist(rng), "cue"));
+    }
+
+    auto scan = [&list](int64_t from, int64_t to) {
+        std::vector<std::pair<int64_t, size_t>> hits;
+        for (size_t i = 0; i < list.getSize(); ++i) {
+            if (list.getStart(i) < to && list.getEnd(i) > from) hits.emplace_back(list.getStart(i), i);
+        }
+        std::stable_sort(hits.begin(), hits.end(),
+                         [](const std::pair<int64_t, size_t>& a, const std::pair<int64_t, size_t>& b) { return a.first < b.first; });
+        std::vector<size_t> ids;
+        for (const auto& hit : hits) ids.push_back(hit.second);
+        return ids;
+    };
+
+    IntervalIndex index(list);
+    SRTSubtitle srt;
+    for (int round = 0; round < 3; ++round) {
+        for (int q = 0; q < 200; ++q) {
+            int64_t t = startDist(rng) + (round ? 1500 : 0);
+            std::vector<size_t> active, overlapping;
+            index.findActive(t, active);
+            index.findOverlapping(t, t + 5000, overlapping);
+            ASSERT_EQ(active, scan(t, t + 1));
+            ASSERT_EQ(overlapping, scan(t, t + 5000));
+        }
+
+        if (round == 0) {
+            // Одинаковый сдвиг всех записей учитывается без перестроения
+            srt.getEntries() = list;
+            srt.shiftTime(1500, START_END);
+            list = srt.getEntries();
+            index.shift(1500);
+        } else {
+            list.remapTimes(TimeRemap::parse("linear:1.001:0"), false);
+            index.refresh(list);
+        }
+    }
+}
+
+TEST(VTTSegmenterTest, DuplicatesCuesAcrossBoundaries) {
+    std::string dir = testing::TempDir() + "hls_out";
+    VTTSubtitle vtt;
+    vtt.getEntries().push_back(SubtitleEntry(-1, -1, "a note"));
+    vtt.getEntries().push_back(SubtitleEntry(7000, 8000, "second"));
+    vtt.getEntries().push_back(SubtitleEntry(1000, 2000, "first"));
+    vtt.getEntries().push_back(SubtitleEntry(5000, 13000, "spanning"));
+
+    VTTSegmenter::Options options;
+    options.outputDir = dir;
+    options.segmentMs = 6000;
+    options.mpegts = 900000;
+    vtt.writeSegments(options);
+
+    auto read = [&dir](const std::string& name) {
+        std::ifstream in(dir + "/" + name);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    const std::string header = "WEBVTT\nX-TIMESTAMP-MAP=MPEGTS:900000,LOCAL:00:00:00.000\n\n";
+    ASSERT_EQ(read("segment0.vtt"), header + "0:00:01.000 --> 0:00:02.000\nfirst\n\n"
+                                            "0:00:05.000 --> 0:00:13.000\nspanning\n\n");
+    ASSERT_EQ(read("segment1.vtt"), header + "0:00:05.000 --> 0:00:13.000\nspanning\n\n"
+                                            "0:00:07.000 --> 0:00:08.000\nsecond\n\n");
+    ASSERT_EQ(read("segment2.vtt"), header + "0:00:05.000 --> 0:00:13.000\nspanning\n\n");
+    ASSERT_EQ(read("playlist.m3u8"), "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:6\n"
+                                     "#EXT-X-MEDIA-SEQUENCE:0\n#EXT-X-PLAYLIST-TYPE:VOD\n"
+                                     "#EXTINF:6.000,\nsegment0.vtt\n#EXTINF:6.000,\nsegment1.vtt\n"
+                                     "#EXTINF:1.000,\nsegment2.vtt\n#EXT-X-ENDLIST\n");
+
+    // Потоковая нарезка неупорядоченного файла не теряет ранние записи
+    std::string srtPath = testing::TempDir() + "unordered.srt";
+    {
+        std::ofstream out(srtPath, std::ios::binary);
+        out << "1\n00:00:20,000 --> 00:00:21,000\nlate\n\n2\n00:00:01,000 --> 00:00:02,000\nearly\n\n";
+    }
+    VTTSegmenter::segmentFile(srtPath, options);
+    ASSERT_EQ(read("segment0.vtt"), header + "0:00:01.000 --> 0:00:02.000\nearly\n\n");
+    ASSERT_EQ(read("segment3.vtt"), header + "0:00:20.000 --> 0:00:21.000\nlate\n\n");
+
+    VTTSegmenter direct(options);
+    direct.add(SubtitleEntry(20000, 21000, "late"));
+    direct.add(SubtitleEntry(1000, 2000, "early"));
+    ASSERT_FALSE(direct.isOrdered());
+    ASSERT_THROW(direct.finish(), std::runtime_error);
+    std::remove(srtPath.c_str());
+    std::filesystem::remove_all(dir);
+}
+
+TEST(VTTSegmenterTest, ClampsCuesShiftedBeforeZero) {
+    std::string dir = testing::TempDir() + "hls_shifted";
+    VTTSubtitle vtt;
+    vtt.getEntries().push_back(SubtitleEntry(1000, 2000, "gone"));
+    vtt.getEntries().push_back(SubtitleEntry(4000, 7000, "clipped"));
+    vtt.getEntries().push_back(SubtitleEntry(9000, 10000, "kept"));
+    vtt.shiftTime(-5000, START_END);
+
+    VTTSegmenter::Options options;
+    options.outputDir = dir;
+    options.segmentMs = 6000;
+    // Упорядоченный вход с отрицательным началом не считается неупорядоченным
+    VTTSegmenter direct(options);
+    for (size_t i = 0; i < vtt.getEntries().getSize(); ++i) direct.add(vtt.getEntries().view(i));
+    ASSERT_TRUE(direct.isOrdered());
+    ASSERT_NO_THROW(direct.finish());
+
+    std::ifstream in(dir + "/segment0.vtt");
+    std::string segment((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(segment, "WEBVTT\nX-TIMESTAMP-MAP=MPEGTS:0,LOCAL:00:00:00.000\n\n"
+                       "0:00:00.000 --> 0:00:02.000\nclipped\n\n"
+                       "0:00:04.000 --> 0:00:05.000\nkept\n\n");
+    ASSERT_EQ(direct.getSegmentCount(), 1u);
+    in.close();
+    std::filesystem::remove_all(dir);
+}
+
+TEST(BinarySubtitleTest, RoundTripsEveryField) {
+    std::string path = testing::TempDir() + "cache.subbin";
+    BinarySubtitle original;
+    SubtitleEntry entry(1000, 2500, "<b>first</b>\nline");
+    entry.formatting = "{\\pos(10,20)}";
+    entry.x1 = -5;
+    entry.x2 = 640;
+    entry.y1 = 7;
+    entry.y2 = 480;
+    entry.has_coordinates = true;
+    original.getEntries().push_back(entry);
+    original.getEntries().push_back(SubtitleEntry(-1, -1, ""));
+    original.getEntries().push_back(SubtitleEntry(3000, 4000, "third"));
+    original.write(path);
+
+    BinarySubtitle loaded;
+    loaded.read(path);
+    SubtitleEntryList& entries = loaded.getEntries();
+    ASSERT_EQ(entries.getSize(), 3u);
+    SubtitleEntryView first = entries.view(0);
+    ASSERT_EQ(first.start_ms, 1000);
+    ASSERT_EQ(first.end_ms, 2500);
+    ASSERT_EQ(first.text, entry.text);
+    ASSERT_EQ(first.formatting, entry.formatting);
+    ASSERT_EQ(first.x1, -5);
+    ASSERT_EQ(first.x2, 640);
+    ASSERT_EQ(first.y1, 7);
+    ASSERT_EQ(first.y2, 480);
+    ASSERT_TRUE(first.has_coordinates);
+    ASSERT_EQ(entries.view(1).start_ms, -1);
+    ASSERT_EQ(entries.getText(1), "");
+    ASSERT_EQ(entries.getText(2), "third");
+    ASSERT_FALSE(entries.view(2).has_coordinates);
+
+    // Любой испорченный байт обнаруживается контрольной суммой
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(100);
+        file.put('X');
+    }
+    ASSERT_THROW(loaded.read(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(BinarySubtitleTest, RejectsTruncatedFileAndBadCount) {
+    std::string path = testing::TempDir() + "broken.subbin";
+    BinarySubtitle original;
+    original.getEntries().push_back(SubtitleEntry(1000, 2000, std::string(100, 'a')));
+    original.write(path);
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    auto expectInvalid = [&](const std::string& content, const std::string& reason) {
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file << content;
+        }
+        BinarySubtitle loaded;
+        try {
+            loaded.read(path);
+            FAIL() << "invalid cache was accepted";
+        } catch (const std::runtime_error& e) {
+            std::string message = e.what();
+            ASSERT_EQ(message.rfind("Invalid subtitle cache: ", 0), 0u) << message;
+            ASSERT_NE(message.find(reason), std::string::npos) << message;
+        }
+    };
+
+    // Обрезанный файл: не хватает контрольной суммы или части текста
+    expectInvalid(bytes.substr(0, bytes.size() - 4), "");
+    expectInvalid(bytes.substr(0, 80), "");
+    // Число записей, при котором таблицы смещений и контрольная сумма выходят за конец файла
+    std::string badCount = bytes;
+    uint64_t count = 3;
+    std::memcpy(&badCount[24], &count, sizeof(count));
+    expectInvalid(badCount, "bad entry count");
+    std::remove(path.c_str());
+}
+
+TEST(BinarySubtitleTest, ConversionThroughCacheMatchesDirect) {
+    std::string cache = testing::TempDir() + "Test10.subbin";
+    std::string viaCache = testing::TempDir() + "via_cache.srt";
+    std::string direct = testing::TempDir() + "direct.srt";
+
+    Converter::convertFile("../../test/srcSUBs/Test10.ass", cache, ConversionOptions());
+    Converter::convertFile(cache, viaCache, ConversionOptions());
+    Converter::convertFile("../../test/srcSUBs/Test10.ass", direct, ConversionOptions());
+
+    ASSERT_TRUE(compareFiles(viaCache, direct));
+    std::remove(cache.c_str());
+    std::remove(viaCache.c_str());
+    std::remove(direct.c_str());
+}
+
+TEST(CorpusGeneratorTest, SameSeedGivesSameCuesInEveryFormat) {
+    std::string base = testing::TempDir() + "corpus";
+    CorpusGenerator::Options options;
+    options.seed = 7;
+    options.cues = 500;
+    options.overlap = 0.2;
+    options.tagDensity = 0.2;
+    options.utf8Share = 0.3;
+    options.noteShare = 0.1;
+    CorpusGenerator generator(options);
+    for (const char* ext : {".srt", ".vtt", ".smi", ".ass"}) generator.write(base + ext);
+    generator.write(base + "_again.srt");
+    ASSERT_TRUE(compareFiles(base + ".srt", base + "_again.srt"));
+
+    SRTSubtitle srt;
+    srt.read(base + ".srt");
+    VTTSubtitle vtt;
+    vtt.read(base + ".vtt", false);
+    SAMISubtitle sami;
+    sami.read(base + ".smi");
+    ASSSubtitle ass;
+    ass.read(base + ".ass");
+
+    ASSERT_EQ(srt.getEntries().getSize(), 500u);
+    ASSERT_EQ(vtt.getEntries().getSize(), 500u);
+    ASSERT_EQ(sami.getEntries().getSize(), 500u);
+    ASSERT_EQ(ass.getEntries().getSize(), 500u);
+
+    bool overlaps = false;
+    bool commas = false;
+    for (size_t i = 0; i < 500; ++i) {
+        ASSERT_EQ(srt.getEntries().getStart(i), vtt.getEntries().getStart(i));
+        ASSERT_EQ(srt.getEntries().getText(i), vtt.getEntries().getText(i));
+        if (i && srt.getEntries().getStart(i) < srt.getEntries().getEnd(i - 1)) overlaps = true;
+        if (ass.getEntries().getText(i).find(',') != std::string_view::npos) commas = true;
+    }
+    ASSERT_TRUE(overlaps);
+    ASSERT_TRUE(commas);
+
+    for (const char* ext : {".srt", ".vtt", ".smi", ".ass", "_again.srt"}) std::remove((base + ext).c_str());
+}
+
+TEST(PhaseStatsTest, RecordsEveryPhaseOfConversion) {
+    std::string output = testing::TempDir() + "stats.vtt";
+    PhaseStats stats;
+    ConversionOptions options;
+    options.shiftTimeMs = 500;
+    options.removeFormatting = true;
+    options.addStyle = "i";
+    options.stats = &stats;
+    Converter::convertFile("../../test/srcSUBs/Test13.srt", output, options);
+
+    SRTSubtitle subs;
+    subs.read("../../test/srcSUBs/Test13.srt");
+    ASSERT_EQ(stats.cues, subs.getEntries().getSize());
+    ASSERT_EQ(stats.files, 1u);
+    ASSERT_EQ(stats.inputBytes, std::filesystem::file_size("../../test/srcSUBs/Test13.srt"));
+    ASSERT_EQ(stats.outputBytes, std::filesystem::file_size(output));
+
+    uint64_t phasesNs = 0;
+    // Стиль добавляется в том же проходе, что и удаление разметки (STRIP)
+    for (PhaseStats::Phase phase : {PhaseStats::OPEN_READ, PhaseStats::PARSE, PhaseStats::SHIFT, PhaseStats::STRIP,
+                                    PhaseStats::FORMAT, PhaseStats::FLUSH}) {
+        ASSERT_GT(stats.phases[phase].ns, 0u) << PhaseStats::phaseName(phase);
+        phasesNs += stats.phases[phase].ns;
+    }
+    ASSERT_LE(phasesNs, stats.wallNs);
+    ASSERT_GT(stats.phases[PhaseStats::PARSE].allocations, 0u);
+    ASSERT_EQ(stats.phases[PhaseStats::STYLE].ns, 0u);
+    ASSERT_EQ(stats.phases[PhaseStats::STREAM].ns, 0u);
+
+    std::string json = stats.toJson("in.srt", output);
+    ASSERT_NE(json.find("\"cues\": " + std::to_string(stats.cues)), std::string::npos);
+    ASSERT_NE(json.find("\"flush\": {\"ns\": "), std::string::npos);
+    std::remove(output.c_str());
+}
+
+TEST(TraceTest, WritesEventsOfEveryThread) {
+    if (!Trace::isCompiledIn()) GTEST_SKIP() << "built without SUBTITLE_ENABLE_TRACING";
+
+    std::string output = testing::TempDir() + "trace.vtt";
+    std::string trace = testing::TempDir() + "trace.json";
+    ConversionOptions options;
+    options.stream = true;
+    options.removeFormatting = true;
+    Trace::clear();
+    Trace::start();
+    Converter::convertFile("../../test/srcSUBs/Test13.srt", output, options);
+    Trace::stop();
+    Converter::convertFile("../../test/srcSUBs/Test13.srt", output, options); // Не записывается
+    Trace::write(trace);
+    Trace::clear();
+
+    std::ifstream in(trace);
+    std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0u);
+    ASSERT_NE(json.find("\"args\":{\"name\":\"main\"}"), std::string::npos);
+    ASSERT_NE(json.find("\"args\":{\"name\":\"stream parser\"}"), std::string::npos);
+    ASSERT_NE(json.find("\"args\":{\"detail\":\"../../test/srcSUBs/Test13.srt\"}"), std::string::npos);
+
+    SRTSubtitle subs;
+    subs.read("../../test/srcSUBs/Test13.srt");
+    size_t parsed = 0;
+    for (size_t pos = json.find("\"SRTSubtitle::parseEntry\""); pos != std::string::npos;
+         pos = json.find("\"SRTSubtitle::parseEntry\"", pos + 1))
+        ++parsed;
+    ASSERT_GE(parsed, subs.getEntries().getSize());
+    ASSERT_EQ(json.find("\"Converter::convertFile\""), json.rfind("\"Converter::convertFile\""));
+    ASSERT_EQ(json.substr(json.size() - 4), "\n]}\n");
+    std::remove(output.c_str());
+    std::remove(trace.c_str());
+}
+
 // Entry point for Google Test
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,77 @@
+#include "CorpusGenerator.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Parses "<min>:<max>" into two integers
+static void parseRange(const std::string& spec, int& min, int& max) {
+    size_t colon = spec.find(':');
+    if (colon == std::string::npos) {
+        min = max = std::stoi(spec);
+        return;
+    }
+    min = std::stoi(spec.substr(0, colon));
+    max = std::stoi(spec.substr(colon + 1));
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: corpusgen <out_file>... [options]\n";
+        std::cerr << "Writes the same synthetic cues to every <out_file> (srt, vtt, smi, ass).\n";
+        std::cerr << "Options:\n";
+        std::cerr << "  --seed <n>               Random seed (default: 1).\n";
+        std::cerr << "  --cues <n>               Number of cues (default: 1000).\n";
+        std::cerr << "  --overlap <p>            Share of cues overlapping the previous one (default: 0.05).\n";
+        std::cerr << "  --line-length <min:max>  Characters per text line (default: 20:42).\n";
+        std::cerr << "  --lines <n>              Up to <n> lines per cue (default: 2).\n";
+        std::cerr << "  --tags <p>               Formatting tag probability per word (default: 0.05).\n";
+        std::cerr << "  --utf8 <p>               Share of non-ASCII words (default: 0.1).\n";
+        std::cerr << "  --notes <p>              VTT NOTE block probability per cue (default: 0.01).\n";
+        std::cerr << "  --styles <n>             Number of ASS styles (default: 4).\n";
+        return 1;
+    }
+
+    CorpusGenerator::Options options;
+    std::vector<std::string> outputs;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--seed" && i + 1 < argc) {
+                options.seed = std::stoull(argv[++i]);
+            } else if (arg == "--cues" && i + 1 < argc) {
+                options.cues = std::stoull(argv[++i]);
+            } else if (arg == "--overlap" && i + 1 < argc) {
+                options.overlap = std::stod(argv[++i]);
+            } else if (arg == "--line-length" && i + 1 < argc) {
+                parseRange(argv[++i], options.minLineLength, options.maxLineLength);
+            } else if (arg == "--lines" && i + 1 < argc) {
+                options.maxLines = std::stoi(argv[++i]);
+            } else if (arg == "--tags" && i + 1 < argc) {
+                options.tagDensity = std::stod(argv[++i]);
+            } else if (arg == "--utf8" && i + 1 < argc) {
+                options.utf8Share = std::stod(argv[++i]);
+            } else if (arg == "--notes" && i + 1 < argc) {
+                options.noteShare = std::stod(argv[++i]);
+            } else if (arg == "--styles" && i + 1 < argc) {
+                options.styles = std::stoi(argv[++i]);
+            } else if (arg.compare(0, 2, "--") == 0) {
+                std::cerr << "Error: unknown option " << arg << "\n";
+                return 1;
+            } else {
+                outputs.push_back(arg);
+            }
+        }
+
+        CorpusGenerator generator(options);
+        for (const std::string& output : outputs) {
+            generator.write(output);
+        }
+        std::cout << "Generated " << options.cues << " cues into " << outputs.size() << " file(s).\n";
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}